@@ -15,12 +15,20 @@
 
 #define configUSE_PREEMPTION					1
 #define configUSE_IDLE_HOOK						1
+/* The tick hook is called once for every tick, including ticks the port
+catches up on after interrupts were masked.  Ticks stepped over while the idle
+task sleeps with configUSE_TICKLESS_IDLE do not call it. */
 #define configUSE_TICK_HOOK						1
 #define configTICK_RATE_HZ				( ( portTickType ) 1000 )
+#if defined( __GCC_POSIX_UCONTEXT__ )
+/* The single threaded port runs tasks on these stacks, so they must hold C library calls and the tick signal frame. */
+#define configMINIMAL_STACK_SIZE		( ( unsigned portSHORT ) 4096 )
+#else
 #define configMINIMAL_STACK_SIZE		( ( unsigned portSHORT ) 64 ) /* This can be made smaller if required. */
+#endif
 #define configTOTAL_HEAP_SIZE			( ( size_t ) ( 64 * 1024 ) )
 #define configMAX_TASK_NAME_LEN			( 16 )
-#define configUSE_TRACE_FACILITY    	0
+#define configUSE_TRACE_FACILITY    	1 /* Queue numbers index the deadlock detector's mutex table. */
 #define configUSE_16_BIT_TICKS      	0
 #define configIDLE_SHOULD_YIELD			1
 #define configUSE_MUTEXES				1
@@ -36,6 +44,10 @@
 #define configUSE_QUEUE_SETS					1
 #define configUSE_TASK_NOTIFICATIONS			1
 
+/* Used by the deadlock detection module to publish what each task is blocked on
+and, for lock order validation, which mutexes each task currently holds. */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS	2
+
 /* Software timer related configuration options. */
 #define configUSE_TIMERS						1
 #define configTIMER_TASK_PRIORITY				( configMAX_PRIORITIES - 1 )
@@ -44,7 +56,45 @@
 
 #define configMAX_PRIORITIES		( 10 )
 
+/* Select the next task from a bitmap of ready priorities in constant time.
+The SMP scheduler uses the generic selection. */
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION	( configNUMBER_OF_CORES == 1 )
+
+/* Schedule tasks given a deadline with vTaskSetDeadline() earliest deadline
+first within their priority.  Not available in the SMP scheduler. */
+#define configUSE_EDF_SCHEDULING				( configNUMBER_OF_CORES == 1 )
+
+/* Allow tasks to be given a CPU budget with vTaskSetBudget().  A task that
+uses up its budget runs at the idle priority until it is replenished.  Not
+available in the SMP scheduler. */
+#define configUSE_TASK_BUDGETS					( configNUMBER_OF_CORES == 1 )
+#define configTASK_BUDGET_EXHAUSTED_PRIORITY	0
+
+/* Block delayed tasks in a timing wheel in constant time.  The first level
+spans 256 ticks, longer than the delays of 100 ms or so that the demo tasks
+use, so most tasks are never cascaded down from a higher level. */
+#define configUSE_DELAYED_TASK_WHEEL			1
+#define configDELAYED_TASK_WHEEL_SIZE			256
+
 #define configGENERATE_RUN_TIME_STATS		1
+/* Nanosecond run time stats; a 32 bit counter would count microseconds. */
+#define configRUN_TIME_COUNTER_TYPE			uint64_t
+
+/* Virtual time: when every task is blocked the tick count jumps straight to the
+next unblock time, so delays and timeouts cost no wall-clock time.  The port
+takes over the idle period through tickless idle. */
+#define configUSE_VIRTUAL_TIME				0
+
+/* Tickless idle: when every task is blocked the tick stops and the simulator
+sleeps until the next unblock time, so an idle simulator uses next to no CPU.
+Virtual time needs it; more than one core does not support it. */
+#define configUSE_TICKLESS_IDLE				( configNUMBER_OF_CORES == 1 )
+
+/* Simulated cores.  Above 1 the POSIX port runs that many tasks at once, each
+on its own host thread, which needs configUSE_VIRTUAL_TIME set to 0. */
+#ifndef configNUMBER_OF_CORES
+#define configNUMBER_OF_CORES				1
+#endif
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function.  In most cases the linker will remove unused
@@ -71,4 +121,12 @@ uses the same semantics as the standard C assert() macro. */
 extern void vAssertCalled( unsigned long ulLine, const char * const pcFileName );
 #define configASSERT( x ) if( ( x ) == 0 ) vAssertCalled( __LINE__, __FILE__ )
 
+/* Drive the deadlock detector from the kernel trace macros so every mutex is
+tracked, including those taken with plain xSemaphoreTake(). */
+#define configDEADLOCK_USE_KERNEL_HOOKS			1
+
+#if ( configDEADLOCK_USE_KERNEL_HOOKS == 1 )
+	#include "deadlock_trace.h"
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
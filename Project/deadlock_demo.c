@@ -41,8 +41,9 @@ void vStartDeadlockDemo(void)
     xMutex2 = xCreateMutexWithDeadlockDetection("Mutex2");
     
     /* 创建任务 */
-    xTaskCreate(vTask1, "Task1", TASK_STACK_SIZE, NULL, TASK1_PRIORITY, &xTask1Handle);
-    xTaskCreate(vTask2, "Task2", TASK_STACK_SIZE, NULL, TASK2_PRIORITY, &xTask2Handle);
+    /* 创建任务，登记入口信息以便死锁恢复时可以重启 */
+    xCreateTaskWithDeadlockRecovery(vTask1, "Task1", TASK_STACK_SIZE, NULL, TASK1_PRIORITY, &xTask1Handle);
+    xCreateTaskWithDeadlockRecovery(vTask2, "Task2", TASK_STACK_SIZE, NULL, TASK2_PRIORITY, &xTask2Handle);
 }
 
 /*
@@ -79,6 +80,11 @@ static void vTask1(void *pvParameters)
                 xGiveMutexWithDeadlockDetection(xMutex2);
                 printf("任务1: 释放互斥量2\r\n");
             }
+            else
+            {
+                /* 死锁恢复中止了本任务的等待 */
+                printf("任务1: 获取互斥量2失败\r\n");
+            }
             
             /* 释放互斥量1 */
             xGiveMutexWithDeadlockDetection(xMutex1);
@@ -127,6 +133,11 @@ static void vTask2(void *pvParameters)
                 xGiveMutexWithDeadlockDetection(xMutex1);
                 printf("任务2: 释放互斥量1\r\n");
             }
+            else
+            {
+                /* 死锁恢复中止了本任务的等待 */
+                printf("任务2: 获取互斥量1失败\r\n");
+            }
             
             /* 释放互斥量2 */
             xGiveMutexWithDeadlockDetection(xMutex2);
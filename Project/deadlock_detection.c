@@ -1,32 +1,295 @@
 /*
  * FreeRTOS死锁检测模块
  * 提供死锁检测和自动复位功能
+ *
+ * 检测基于等待图（wait-for graph）：
+ *   任务 --等待--> 互斥量 --被持有--> 任务
+ * 任务在阻塞获取互斥量之前登记自己的等待边，并沿着等待图走一遍；
+ * 如果最终回到自身，说明本次阻塞将形成环，即发生死锁。
+ *
+ * 跟踪信息的更新都在很短的临界区内完成，不再使用额外的FreeRTOS互斥量保护，
+ * 每次加锁/解锁只在内核中多付出一次临界区的开销；
+ * 打印状态时先在临界区内复制一份一致的快照，再在临界区外慢慢输出。
+ *
+ * 锁顺序检测（configUSE_LOCK_ORDER_VALIDATION）：
+ * 记录每个任务当前持有的互斥量，获取新互斥量B时，对每个已持有的A
+ * 在位矩阵中登记 A->B 的顺序；如果已登记的顺序中存在 B->...->A 的路径，
+ * 说明加锁顺序成环（包括 B->C、C->A 这样跨越多个任务的环），
+ * 即使这次时序上没有真正死锁也立即报告。已登记过的顺序只需一次位测试，
+ * 只有第一次登记时才沿矩阵搜索路径。
+ *
+ * 死锁恢复（configDEADLOCK_RECOVERY_POLICY）：
+ * 检测到环后从环中选出一个受害任务，中止其等待（xTaskAbortDelay），
+ * 或让它释放持有的互斥量后被重新创建，其余任务不受影响地继续运行。
+ *
+ * 除普通互斥量外还跟踪递归互斥量（记录嵌套深度）、计数信号量（可以有多个持有者）
+ * 和事件组（设置过位的任务视为设置者）。对象有多个持有者时，
+ * 只有每个持有者都是当前任务、或者都无限期地阻塞在最终等待当前任务的对象上，才构成死锁。
+ *
+ * 内核钩子（configDEADLOCK_USE_KERNEL_HOOKS）：
+ * 跟踪信息改由 deadlock_trace.h 中的跟踪宏在内核内部更新，所有互斥量在创建时自动注册；
+ * 阻塞钩子运行时调度器已挂起，只做检测，打印和恢复推迟到定时器服务任务中完成。
+ *
+ * 持有时间检测（configDEADLOCK_STALL_DETECTION）：
+ * 记录持有时把单次软件定时器设置到最早的到期时间，到期时检查持有时间，超过阈值时报告停滞，
+ * 没有持有的对象时定时器不再运行。阈值可按对象设置；未设置时从持有时间直方图估计 p99，
+ * 超过 p99 的 k 倍即报告，样本不足时使用全局阈值。阈值在直方图变化时重新估计并缓存。
+ *
+ * 快照导出（configDEADLOCK_EXPORT_SNAPSHOT）：
+ * 检测到死锁或复位时，把任务状态、对象的持有/等待关系和死锁环以 JSON 和 Graphviz DOT
+ * 两种格式追加到文件，便于离线分析和画图；也可以随时调用 xDeadlockExportSnapshot 导出到缓冲区。
+ *
+ * 竞争统计（configUSE_MUTEX_STATS）：
+ * 在已有的临界区里顺带累计获取次数、阻塞次数、等待者峰值，
+ * 以及按 log2 tick 分桶的等待时间和持有时间直方图。
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include "deadlock_detection.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "event_groups.h"
+#include "timers.h"
+
+/* 计数信号量和事件组使用 sharedHolders 记录持有者 */
+#define deadlockIS_SHARED(pxInfo)   ((pxInfo)->type == eTrackedCountingSemaphore || (pxInfo)->type == eTrackedEventGroup)
+
+/* 对象删除后归还的槽位，记录已清零，遍历跟踪数组时跳过 */
+#define deadlockIS_FREE(pxInfo)     ((pxInfo)->mutex == NULL && (pxInfo)->eventGroup == NULL)
+
+/* 事件组等待条件是否已经满足 */
+#define deadlockBITS_SATISFIED(uxBits, uxBitsToWaitFor, xWaitForAllBits) \
+    (((xWaitForAllBits) != pdFALSE) ? (((uxBits) & (uxBitsToWaitFor)) == (uxBitsToWaitFor)) : (((uxBits) & (uxBitsToWaitFor)) != 0))
 
 /* 定义互斥量跟踪数组 */
 static MutexInfo_t xMutexList[configMAX_MUTEX_TRACKING];
-static SemaphoreHandle_t xMutexListLock = NULL;
 static volatile UBaseType_t uxMutexCount = 0;
 
-/* 死锁检测任务句柄 */
-static TaskHandle_t xDeadlockDetectionTaskHandle = NULL;
+/* 已删除对象归还的槽位，注册时优先复用 */
+static UBaseType_t uxFreeSlots[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxFreeSlotCount = 0;
+
+/* 用于打印的互斥量跟踪信息快照 */
+static MutexInfo_t xMutexSnapshot[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxSnapshotCount = 0;
+static TickType_t xSnapshotTime = 0;
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+
+/* 每个任务的持有栈，通过线程本地存储指针关联到任务 */
+typedef struct LockOrderTaskState
+{
+    TaskHandle_t owner;                                  /* 所属任务 */
+    UBaseType_t heldCount;                               /* 当前持有的互斥量数量 */
+    UBaseType_t held[configLOCK_ORDER_MAX_HELD];         /* 持有的互斥量槽位 */
+} LockOrderTaskState_t;
+
+static LockOrderTaskState_t xLockOrderTasks[configLOCK_ORDER_MAX_TASKS];
+static UBaseType_t uxLockOrderTaskCount = 0;
+
+/* 加锁顺序位矩阵：第 a 行第 b 位置位表示曾在持有 a 时获取 b */
+static uint8_t ucLockOrderMatrix[((configMAX_MUTEX_TRACKING * configMAX_MUTEX_TRACKING) + 7) / 8];
+static volatile UBaseType_t uxLockOrderViolations = 0;
+
+/* 顺序颠倒在临界区内只做记录，离开临界区后再打印；钩子模式下交给定时器服务任务打印 */
+#define lockorderMAX_PENDING_REPORTS    configLOCK_ORDER_MAX_HELD
+
+/* 报告中保存的已登记路径的最大长度，更长的路径省略中间部分 */
+#define lockorderMAX_REPORT_PATH        8
+
+typedef struct LockOrderReport
+{
+    char taskName[configMAX_TASK_NAME_LEN];              /* 获取互斥量的任务，打印前它可能已被删除 */
+    UBaseType_t held;                                    /* 已持有的互斥量槽位 */
+    UBaseType_t acquired;                                /* 将要获取的互斥量槽位 */
+    UBaseType_t path[lockorderMAX_REPORT_PATH];          /* 已登记的顺序 acquired->...->held 经过的槽位 */
+    UBaseType_t pathLength;                              /* 路径上的槽位数，包括两端，可能超过保存的长度 */
+} LockOrderReport_t;
+
+static LockOrderReport_t xLockOrderReports[lockorderMAX_PENDING_REPORTS];
+static UBaseType_t uxLockOrderReportCount = 0;
+static UBaseType_t uxLockOrderReportsDropped = 0;
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+static volatile BaseType_t xLockOrderReportPending = pdFALSE;
+#endif
+
+#define lockorderBIT_INDEX(a, b)    (((a) * configMAX_MUTEX_TRACKING) + (b))
+#define lockorderTEST(a, b)         ((ucLockOrderMatrix[lockorderBIT_INDEX(a, b) >> 3] >> (lockorderBIT_INDEX(a, b) & 7)) & 1)
+#define lockorderSET(a, b)          (ucLockOrderMatrix[lockorderBIT_INDEX(a, b) >> 3] |= (uint8_t)(1 << (lockorderBIT_INDEX(a, b) & 7)))
+#define lockorderCLEAR(a, b)        (ucLockOrderMatrix[lockorderBIT_INDEX(a, b) >> 3] &= (uint8_t)~(1 << (lockorderBIT_INDEX(a, b) & 7)))
+
+/* 搜索路径用的队列和前驱，只在临界区内使用；跟踪数组可能配置得很大，不放在任务栈上 */
+static UBaseType_t uxLockOrderQueue[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxLockOrderParent[configMAX_MUTEX_TRACKING];
+static uint8_t ucLockOrderVisited[(configMAX_MUTEX_TRACKING + 7) / 8];
+
+static LockOrderTaskState_t *prvGetLockOrderState(void);
+static void prvValidateLockOrder(MutexInfo_t *pxInfo);
+static void prvLockOrderPush(MutexInfo_t *pxInfo);
+static void prvLockOrderPop(MutexInfo_t *pxInfo);
+static void prvLockOrderReleaseState(void);
+static void prvLockOrderForgetSlot(UBaseType_t uxSlot);
+static BaseType_t prvLockOrderFindPath(UBaseType_t uxFrom, UBaseType_t uxTo);
+static void prvLockOrderCopyPath(LockOrderReport_t *pxReport);
+static const char *prvLockOrderName(UBaseType_t uxSlot);
+static void prvPrintLockOrderReports(void *pvUnused, uint32_t ulUnused);
+
+#endif /* configUSE_LOCK_ORDER_VALIDATION */
+
+/* 最近一次检测到的死锁环路径 */
+static MutexInfo_t *pxCyclePath[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxCycleLength = 0;
+
+/* 死锁环中每个被等待对象上、沿环继续下去的那个持有者 */
+static TaskHandle_t xCycleHolders[configMAX_MUTEX_TRACKING];
+
+/* 死锁环中的任务，第一个是检测到死锁的当前任务 */
+static TaskHandle_t xCycleTasks[configMAX_MUTEX_TRACKING];
+
+/* 可重启任务的入口信息 */
+typedef struct RestartableTask
+{
+    TaskHandle_t handle;           /* 当前任务句柄 */
+    TaskHandle_t *pxCreatedTask;   /* 调用者保存句柄的位置，重启后更新 */
+    TaskFunction_t code;           /* 任务入口函数 */
+    const char *name;              /* 任务名称 */
+    uint16_t stackDepth;           /* 栈深度 */
+    void *parameters;              /* 任务参数 */
+    UBaseType_t priority;          /* 任务优先级 */
+} RestartableTask_t;
+
+static RestartableTask_t xRestartableTasks[configDEADLOCK_MAX_RESTARTABLE_TASKS];
+static UBaseType_t uxRestartableTaskCount = 0;
+
+#if (configDEADLOCK_STALL_DETECTION == 1)
+
+/* 检查持有时间的单次定时器，只在最早的持有到期时运行，没有需要检查的持有时不再设置 */
+static TimerHandle_t xStallTimer = NULL;
+static BaseType_t xStallTimerArmed = pdFALSE;
+static TickType_t xStallTimerDeadline = 0;
+
+static void prvStallCheckCallback(TimerHandle_t xTimer);
+static void prvArmStallTimer(TickType_t xNow, TickType_t xRemaining);
+static void prvUpdateHoldLimit(MutexInfo_t *pxInfo);
+static void prvReportStall(const MutexInfo_t *pxInfo, TaskHandle_t xHolder, TickType_t xHeld,
+                           TickType_t xLimit, TickType_t xP99);
+
+#endif /* configDEADLOCK_STALL_DETECTION */
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1)
+
+/* 快照的格式化状态，缓冲区不足时只记录溢出，不再继续写入 */
+typedef struct ExportWriter
+{
+    char *buffer;
+    size_t size;
+    size_t length;
+    BaseType_t overflow;
+} ExportWriter_t;
+
+/* 导出用的快照：任务状态、对象跟踪信息和任务的等待信息在同一次调度器挂起期间获取 */
+static TaskStatus_t xExportTasks[configDEADLOCK_EXPORT_MAX_TASKS];
+static TaskWaitInfo_t xExportWaits[configDEADLOCK_EXPORT_MAX_TASKS];
+static UBaseType_t uxExportTaskCount = 0;
+static MutexInfo_t xExportObjects[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxExportObjectCount = 0;
+static TickType_t xExportTime = 0;
+
+/* 最近一次检测到的死锁环：第 i 个任务等待第 i 个对象，该对象由第 i 个持有者持有 */
+static TaskHandle_t xLastCycleTasks[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxLastCycleSlots[configMAX_MUTEX_TRACKING];
+static TaskHandle_t xLastCycleHolders[configMAX_MUTEX_TRACKING];
+static UBaseType_t uxLastCycleLength = 0;
+static TickType_t xLastCycleTime = 0;
+
+static void prvRecordLastCycle(TaskHandle_t xTask);
+static void prvCaptureExportState(void);
+static size_t prvFormatSnapshot(DeadlockExportFormat_t eFormat, char *pcBuffer, size_t xBufferSize,
+                                const char *pcReason, const char *pcTrigger);
+static void prvWriteJson(ExportWriter_t *pxWriter, const char *pcReason, const char *pcTrigger);
+static void prvWriteDot(ExportWriter_t *pxWriter, const char *pcReason, const char *pcTrigger);
+static void prvWrite(ExportWriter_t *pxWriter, const char *pcFormat, ...);
+static void prvWriteEscaped(ExportWriter_t *pxWriter, const char *pcText);
+static void prvWriteString(ExportWriter_t *pxWriter, const char *pcText);
+static void prvWriteTaskRef(ExportWriter_t *pxWriter, TaskHandle_t xTask);
+static BaseType_t prvFindExportTask(TaskHandle_t xTask);
+static BaseType_t prvIsCycleEdge(TaskHandle_t xTask, UBaseType_t uxSlot, BaseType_t xIsWait);
+
+#if (configDEADLOCK_EXPORT_ON_DETECTION == 1)
+/* 自动导出的格式化缓冲区，只在调度器挂起期间使用 */
+static char cExportBuffer[configDEADLOCK_EXPORT_BUFFER_SIZE];
+
+static void prvExportToFiles(const char *pcReason, const char *pcTrigger);
+static void prvExportFile(DeadlockExportFormat_t eFormat, const char *pcPath,
+                          const char *pcReason, const char *pcTrigger);
+#endif
+
+#endif /* configDEADLOCK_EXPORT_SNAPSHOT */
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
 
-/* 死锁检测任务的优先级和堆栈大小 */
-#define DEADLOCK_DETECTION_TASK_PRIORITY  (tskIDLE_PRIORITY + 1)
-#define DEADLOCK_DETECTION_TASK_STACK     (configMINIMAL_STACK_SIZE)
+/* 钩子模式下阻塞的任务不在包装函数的栈帧中，等待信息按任务从池中分配，等待结束或任务删除时归还 */
+static TaskWaitInfo_t xKernelWaits[configDEADLOCK_MAX_WAITING_TASKS];
+static TaskHandle_t xKernelWaitOwners[configDEADLOCK_MAX_WAITING_TASKS];
+
+/* 池耗尽而未参与检测的阻塞次数；报告推迟到定时器服务任务中，已挂起报告时不再重复挂起 */
+static volatile UBaseType_t uxKernelWaitPoolMisses = 0;
+static volatile BaseType_t xKernelWaitPoolReportPending = pdFALSE;
+
+static void prvKernelBeginWait(MutexInfo_t *pxInfo, TickType_t xTicksToWait);
+static void prvKernelEndWait(MutexInfo_t *pxInfo, BaseType_t xSucceeded);
+static void prvKernelResolveDeadlock(void *pvTask, uint32_t ulUnused);
+static void prvKernelAbortWait(void *pvTask, uint32_t ulUnused);
+static void prvKernelReleaseWaitInfo(TaskHandle_t xTask);
+static void prvKernelReportPoolExhausted(void *pvUnused, uint32_t ulUnused);
+
+#else
+
+static BaseType_t prvBeginWait(MutexInfo_t *pxInfo, TickType_t timeout, TaskWaitInfo_t *pxWaitInfo);
+
+#endif /* configDEADLOCK_USE_KERNEL_HOOKS */
 
 /* 声明所有静态函数 */
-static void prvDeadlockDetectionTask(void *pvParameters);
-static BaseType_t prvFindMutexInList(SemaphoreHandle_t mutex, UBaseType_t *puxIndex);
+static MutexInfo_t *prvRegisterObject(TrackedObjectType_t eType, SemaphoreHandle_t xSemaphore,
+                                      EventGroupHandle_t xEventGroup, const char *name);
+static MutexInfo_t *prvGetMutexInfo(SemaphoreHandle_t mutex);
+static MutexInfo_t *prvGetEventGroupInfo(EventGroupHandle_t xEventGroup);
+static void prvReleaseObject(MutexInfo_t *pxInfo);
+static BaseType_t prvTakeSemaphore(MutexInfo_t *pxInfo, SemaphoreHandle_t mutex, TickType_t timeout);
+static BaseType_t prvPublishWait(MutexInfo_t *pxInfo, TickType_t timeout, TaskWaitInfo_t *pxWaitInfo);
+static void prvEndWait(MutexInfo_t *pxInfo, TaskWaitInfo_t *pxWaitInfo, BaseType_t xSucceeded);
+static void prvRecordAcquire(MutexInfo_t *pxInfo);
+static void prvRecordRelease(MutexInfo_t *pxInfo);
+static void prvRecordSetter(MutexInfo_t *pxInfo);
+static void prvAddSharedHolder(MutexInfo_t *pxInfo, TaskHandle_t xTask, TickType_t xNow);
+static BaseType_t prvRemoveSharedHolder(MutexInfo_t *pxInfo, TaskHandle_t xTask, TickType_t *pxAcquireTime);
+static UBaseType_t prvGetHolderCount(const MutexInfo_t *pxInfo);
+static TaskHandle_t prvGetHolder(const MutexInfo_t *pxInfo, UBaseType_t uxIndex);
+static TickType_t prvGetHolderTime(const MutexInfo_t *pxInfo, UBaseType_t uxIndex);
+static BaseType_t prvHoldsObject(const MutexInfo_t *pxInfo, TaskHandle_t xTask);
+#if (configDEADLOCK_VICTIM_SELECTION == deadlockVICTIM_SHORTEST_HOLD)
+static TickType_t prvGetHoldStart(const MutexInfo_t *pxInfo, TaskHandle_t xTask);
+#endif
+static BaseType_t prvObjectWaitsOnTask(MutexInfo_t *pxObject, TaskHandle_t xTarget, UBaseType_t uxDepth);
+static void prvTakeMutexSnapshot(void);
+static TaskWaitInfo_t *prvGetTaskWaitInfo(TaskHandle_t xTask);
+static BaseType_t prvDetectWaitForCycle(TaskHandle_t xTask, MutexInfo_t *pxWaitMutex);
+static void prvPrintWaitForCycle(TaskHandle_t xTask);
+static void prvReportDeadlock(TaskHandle_t xTask);
 static void prvPrintTaskHeldMutexes(TaskHandle_t xTask);
+static void prvResolveDeadlock(TaskHandle_t xTask, TaskWaitInfo_t *pxTaskWait);
+static TaskHandle_t prvSelectVictim(UBaseType_t uxTaskCount);
+static RestartableTask_t *prvFindRestartableTask(TaskHandle_t xTask);
+static void prvRestartCurrentTask(void);
+
+#if (configUSE_MUTEX_STATS == 1)
+static UBaseType_t prvHistogramBucket(TickType_t xTicks);
+static void prvRecordHoldTime(MutexInfo_t *pxInfo, TickType_t xHeld);
+#endif
 
 /**
  * 初始化死锁检测模块
@@ -36,21 +299,48 @@ void vDeadlockDetectionInit(void)
     /* 清空互斥量跟踪数组 */
     memset(xMutexList, 0, sizeof(xMutexList));
     
-    /* 创建保护互斥量列表的锁 */
-    xMutexListLock = xSemaphoreCreateMutex();
-    configASSERT(xMutexListLock != NULL);
-    
     /* 初始化状态 */
     uxMutexCount = 0;
+    uxFreeSlotCount = 0;
+    uxCycleLength = 0;
+    uxRestartableTaskCount = 0;
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    memset(xLockOrderTasks, 0, sizeof(xLockOrderTasks));
+    memset(ucLockOrderMatrix, 0, sizeof(ucLockOrderMatrix));
+    uxLockOrderTaskCount = 0;
+    uxLockOrderViolations = 0;
+    uxLockOrderReportCount = 0;
+    uxLockOrderReportsDropped = 0;
+#endif
+
+#if (configDEADLOCK_STALL_DETECTION == 1)
+    /* 周期在每次设置时重新指定，记录第一次持有时才启动 */
+    if (xStallTimer == NULL)
+    {
+        xStallTimer = xTimerCreate("DLStall", 1, pdFALSE, NULL, prvStallCheckCallback);
+    }
+    xStallTimerArmed = pdFALSE;
     
-    /* 启动死锁检测任务 */
-    vStartDeadlockDetectionTask();
+    if (xStallTimer == NULL)
+    {
+        printf("持有时间检测: 无法创建检查定时器\r\n");
+    }
+#endif
 }
 
 /**
  * 创建互斥量并注册到死锁检测模块
  */
 SemaphoreHandle_t xCreateMutexWithDeadlockDetection(const char *name)
+{
+    return xCreateMutexWithHoldLimit(name, deadlockHOLD_LIMIT_DEFAULT);
+}
+
+/**
+ * 创建互斥量并注册到死锁检测模块，同时设置持有时间阈值
+ */
+SemaphoreHandle_t xCreateMutexWithHoldLimit(const char *name, TickType_t xHoldLimit)
 {
     SemaphoreHandle_t xNewMutex = NULL;
     
@@ -60,292 +350,2868 @@ SemaphoreHandle_t xCreateMutexWithDeadlockDetection(const char *name)
     /* 确保创建成功 */
     if (xNewMutex != NULL)
     {
-        /* 获取访问互斥量列表的锁 */
-        if (xMutexListLock != NULL && xSemaphoreTake(xMutexListLock, portMAX_DELAY) == pdTRUE)
-        {
-            /* 检查是否有空间添加新的互斥量 */
-            if (uxMutexCount < configMAX_MUTEX_TRACKING)
-            {
-                /* 注册到跟踪数组 */
-                xMutexList[uxMutexCount].mutex = xNewMutex;
-                xMutexList[uxMutexCount].holder = NULL;
-                xMutexList[uxMutexCount].acquireTime = 0;
-                xMutexList[uxMutexCount].mutexName = name;
-                
-                uxMutexCount++;
-            }
-            else
-            {
-                /* 没有足够空间跟踪这个互斥量 */
-                printf("警告: 互斥量跟踪数组已满，无法注册新互斥量\r\n");
-            }
-            
-            /* 释放互斥量列表的锁 */
-            xSemaphoreGive(xMutexListLock);
-        }
+        (void)prvRegisterObject(eTrackedMutex, xNewMutex, NULL, name);
+        (void)xDeadlockSetHoldLimit(xNewMutex, xHoldLimit);
     }
     
     return xNewMutex;
 }
 
 /**
- * 使用超时参数获取互斥量
+ * 修改已注册对象的持有时间阈值
  */
-BaseType_t xTakeMutexWithDeadlockDetection(SemaphoreHandle_t mutex, TickType_t timeout)
+BaseType_t xDeadlockSetHoldLimit(SemaphoreHandle_t mutex, TickType_t xHoldLimit)
 {
-    BaseType_t xResult;
-    UBaseType_t uxIndex;
+    MutexInfo_t *pxInfo = prvGetMutexInfo(mutex);
     
-    /* 尝试获取互斥量 */
-    xResult = xSemaphoreTake(mutex, timeout);
+    if (pxInfo == NULL)
+    {
+        return pdFALSE;
+    }
     
-    if (xResult == pdTRUE)
+    taskENTER_CRITICAL();
     {
-        /* 成功获取互斥量，更新跟踪信息 */
-        if (xMutexListLock != NULL && xSemaphoreTake(xMutexListLock, portMAX_DELAY) == pdTRUE)
+        pxInfo->holdLimit = xHoldLimit;
+
+#if (configDEADLOCK_STALL_DETECTION == 1)
+        prvUpdateHoldLimit(pxInfo);
+        
+        /* 正在持有时按新阈值尽快检查一次，由定时器回调算出下一次检查的时间 */
+        if (prvGetHolderCount(pxInfo) > 0 && pxInfo->type != eTrackedEventGroup)
         {
-            /* 查找互斥量在列表中的位置 */
-            if (prvFindMutexInList(mutex, &uxIndex) == pdTRUE)
-            {
-                /* 更新持有者和获取时间 */
-                xMutexList[uxIndex].holder = xTaskGetCurrentTaskHandle();
-                xMutexList[uxIndex].acquireTime = xTaskGetTickCount();
-            }
-            
-            /* 释放互斥量列表的锁 */
-            xSemaphoreGive(xMutexListLock);
+            prvArmStallTimer(xTaskGetTickCount(), 1);
         }
+#endif
     }
+    taskEXIT_CRITICAL();
     
-    return xResult;
+    return pdTRUE;
 }
 
 /**
- * 释放互斥量
+ * 创建递归互斥量并注册到死锁检测模块
  */
-BaseType_t xGiveMutexWithDeadlockDetection(SemaphoreHandle_t mutex)
+SemaphoreHandle_t xCreateRecursiveMutexWithDeadlockDetection(const char *name)
 {
-    BaseType_t xResult;
-    UBaseType_t uxIndex;
+    SemaphoreHandle_t xNewMutex = xSemaphoreCreateRecursiveMutex();
     
-    /* 尝试释放互斥量 */
-    xResult = xSemaphoreGive(mutex);
-    
-    if (xResult == pdTRUE)
+    if (xNewMutex != NULL)
     {
-        /* 成功释放互斥量，更新跟踪信息 */
-        if (xMutexListLock != NULL && xSemaphoreTake(xMutexListLock, portMAX_DELAY) == pdTRUE)
-        {
-            /* 查找互斥量在列表中的位置 */
-            if (prvFindMutexInList(mutex, &uxIndex) == pdTRUE)
-            {
-                /* 清除持有者和获取时间 */
-                xMutexList[uxIndex].holder = NULL;
-                xMutexList[uxIndex].acquireTime = 0;
-            }
-            
-            /* 释放互斥量列表的锁 */
-            xSemaphoreGive(xMutexListLock);
-        }
+        (void)prvRegisterObject(eTrackedRecursiveMutex, xNewMutex, NULL, name);
     }
     
-    return xResult;
+    return xNewMutex;
 }
 
 /**
- * 开始死锁检测任务
+ * 创建计数信号量并注册到死锁检测模块
  */
-void vStartDeadlockDetectionTask(void)
+SemaphoreHandle_t xCreateCountingSemaphoreWithDeadlockDetection(const char *name,
+                                                                UBaseType_t uxMaxCount,
+                                                                UBaseType_t uxInitialCount)
 {
-#if (configENABLE_DEADLOCK_DETECTION == 1)
-    /* 创建死锁检测任务 */
-    xTaskCreate(prvDeadlockDetectionTask,
-                "DeadlockDet",
-                DEADLOCK_DETECTION_TASK_STACK,
-                NULL,
-                DEADLOCK_DETECTION_TASK_PRIORITY,
-                &xDeadlockDetectionTaskHandle);
-                
-    configASSERT(xDeadlockDetectionTaskHandle != NULL);
-#endif
+    SemaphoreHandle_t xNewSemaphore = xSemaphoreCreateCounting(uxMaxCount, uxInitialCount);
+    
+    if (xNewSemaphore != NULL)
+    {
+        (void)prvRegisterObject(eTrackedCountingSemaphore, xNewSemaphore, NULL, name);
+    }
+    
+    return xNewSemaphore;
 }
 
 /**
- * 打印指定任务持有的所有互斥量
- * @param xTask 要检查的任务句柄
+ * 创建事件组并注册到死锁检测模块
  */
-static void prvPrintTaskHeldMutexes(TaskHandle_t xTask)
+EventGroupHandle_t xCreateEventGroupWithDeadlockDetection(const char *name)
 {
-    const char *pcTaskName = pcTaskGetName(xTask);
-    UBaseType_t uxHeldCount = 0;
+    EventGroupHandle_t xNewEventGroup = xEventGroupCreate();
     
-    printf("任务 %s 持有的互斥量列表:\r\n", pcTaskName);
+    if (xNewEventGroup != NULL)
+    {
+        (void)prvRegisterObject(eTrackedEventGroup, NULL, xNewEventGroup, name);
+    }
     
-    /* 检查所有互斥量 */
-    for (UBaseType_t i = 0; i < uxMutexCount; i++)
+    return xNewEventGroup;
+}
+
+/**
+ * 把新创建的对象登记到跟踪数组
+ * @param eType 对象类型
+ * @param xSemaphore 互斥量/信号量句柄，事件组时为NULL
+ * @param xEventGroup 事件组句柄，其他类型时为NULL
+ * @param name 对象名称
+ * @return 跟踪信息，跟踪数组已满时返回NULL
+ */
+static MutexInfo_t *prvRegisterObject(TrackedObjectType_t eType, SemaphoreHandle_t xSemaphore,
+                                      EventGroupHandle_t xEventGroup, const char *name)
+{
+    MutexInfo_t *pxInfo = NULL;
+    
+    taskENTER_CRITICAL();
     {
-        if (xMutexList[i].holder == xTask)
+        /* 内核钩子已经在创建时注册过互斥量，只需补上名称 */
+        pxInfo = (xSemaphore != NULL) ? prvGetMutexInfo(xSemaphore) : NULL;
+        if (pxInfo != NULL)
+        {
+            pxInfo->mutexName = name;
+        }
+        /* 检查是否有空间添加新的对象 */
+        else if (uxFreeSlotCount > 0 || uxMutexCount < configMAX_MUTEX_TRACKING)
         {
-            printf("  - %s (持有时间: %u ms)\r\n", 
-                  xMutexList[i].mutexName != NULL ? xMutexList[i].mutexName : "未命名",
-                  (unsigned int)((xTaskGetTickCount() - xMutexList[i].acquireTime) * portTICK_PERIOD_MS));
-            uxHeldCount++;
+            /* 优先复用已删除对象归还的槽位 */
+            UBaseType_t uxSlot = (uxFreeSlotCount > 0) ? uxFreeSlots[--uxFreeSlotCount] : uxMutexCount;
+            
+            /* 注册到跟踪数组 */
+            pxInfo = &xMutexList[uxSlot];
+            memset(pxInfo, 0, sizeof(MutexInfo_t));
+            pxInfo->type = eType;
+            pxInfo->mutex = xSemaphore;
+            pxInfo->eventGroup = xEventGroup;
+            pxInfo->mutexName = name;
+#if (configDEADLOCK_STALL_DETECTION == 1)
+            prvUpdateHoldLimit(pxInfo);
+#endif
+            
+            /* 把跟踪槽位号（从1开始）记录在对象自身上，实现O(1)查找 */
+            if (xEventGroup != NULL)
+            {
+                vEventGroupSetNumber(xEventGroup, uxSlot + 1);
+            }
+            else
+            {
+                vQueueSetQueueNumber(xSemaphore, uxSlot + 1);
+            }
+            
+            /* 记录填写完整后再发布，查找时无需加锁 */
+            if (uxSlot == uxMutexCount)
+            {
+                uxMutexCount++;
+            }
         }
     }
+    taskEXIT_CRITICAL();
     
-    if (uxHeldCount == 0)
+    if (pxInfo == NULL)
     {
-        printf("  没有持有任何互斥量\r\n");
+        /* 没有足够空间跟踪这个对象 */
+        printf("警告: 互斥量跟踪数组已满，无法注册 %s\r\n", name != NULL ? name : "未命名");
     }
+    
+    return pxInfo;
 }
 
 /**
- * 复位系统（在检测到死锁时调用）
+ * 对象即将被删除，清除它的跟踪记录、指向它的等待边和加锁顺序，并归还槽位供以后注册的对象复用
+ * @param pxInfo 被删除对象的跟踪信息
  */
-void vDeadlockSystemReset(void)
+static void prvReleaseObject(MutexInfo_t *pxInfo)
 {
-    const char *pcCurrentTaskName = pcTaskGetName(xTaskGetCurrentTaskHandle());
-    TaskHandle_t xInvolvedTasks[configMAX_MUTEX_TRACKING] = {NULL};
-    UBaseType_t uxInvolvedTaskCount = 0;
-    
-    /* 打印死锁警告 */
-    printf("检测到死锁！系统将重置...（触发任务: %s）\r\n", pcCurrentTaskName);
+    UBaseType_t uxSlot = (UBaseType_t)(pxInfo - xMutexList);
     
-    /* 收集所有持有互斥量的任务 */
-    for (UBaseType_t i = 0; i < uxMutexCount; i++)
+    taskENTER_CRITICAL();
     {
-        if (xMutexList[i].holder != NULL)
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+        /* 删除事件组会唤醒它的等待者，它们的等待结束钩子已经找不到这个对象，在这里归还等待信息 */
+        for (UBaseType_t i = 0; i < configDEADLOCK_MAX_WAITING_TASKS; i++)
         {
-            /* 检查这个任务是否已经在列表中 */
-            BaseType_t xFound = pdFALSE;
-            for (UBaseType_t j = 0; j < uxInvolvedTaskCount; j++)
-            {
-                if (xInvolvedTasks[j] == xMutexList[i].holder)
-                {
-                    xFound = pdTRUE;
-                    break;
-                }
-            }
-            
-            /* 如果任务不在列表中，添加它 */
-            if (xFound == pdFALSE && uxInvolvedTaskCount < configMAX_MUTEX_TRACKING)
+            if (xKernelWaitOwners[i] != NULL && xKernelWaits[i].waitingFor == pxInfo)
             {
-                xInvolvedTasks[uxInvolvedTaskCount++] = xMutexList[i].holder;
+                vTaskSetThreadLocalStoragePointer(xKernelWaitOwners[i], configDEADLOCK_TLS_INDEX, NULL);
+                xKernelWaitOwners[i] = NULL;
             }
         }
+#endif
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+        prvLockOrderForgetSlot(uxSlot);
+#endif
+
+        /* 清零后 mutex 和 eventGroup 都为NULL，按句柄查找不会再命中这个槽位 */
+        memset(pxInfo, 0, sizeof(MutexInfo_t));
+        uxFreeSlots[uxFreeSlotCount++] = uxSlot;
     }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 使用超时参数获取互斥量
+ */
+BaseType_t xTakeMutexWithDeadlockDetection(SemaphoreHandle_t mutex, TickType_t timeout)
+{
+    BaseType_t xResult;
+    MutexInfo_t *pxInfo;
+    TaskWaitInfo_t xWaitInfo;
     
-    /* 打印所有被锁定的互斥量状态 */
-    printf("死锁相关的互斥量状态:\r\n");
-    for (UBaseType_t i = 0; i < uxMutexCount; i++)
+    /* 查找互斥量的跟踪信息 */
+    pxInfo = prvGetMutexInfo(mutex);
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+    /* 跟踪信息由内核钩子维护，这里只需按类型选择获取接口 */
+    (void)xWaitInfo;
+    return prvTakeSemaphore(pxInfo, mutex, timeout);
+#else
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    /* 在尝试获取之前检查加锁顺序，不依赖时序是否真的造成死锁；
+     * 计数信号量不是锁，递归获取已持有的互斥量也不产生新的顺序 */
+    if (pxInfo != NULL && pxInfo->type != eTrackedCountingSemaphore &&
+        pxInfo->holder != xTaskGetCurrentTaskHandle())
     {
-        if (xMutexList[i].holder != NULL)
+        prvValidateLockOrder(pxInfo);
+    }
+#endif
+
+    /* 先尝试不阻塞地获取互斥量，无竞争时不需要检查等待图 */
+    xResult = prvTakeSemaphore(pxInfo, mutex, 0);
+    
+    if (xResult != pdTRUE && timeout != 0 && pxInfo != NULL)
+    {
+        /* 当前任务自己被选为受害者时不再阻塞，直接返回失败 */
+        if (prvBeginWait(pxInfo, timeout, &xWaitInfo) == pdTRUE)
         {
-            printf("互斥量 %s 被任务 %s 持有 (持有时间: %u ms)\r\n", 
-                   xMutexList[i].mutexName != NULL ? xMutexList[i].mutexName : "未命名",
-                   pcTaskGetName(xMutexList[i].holder),
-                   (unsigned int)((xTaskGetTickCount() - xMutexList[i].acquireTime) * portTICK_PERIOD_MS));
+            xResult = prvTakeSemaphore(pxInfo, mutex, timeout);
         }
+        
+        prvEndWait(pxInfo, &xWaitInfo, xResult);
+    }
+    else if (xResult != pdTRUE && timeout != 0)
+    {
+        /* 未被跟踪的互斥量，直接阻塞等待 */
+        xResult = xSemaphoreTake(mutex, timeout);
     }
     
-    /* 打印每个相关任务持有的所有互斥量 */
-    printf("\n相关任务持有的互斥量详情:\r\n");
-    for (UBaseType_t i = 0; i < uxInvolvedTaskCount; i++)
+    if (xResult == pdTRUE && pxInfo != NULL)
     {
-        prvPrintTaskHeldMutexes(xInvolvedTasks[i]);
+        /* 成功获取互斥量，更新跟踪信息 */
+        prvRecordAcquire(pxInfo);
     }
     
-    /* 在实际的嵌入式系统中，这里应该调用系统复位函数 */
-    /* 在模拟环境中，我们直接退出程序 */
-    printf("模拟系统复位...\r\n");
-    fflush(stdout);
+    return xResult;
+#endif /* configDEADLOCK_USE_KERNEL_HOOKS */
+}
+
+/**
+ * 释放互斥量
+ */
+BaseType_t xGiveMutexWithDeadlockDetection(SemaphoreHandle_t mutex)
+{
+    BaseType_t xResult;
+    MutexInfo_t *pxInfo;
     
-    /* 退出程序 - 模拟系统复位 */
-    exit(0);
+    pxInfo = prvGetMutexInfo(mutex);
+    
+    /* 尝试释放互斥量 */
+    if (pxInfo != NULL && pxInfo->type == eTrackedRecursiveMutex)
+    {
+        xResult = xSemaphoreGiveRecursive(mutex);
+    }
+    else
+    {
+        xResult = xSemaphoreGive(mutex);
+    }
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+    if (xResult == pdTRUE && pxInfo != NULL)
+    {
+        /* 成功释放互斥量，更新跟踪信息 */
+        prvRecordRelease(pxInfo);
+    }
+#endif
+
+    return xResult;
 }
 
 /**
- * 死锁检测任务
+ * 等待事件组中的位
  */
-static void prvDeadlockDetectionTask(void *pvParameters)
+EventBits_t xEventGroupWaitBitsWithDeadlockDetection(EventGroupHandle_t xEventGroup,
+                                                     const EventBits_t uxBitsToWaitFor,
+                                                     const BaseType_t xClearOnExit,
+                                                     const BaseType_t xWaitForAllBits,
+                                                     TickType_t xTicksToWait)
 {
-    TickType_t xCurrentTime;
+    EventBits_t uxBits;
+    MutexInfo_t *pxInfo;
+    TaskWaitInfo_t xWaitInfo;
     
-    /* 避免编译器警告 */
-    (void)pvParameters;
+    pxInfo = prvGetEventGroupInfo(xEventGroup);
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+    /* 跟踪信息由内核钩子维护 */
+    (void)pxInfo;
+    (void)xWaitInfo;
+    return xEventGroupWaitBits(xEventGroup, uxBitsToWaitFor, xClearOnExit, xWaitForAllBits, xTicksToWait);
+#else
+
+    /* 先不阻塞地检查，条件已经满足时不需要检查等待图 */
+    uxBits = xEventGroupWaitBits(xEventGroup, uxBitsToWaitFor, xClearOnExit, xWaitForAllBits, 0);
     
-    for (;;)
+    if (!deadlockBITS_SATISFIED(uxBits, uxBitsToWaitFor, xWaitForAllBits) && xTicksToWait != 0)
     {
-        /* 每秒检查一次 */
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        
-        /* 获取当前时间 */
-        xCurrentTime = xTaskGetTickCount();
-        
-        /* 获取访问互斥量列表的锁 */
-        if (xMutexListLock != NULL && xSemaphoreTake(xMutexListLock, portMAX_DELAY) == pdTRUE)
+        if (pxInfo != NULL)
         {
-            /* 检查所有被跟踪的互斥量 */
-            for (UBaseType_t i = 0; i < uxMutexCount; i++)
+            if (prvBeginWait(pxInfo, xTicksToWait, &xWaitInfo) == pdTRUE)
             {
-                /* 检查是否有任务持有这个互斥量 */
-                if (xMutexList[i].holder != NULL)
-                {
-                    /* 计算持有时间 */
-                    TickType_t xHoldTime = xCurrentTime - xMutexList[i].acquireTime;
-                    
-                    /* 检查是否超过超时时间 */
-                    if (xHoldTime > configDEADLOCK_DETECTION_TIMEOUT)
-                    {
-                        /* 获取任务名称 */
-                        const char *pcHolderTaskName = pcTaskGetName(xMutexList[i].holder);
-                        const char *pcCurrentTaskName = pcTaskGetName(xTaskGetCurrentTaskHandle());
-                        
-                        /* 打印死锁警告 */
-                        printf("死锁检测: 互斥量 %s 被任务 %s 持有超过 %u 毫秒，当前任务 %s 正在等待或检测\r\n",
-                               xMutexList[i].mutexName != NULL ? xMutexList[i].mutexName : "未命名",
-                               pcHolderTaskName,
-                               (unsigned int)(xHoldTime * portTICK_PERIOD_MS),
-                               pcCurrentTaskName);
-                        
-                        /* 打印持有者任务持有的所有互斥量 */
-                        prvPrintTaskHeldMutexes(xMutexList[i].holder);
-                        
-                        /* 释放互斥量列表的锁 */
-                        xSemaphoreGive(xMutexListLock);
-                        
-                        /* 触发系统复位 */
-                        vDeadlockSystemReset();
-                        
-                        /* 退出循环 */
-                        break;
-                    }
-                }
+                uxBits = xEventGroupWaitBits(xEventGroup, uxBitsToWaitFor, xClearOnExit, xWaitForAllBits, xTicksToWait);
             }
             
-            /* 释放互斥量列表的锁 */
-            xSemaphoreGive(xMutexListLock);
+            prvEndWait(pxInfo, &xWaitInfo, deadlockBITS_SATISFIED(uxBits, uxBitsToWaitFor, xWaitForAllBits) ? pdTRUE : pdFALSE);
         }
+        else
+        {
+            /* 未被跟踪的事件组，直接阻塞等待 */
+            uxBits = xEventGroupWaitBits(xEventGroup, uxBitsToWaitFor, xClearOnExit, xWaitForAllBits, xTicksToWait);
+        }
+    }
+
+#if (configUSE_MUTEX_STATS == 1)
+    if (pxInfo != NULL && deadlockBITS_SATISFIED(uxBits, uxBitsToWaitFor, xWaitForAllBits))
+    {
+        taskENTER_CRITICAL();
+        {
+            pxInfo->stats.acquireCount++;
+        }
+        taskEXIT_CRITICAL();
     }
+#endif
+
+    return uxBits;
+#endif /* configDEADLOCK_USE_KERNEL_HOOKS */
 }
 
 /**
- * 查找互斥量在列表中的位置
+ * 设置事件组中的位，并把当前任务登记为设置者
  */
-static BaseType_t prvFindMutexInList(SemaphoreHandle_t mutex, UBaseType_t *puxIndex)
+EventBits_t xEventGroupSetBitsWithDeadlockDetection(EventGroupHandle_t xEventGroup,
+                                                    const EventBits_t uxBitsToSet)
 {
-    BaseType_t xFound = pdFALSE;
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo(xEventGroup);
     
-    /* 遍历互斥量列表 */
-    for (UBaseType_t i = 0; i < uxMutexCount; i++)
+    /* 先登记再设置，被唤醒的等待者下次阻塞时就能看到这个设置者 */
+    if (pxInfo != NULL)
     {
-        if (xMutexList[i].mutex == mutex)
-        {
-            *puxIndex = i;
-            xFound = pdTRUE;
-            break;
-        }
+        prvRecordSetter(pxInfo);
+    }
+#endif
+
+    return xEventGroupSetBits(xEventGroup, uxBitsToSet);
+}
+
+/**
+ * 删除互斥量、递归互斥量或计数信号量，并归还它的跟踪槽位
+ */
+void vDeleteMutexWithDeadlockDetection(SemaphoreHandle_t mutex)
+{
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+    MutexInfo_t *pxInfo = prvGetMutexInfo(mutex);
+    
+    if (pxInfo != NULL)
+    {
+        prvReleaseObject(pxInfo);
+    }
+#endif
+
+    /* 钩子模式下由 traceQUEUE_DELETE 归还槽位 */
+    vSemaphoreDelete(mutex);
+}
+
+/**
+ * 删除事件组，并归还它的跟踪槽位
+ */
+void vDeleteEventGroupWithDeadlockDetection(EventGroupHandle_t xEventGroup)
+{
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo(xEventGroup);
+    
+    if (pxInfo != NULL)
+    {
+        prvReleaseObject(pxInfo);
+    }
+#endif
+
+    /* 钩子模式下由 traceEVENT_GROUP_DELETE 归还槽位 */
+    vEventGroupDelete(xEventGroup);
+}
+
+/**
+ * 把当前任务登记为事件组的设置者，已经登记过时只更新最近设置时间
+ * @param pxInfo 事件组跟踪信息
+ */
+static void prvRecordSetter(MutexInfo_t *pxInfo)
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    TickType_t xNow = xTaskGetTickCount();
+    
+    if (xCurrentTask == NULL)
+    {
+        return;
+    }
+    
+    taskENTER_CRITICAL();
+    {
+        UBaseType_t i;
+        
+        for (i = 0; i < pxInfo->sharedHolderCount; i++)
+        {
+            if (pxInfo->sharedHolders[i] == xCurrentTask)
+            {
+                pxInfo->sharedAcquireTimes[i] = xNow;
+                break;
+            }
+        }
+        
+        if (i == pxInfo->sharedHolderCount)
+        {
+            prvAddSharedHolder(pxInfo, xCurrentTask, xNow);
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 按对象类型获取互斥量或信号量
+ * @param pxInfo 跟踪信息，未被跟踪时为NULL
+ * @param mutex 互斥量句柄
+ * @param timeout 超时时间
+ * @return pdTRUE 成功获取，pdFALSE 获取失败
+ */
+static BaseType_t prvTakeSemaphore(MutexInfo_t *pxInfo, SemaphoreHandle_t mutex, TickType_t timeout)
+{
+    if (pxInfo != NULL && pxInfo->type == eTrackedRecursiveMutex)
+    {
+        return xSemaphoreTakeRecursive(mutex, timeout);
+    }
+    
+    return xSemaphoreTake(mutex, timeout);
+}
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+
+/**
+ * 登记等待边并检查本次阻塞是否会形成环，形成环时打印并按恢复策略处理
+ *
+ * @param pxInfo 将要等待的对象
+ * @param timeout 等待超时时间
+ * @param pxWaitInfo 当前任务栈上的等待信息，等待结束后交给 prvEndWait
+ * @return pdTRUE 应当阻塞等待，pdFALSE 当前任务被选为受害者，不再阻塞
+ */
+static BaseType_t prvBeginWait(MutexInfo_t *pxInfo, TickType_t timeout, TaskWaitInfo_t *pxWaitInfo)
+{
+    if (prvPublishWait(pxInfo, timeout, pxWaitInfo) == pdTRUE)
+    {
+        /* 报告死锁环并按恢复策略处理 */
+        prvReportDeadlock(xTaskGetCurrentTaskHandle());
+        prvResolveDeadlock(xTaskGetCurrentTaskHandle(), pxWaitInfo);
+    }
+    
+    return (pxWaitInfo->recoveryAction == -1) ? pdTRUE : pdFALSE;
+}
+
+#endif /* configDEADLOCK_USE_KERNEL_HOOKS */
+
+/**
+ * 填写当前任务的等待信息，通过线程本地存储指针发布等待边，并检查本次阻塞是否会形成环
+ *
+ * @param pxInfo 将要等待的对象
+ * @param timeout 等待超时时间
+ * @param pxWaitInfo 当前任务的等待信息
+ * @return pdTRUE 形成环（死锁），pdFALSE 未形成环
+ */
+static BaseType_t prvPublishWait(MutexInfo_t *pxInfo, TickType_t timeout, TaskWaitInfo_t *pxWaitInfo)
+{
+    BaseType_t xDeadlock = pdFALSE;
+    
+    pxWaitInfo->waitingFor = pxInfo;
+    pxWaitInfo->waitStartTime = xTaskGetTickCount();
+    pxWaitInfo->timeout = timeout;
+    pxWaitInfo->recoveryAction = -1;
+    
+    /* 登记等待边并检查本次阻塞是否会形成环 */
+    taskENTER_CRITICAL();
+    {
+        vTaskSetThreadLocalStoragePointer(NULL, configDEADLOCK_TLS_INDEX, pxWaitInfo);
+
+#if (configUSE_MUTEX_STATS == 1)
+        pxInfo->stats.contendedCount++;
+        if (++pxInfo->stats.currentWaiters > pxInfo->stats.maxWaiters)
+        {
+            pxInfo->stats.maxWaiters = pxInfo->stats.currentWaiters;
+        }
+#endif
+
+#if (configENABLE_DEADLOCK_DETECTION == 1)
+        xDeadlock = prvDetectWaitForCycle(xTaskGetCurrentTaskHandle(), pxInfo);
+#endif
+    }
+    taskEXIT_CRITICAL();
+    
+    return xDeadlock;
+}
+
+/**
+ * 等待结束，移除等待边；被选为重启的受害任务在这里被重启，不会返回
+ *
+ * @param pxInfo 等待的对象
+ * @param pxWaitInfo prvBeginWait 登记的等待信息
+ * @param xSucceeded 等待是否成功
+ */
+static void prvEndWait(MutexInfo_t *pxInfo, TaskWaitInfo_t *pxWaitInfo, BaseType_t xSucceeded)
+{
+#if (configUSE_MUTEX_STATS == 1)
+    /* 移除等待边并记录等待时间 */
+    taskENTER_CRITICAL();
+    {
+        vTaskSetThreadLocalStoragePointer(NULL, configDEADLOCK_TLS_INDEX, NULL);
+        
+        /* 等待期间对象被删除时记录已经清零，不再统计 */
+        if (pxInfo->stats.currentWaiters > 0)
+        {
+            pxInfo->stats.currentWaiters--;
+            pxInfo->stats.waitHistogram[prvHistogramBucket(xTaskGetTickCount() - pxWaitInfo->waitStartTime)]++;
+        }
+    }
+    taskEXIT_CRITICAL();
+#else
+    /* 移除等待边，自己的指针只有自己写，无需临界区 */
+    (void)pxInfo;
+    vTaskSetThreadLocalStoragePointer(NULL, configDEADLOCK_TLS_INDEX, NULL);
+#endif
+
+    if (xSucceeded != pdTRUE && pxWaitInfo->recoveryAction == deadlockRECOVERY_RESTART_TASK)
+    {
+        prvRestartCurrentTask();
+    }
+}
+
+/**
+ * 记录当前任务获取了互斥量
+ * @param pxInfo 互斥量跟踪信息
+ */
+static void prvRecordAcquire(MutexInfo_t *pxInfo)
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    TickType_t xNow = xTaskGetTickCount();
+    BaseType_t xFirstAcquire = pdTRUE;
+    
+    /* 持有者和获取时间一起更新，快照中不会出现新持有者配旧时间 */
+    taskENTER_CRITICAL();
+    {
+        if (pxInfo->type == eTrackedCountingSemaphore)
+        {
+            if (pxInfo->sharedHolderCount == 0)
+            {
+                pxInfo->stallReported = pdFALSE;
+            }
+            prvAddSharedHolder(pxInfo, xCurrentTask, xNow);
+        }
+        else if (pxInfo->holder == xCurrentTask)
+        {
+            /* 递归获取，只增加嵌套深度，持有时间从第一次获取算起 */
+            pxInfo->recursionDepth++;
+            xFirstAcquire = pdFALSE;
+        }
+        else
+        {
+            pxInfo->holder = xCurrentTask;
+            pxInfo->acquireTime = xNow;
+            pxInfo->recursionDepth = 1;
+            pxInfo->stallReported = pdFALSE;
+        }
+#if (configUSE_MUTEX_STATS == 1)
+        pxInfo->stats.acquireCount++;
+#endif
+
+#if (configDEADLOCK_STALL_DETECTION == 1)
+        /* 持有时间超过阈值的下一个 tick 需要检查，比已设置的检查更早时提前定时器 */
+        if (xFirstAcquire == pdTRUE && pxInfo->stallReported == pdFALSE &&
+            pxInfo->stallLimit != deadlockHOLD_LIMIT_NONE)
+        {
+            prvArmStallTimer(xNow, pxInfo->stallLimit + 1);
+        }
+#endif
+    }
+    taskEXIT_CRITICAL();
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    if (xFirstAcquire == pdTRUE && pxInfo->type != eTrackedCountingSemaphore)
+    {
+        prvLockOrderPush(pxInfo);
+    }
+#else
+    (void)xFirstAcquire;
+#endif
+}
+
+/**
+ * 记录当前任务释放了互斥量或信号量
+ * @param pxInfo 跟踪信息
+ */
+static void prvRecordRelease(MutexInfo_t *pxInfo)
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    TickType_t xAcquireTime;
+    BaseType_t xFinalRelease = pdFALSE;
+    
+    taskENTER_CRITICAL();
+    {
+        if (pxInfo->type == eTrackedCountingSemaphore)
+        {
+            /* 没有获取过信号量的任务释放它（用作通知）时不改变持有者 */
+            if (prvRemoveSharedHolder(pxInfo, xCurrentTask, &xAcquireTime) == pdTRUE)
+            {
+#if (configUSE_MUTEX_STATS == 1)
+                prvRecordHoldTime(pxInfo, xTaskGetTickCount() - xAcquireTime);
+#endif
+            }
+        }
+        else if (pxInfo->holder != xCurrentTask)
+        {
+            /* 释放后被唤醒的等待者已经登记为新的持有者，此时不能清除，
+             * 但这一定是当前任务的最后一次释放 */
+            xFinalRelease = pdTRUE;
+        }
+        else if (--pxInfo->recursionDepth == 0)
+        {
+#if (configUSE_MUTEX_STATS == 1)
+            prvRecordHoldTime(pxInfo, xTaskGetTickCount() - pxInfo->acquireTime);
+#endif
+            /* 清除持有者和获取时间 */
+            pxInfo->holder = NULL;
+            pxInfo->acquireTime = 0;
+            xFinalRelease = pdTRUE;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    if (xFinalRelease == pdTRUE)
+    {
+        prvLockOrderPop(pxInfo);
+    }
+#else
+    (void)xFinalRelease;
+#endif
+}
+
+/**
+ * 登记一个共享持有者，调用者必须处于临界区内
+ * @param pxInfo 计数信号量或事件组
+ * @param xTask 持有者
+ * @param xNow 获取时间
+ */
+static void prvAddSharedHolder(MutexInfo_t *pxInfo, TaskHandle_t xTask, TickType_t xNow)
+{
+    if (pxInfo->sharedHolderCount < configDEADLOCK_MAX_SHARED_HOLDERS)
+    {
+        pxInfo->sharedHolders[pxInfo->sharedHolderCount] = xTask;
+        pxInfo->sharedAcquireTimes[pxInfo->sharedHolderCount] = xNow;
+        pxInfo->sharedHolderCount++;
+    }
+    else
+    {
+        /* 没记下的持有者可能正是能解开等待的任务，此后不再据此判断死锁 */
+        pxInfo->sharedOverflow = pdTRUE;
+    }
+}
+
+/**
+ * 移除任务最近登记的一次共享持有，调用者必须处于临界区内
+ * @param pxInfo 计数信号量或事件组
+ * @param xTask 持有者
+ * @param pxAcquireTime 返回这次持有的获取时间
+ * @return pdTRUE 已移除，pdFALSE 任务不是持有者
+ */
+static BaseType_t prvRemoveSharedHolder(MutexInfo_t *pxInfo, TaskHandle_t xTask, TickType_t *pxAcquireTime)
+{
+    for (UBaseType_t i = pxInfo->sharedHolderCount; i > 0; i--)
+    {
+        if (pxInfo->sharedHolders[i - 1] == xTask)
+        {
+            *pxAcquireTime = pxInfo->sharedAcquireTimes[i - 1];
+            
+            for (UBaseType_t j = i; j < pxInfo->sharedHolderCount; j++)
+            {
+                pxInfo->sharedHolders[j - 1] = pxInfo->sharedHolders[j];
+                pxInfo->sharedAcquireTimes[j - 1] = pxInfo->sharedAcquireTimes[j];
+            }
+            pxInfo->sharedHolderCount--;
+            
+            return pdTRUE;
+        }
+    }
+    
+    return pdFALSE;
+}
+
+/**
+ * 获取对象的持有者数量，也可用于快照中的记录
+ * @param pxInfo 跟踪信息
+ * @return 持有者数量
+ */
+static UBaseType_t prvGetHolderCount(const MutexInfo_t *pxInfo)
+{
+    if (deadlockIS_SHARED(pxInfo))
+    {
+        return pxInfo->sharedHolderCount;
+    }
+    
+    return (pxInfo->holder != NULL) ? 1 : 0;
+}
+
+/**
+ * 获取对象的第 uxIndex 个持有者
+ * @param pxInfo 跟踪信息
+ * @param uxIndex 持有者序号，小于 prvGetHolderCount 的返回值
+ * @return 持有者
+ */
+static TaskHandle_t prvGetHolder(const MutexInfo_t *pxInfo, UBaseType_t uxIndex)
+{
+    return deadlockIS_SHARED(pxInfo) ? pxInfo->sharedHolders[uxIndex] : pxInfo->holder;
+}
+
+/**
+ * 获取对象第 uxIndex 个持有者的获取时间
+ * @param pxInfo 跟踪信息
+ * @param uxIndex 持有者序号
+ * @return 获取时间，事件组为最近一次设置的时间
+ */
+static TickType_t prvGetHolderTime(const MutexInfo_t *pxInfo, UBaseType_t uxIndex)
+{
+    return deadlockIS_SHARED(pxInfo) ? pxInfo->sharedAcquireTimes[uxIndex] : pxInfo->acquireTime;
+}
+
+/**
+ * 检查任务是否持有对象
+ * @param pxInfo 跟踪信息
+ * @param xTask 任务句柄
+ * @return pdTRUE 持有，pdFALSE 不持有
+ */
+static BaseType_t prvHoldsObject(const MutexInfo_t *pxInfo, TaskHandle_t xTask)
+{
+    for (UBaseType_t i = 0; i < prvGetHolderCount(pxInfo); i++)
+    {
+        if (prvGetHolder(pxInfo, i) == xTask)
+        {
+            return pdTRUE;
+        }
+    }
+    
+    return pdFALSE;
+}
+
+#if (configDEADLOCK_VICTIM_SELECTION == deadlockVICTIM_SHORTEST_HOLD)
+
+/**
+ * 获取任务开始持有对象的时间
+ * @param pxInfo 跟踪信息
+ * @param xTask 持有者
+ * @return 获取时间，任务不是持有者时返回当前时间
+ */
+static TickType_t prvGetHoldStart(const MutexInfo_t *pxInfo, TaskHandle_t xTask)
+{
+    for (UBaseType_t i = 0; i < prvGetHolderCount(pxInfo); i++)
+    {
+        if (prvGetHolder(pxInfo, i) == xTask)
+        {
+            return prvGetHolderTime(pxInfo, i);
+        }
+    }
+    
+    return xTaskGetTickCount();
+}
+
+#endif
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+
+/**
+ * 获取当前任务的持有栈，第一次使用时从状态池中分配
+ * @return 持有栈，状态池耗尽时返回NULL（该任务不参与锁顺序检测）
+ */
+static LockOrderTaskState_t *prvGetLockOrderState(void)
+{
+    LockOrderTaskState_t *pxState;
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    
+    pxState = (LockOrderTaskState_t *)pvTaskGetThreadLocalStoragePointer(NULL, configLOCK_ORDER_TLS_INDEX);
+    if (pxState != NULL)
+    {
+        return pxState;
+    }
+    
+    /* 状态在任务的整个生命周期内保留，被重启的任务会归还它 */
+    taskENTER_CRITICAL();
+    {
+        for (UBaseType_t i = 0; i < uxLockOrderTaskCount; i++)
+        {
+            if (xLockOrderTasks[i].owner == NULL)
+            {
+                pxState = &xLockOrderTasks[i];
+                break;
+            }
+        }
+        
+        if (pxState == NULL && uxLockOrderTaskCount < configLOCK_ORDER_MAX_TASKS)
+        {
+            pxState = &xLockOrderTasks[uxLockOrderTaskCount++];
+        }
+        
+        if (pxState != NULL)
+        {
+            pxState->owner = xCurrentTask;
+            pxState->heldCount = 0;
+            vTaskSetThreadLocalStoragePointer(NULL, configLOCK_ORDER_TLS_INDEX, pxState);
+        }
+    }
+    taskEXIT_CRITICAL();
+    
+    return pxState;
+}
+
+/**
+ * 检查当前任务在已持有的互斥量基础上获取指定互斥量是否与已知顺序相反，
+ * 并登记新的加锁顺序
+ * 钩子模式下调用时调度器已挂起或处于内核的临界区中，顺序颠倒推迟到定时器服务任务中打印
+ *
+ * @param pxInfo 将要获取的互斥量
+ */
+static void prvValidateLockOrder(MutexInfo_t *pxInfo)
+{
+    LockOrderTaskState_t *pxState = prvGetLockOrderState();
+    UBaseType_t uxNew = (UBaseType_t)(pxInfo - xMutexList);
+    BaseType_t xReport = pdFALSE;
+    
+    if (pxState == NULL || pxState->heldCount == 0)
+    {
+        return;
+    }
+    
+    taskENTER_CRITICAL();
+    {
+        for (UBaseType_t i = 0; i < pxState->heldCount; i++)
+        {
+            UBaseType_t uxHeld = pxState->held[i];
+            
+            /* 已登记过的顺序直接跳过，热路径上只有一次位测试 */
+            if (uxHeld == uxNew || lockorderTEST(uxHeld, uxNew))
+            {
+                continue;
+            }
+            
+            /* 第一次登记 held->new，如果已登记的顺序能从 new 走到 held 则是顺序颠倒 */
+            if (prvLockOrderFindPath(uxNew, uxHeld) == pdTRUE)
+            {
+                uxLockOrderViolations++;
+                
+                if (uxLockOrderReportCount < lockorderMAX_PENDING_REPORTS)
+                {
+                    LockOrderReport_t *pxReport = &xLockOrderReports[uxLockOrderReportCount++];
+                    
+                    strncpy(pxReport->taskName, pcTaskGetName(NULL), configMAX_TASK_NAME_LEN - 1);
+                    pxReport->taskName[configMAX_TASK_NAME_LEN - 1] = '\0';
+                    pxReport->held = uxHeld;
+                    pxReport->acquired = uxNew;
+                    prvLockOrderCopyPath(pxReport);
+                }
+                else
+                {
+                    uxLockOrderReportsDropped++;
+                }
+                
+                xReport = pdTRUE;
+            }
+            
+            lockorderSET(uxHeld, uxNew);
+        }
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+        /* 已挂起的打印会一并输出这次的记录 */
+        if (xReport == pdTRUE && xLockOrderReportPending == pdFALSE)
+        {
+            xLockOrderReportPending = pdTRUE;
+        }
+        else
+        {
+            xReport = pdFALSE;
+        }
+#endif
+    }
+    taskEXIT_CRITICAL();
+    
+    if (xReport == pdTRUE)
+    {
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+        /* 不能在这里打印，使用不会让出处理器的版本；队列满时下一次顺序颠倒再尝试 */
+        if (xTimerPendFunctionCallFromISR(prvPrintLockOrderReports, NULL, 0, NULL) != pdPASS)
+        {
+            xLockOrderReportPending = pdFALSE;
+        }
+#else
+        prvPrintLockOrderReports(NULL, 0);
+#endif
+    }
+}
+
+/**
+ * 在已登记的加锁顺序中广度优先搜索 uxFrom->...->uxTo 的路径，找到时前驱数组中保留这条最短路径
+ * 每个顺序只在第一次登记时搜索一次，最坏情况遍历整个矩阵；调用者必须处于临界区内
+ *
+ * @param uxFrom 起点槽位
+ * @param uxTo 终点槽位
+ * @return pdTRUE 存在路径，pdFALSE 不存在
+ */
+static BaseType_t prvLockOrderFindPath(UBaseType_t uxFrom, UBaseType_t uxTo)
+{
+    UBaseType_t uxHead = 0;
+    UBaseType_t uxTail = 0;
+    
+    memset(ucLockOrderVisited, 0, sizeof(ucLockOrderVisited));
+    ucLockOrderVisited[uxFrom >> 3] |= (uint8_t)(1 << (uxFrom & 7));
+    uxLockOrderQueue[uxTail++] = uxFrom;
+    
+    while (uxHead < uxTail)
+    {
+        UBaseType_t a = uxLockOrderQueue[uxHead++];
+        
+        for (UBaseType_t b = 0; b < uxMutexCount; b++)
+        {
+            if (lockorderTEST(a, b) == 0 || ((ucLockOrderVisited[b >> 3] >> (b & 7)) & 1) != 0)
+            {
+                continue;
+            }
+            
+            uxLockOrderParent[b] = a;
+            if (b == uxTo)
+            {
+                return pdTRUE;
+            }
+            
+            ucLockOrderVisited[b >> 3] |= (uint8_t)(1 << (b & 7));
+            uxLockOrderQueue[uxTail++] = b;
+        }
+    }
+    
+    return pdFALSE;
+}
+
+/**
+ * 把 prvLockOrderFindPath 找到的 acquired->...->held 路径写入报告，过长时只保留两端
+ * @param pxReport 已填写 held 和 acquired 的报告
+ */
+static void prvLockOrderCopyPath(LockOrderReport_t *pxReport)
+{
+    UBaseType_t uxLength = 1;
+    UBaseType_t uxSlot;
+    
+    for (uxSlot = pxReport->held; uxSlot != pxReport->acquired; uxSlot = uxLockOrderParent[uxSlot])
+    {
+        uxLength++;
+    }
+    
+    /* 从终点往回填写，超出的部分从靠近起点的一侧省略，起点总是保存在第一个位置 */
+    pxReport->pathLength = uxLength;
+    uxSlot = pxReport->held;
+    for (UBaseType_t i = (uxLength > lockorderMAX_REPORT_PATH) ? lockorderMAX_REPORT_PATH : uxLength; i > 0; i--)
+    {
+        pxReport->path[i - 1] = uxSlot;
+        uxSlot = uxLockOrderParent[uxSlot];
+    }
+    pxReport->path[0] = pxReport->acquired;
+}
+
+/**
+ * 获取槽位上对象的名称，用于打印
+ * @param uxSlot 跟踪槽位
+ * @return 对象名称，未命名时返回 "未命名"
+ */
+static const char *prvLockOrderName(UBaseType_t uxSlot)
+{
+    return (xMutexList[uxSlot].mutexName != NULL) ? xMutexList[uxSlot].mutexName : "未命名";
+}
+
+/**
+ * 打印记录下来的加锁顺序颠倒，钩子模式下在定时器服务任务中运行
+ * @param pvUnused 未使用
+ * @param ulUnused 未使用
+ */
+static void prvPrintLockOrderReports(void *pvUnused, uint32_t ulUnused)
+{
+    LockOrderReport_t xReports[lockorderMAX_PENDING_REPORTS];
+    UBaseType_t uxCount;
+    UBaseType_t uxDropped;
+    
+    (void)pvUnused;
+    (void)ulUnused;
+    
+    /* 先取走全部记录再慢慢打印，打印期间产生的新记录留给下一次打印 */
+    taskENTER_CRITICAL();
+    {
+        uxCount = uxLockOrderReportCount;
+        uxDropped = uxLockOrderReportsDropped;
+        memcpy(xReports, xLockOrderReports, uxCount * sizeof(LockOrderReport_t));
+        uxLockOrderReportCount = 0;
+        uxLockOrderReportsDropped = 0;
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+        xLockOrderReportPending = pdFALSE;
+#endif
+    }
+    taskEXIT_CRITICAL();
+    
+    for (UBaseType_t i = 0; i < uxCount; i++)
+    {
+        UBaseType_t uxSaved = (xReports[i].pathLength > lockorderMAX_REPORT_PATH) ? lockorderMAX_REPORT_PATH : xReports[i].pathLength;
+        
+        printf("锁顺序检测: 任务 %s 在持有 %s 时获取 %s，与之前记录的顺序 ",
+               xReports[i].taskName, prvLockOrderName(xReports[i].held), prvLockOrderName(xReports[i].acquired));
+        
+        for (UBaseType_t k = 0; k < uxSaved; k++)
+        {
+            printf("%s%s", (k == 0) ? "" : " -> ", prvLockOrderName(xReports[i].path[k]));
+            
+            if (k == 0 && uxSaved < xReports[i].pathLength)
+            {
+                printf(" -> ...");
+            }
+        }
+        
+        printf(" 相反，可能导致死锁\r\n");
+    }
+    
+    if (uxDropped > 0)
+    {
+        printf("锁顺序检测: 另有 %u 次顺序颠倒未能逐条记录\r\n", (unsigned)uxDropped);
+    }
+}
+
+/**
+ * 把获取到的互斥量压入当前任务的持有栈
+ * @param pxInfo 获取到的互斥量
+ */
+static void prvLockOrderPush(MutexInfo_t *pxInfo)
+{
+    LockOrderTaskState_t *pxState = prvGetLockOrderState();
+    
+    /* 持有栈只由所属任务访问，无需临界区 */
+    if (pxState != NULL && pxState->heldCount < configLOCK_ORDER_MAX_HELD)
+    {
+        pxState->held[pxState->heldCount++] = (UBaseType_t)(pxInfo - xMutexList);
+    }
+}
+
+/**
+ * 从当前任务的持有栈中移除释放的互斥量，允许不按获取的逆序释放
+ * @param pxInfo 释放的互斥量
+ */
+static void prvLockOrderPop(MutexInfo_t *pxInfo)
+{
+    LockOrderTaskState_t *pxState = prvGetLockOrderState();
+    UBaseType_t uxSlot = (UBaseType_t)(pxInfo - xMutexList);
+    
+    if (pxState == NULL)
+    {
+        return;
+    }
+    
+    /* 通常释放的是最后获取的互斥量，从栈顶开始查找 */
+    for (UBaseType_t i = pxState->heldCount; i > 0; i--)
+    {
+        if (pxState->held[i - 1] == uxSlot)
+        {
+            for (UBaseType_t j = i; j < pxState->heldCount; j++)
+            {
+                pxState->held[j - 1] = pxState->held[j];
+            }
+            pxState->heldCount--;
+            break;
+        }
+    }
+}
+
+/**
+ * 归还当前任务的持有栈，供以后创建的任务复用
+ */
+static void prvLockOrderReleaseState(void)
+{
+    LockOrderTaskState_t *pxState;
+    
+    pxState = (LockOrderTaskState_t *)pvTaskGetThreadLocalStoragePointer(NULL, configLOCK_ORDER_TLS_INDEX);
+    if (pxState != NULL)
+    {
+        taskENTER_CRITICAL();
+        {
+            pxState->heldCount = 0;
+            pxState->owner = NULL;
+            vTaskSetThreadLocalStoragePointer(NULL, configLOCK_ORDER_TLS_INDEX, NULL);
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * 忘记被删除对象的加锁顺序：清除矩阵中它的行和列，并从持有栈和待打印的记录中移除它
+ * 槽位复用后新对象从空白的顺序开始学习；调用者必须处于临界区内
+ *
+ * @param uxSlot 被删除对象的槽位
+ */
+static void prvLockOrderForgetSlot(UBaseType_t uxSlot)
+{
+    UBaseType_t uxKept = 0;
+    
+    for (UBaseType_t b = 0; b < configMAX_MUTEX_TRACKING; b++)
+    {
+        lockorderCLEAR(uxSlot, b);
+        lockorderCLEAR(b, uxSlot);
+    }
+    
+    /* 只有删除仍被持有的互斥量时才会改动其他任务的持有栈 */
+    for (UBaseType_t i = 0; i < uxLockOrderTaskCount; i++)
+    {
+        LockOrderTaskState_t *pxState = &xLockOrderTasks[i];
+        UBaseType_t uxHeld = 0;
+        
+        for (UBaseType_t j = 0; j < pxState->heldCount; j++)
+        {
+            if (pxState->held[j] != uxSlot)
+            {
+                pxState->held[uxHeld++] = pxState->held[j];
+            }
+        }
+        pxState->heldCount = uxHeld;
+    }
+    
+    for (UBaseType_t i = 0; i < uxLockOrderReportCount; i++)
+    {
+        const LockOrderReport_t *pxReport = &xLockOrderReports[i];
+        BaseType_t xUsesSlot = (pxReport->held == uxSlot || pxReport->acquired == uxSlot) ? pdTRUE : pdFALSE;
+        
+        for (UBaseType_t k = 0; k < pxReport->pathLength && k < lockorderMAX_REPORT_PATH; k++)
+        {
+            if (pxReport->path[k] == uxSlot)
+            {
+                xUsesSlot = pdTRUE;
+            }
+        }
+        
+        if (xUsesSlot == pdFALSE)
+        {
+            xLockOrderReports[uxKept++] = *pxReport;
+        }
+    }
+    uxLockOrderReportCount = uxKept;
+}
+
+#endif /* configUSE_LOCK_ORDER_VALIDATION */
+
+/**
+ * 创建任务并登记其入口信息，使死锁恢复可以重启该任务
+ */
+BaseType_t xCreateTaskWithDeadlockRecovery(TaskFunction_t pxTaskCode,
+                                           const char * const pcName,
+                                           const uint16_t usStackDepth,
+                                           void * const pvParameters,
+                                           UBaseType_t uxPriority,
+                                           TaskHandle_t * const pxCreatedTask)
+{
+    RestartableTask_t *pxEntry = NULL;
+    BaseType_t xResult;
+    
+    taskENTER_CRITICAL();
+    {
+        if (uxRestartableTaskCount < configDEADLOCK_MAX_RESTARTABLE_TASKS)
+        {
+            pxEntry = &xRestartableTasks[uxRestartableTaskCount++];
+        }
+    }
+    taskEXIT_CRITICAL();
+    
+    if (pxEntry == NULL)
+    {
+        /* 登记表已满，任务仍然创建，只是无法被重启 */
+        printf("警告: 可重启任务登记表已满，任务 %s 无法被死锁恢复重启\r\n", pcName);
+        return xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+    }
+    
+    pxEntry->pxCreatedTask = pxCreatedTask;
+    pxEntry->code = pxTaskCode;
+    pxEntry->name = pcName;
+    pxEntry->stackDepth = usStackDepth;
+    pxEntry->parameters = pvParameters;
+    pxEntry->priority = uxPriority;
+    
+    xResult = xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, &pxEntry->handle);
+    
+    if (pxCreatedTask != NULL)
+    {
+        *pxCreatedTask = pxEntry->handle;
+    }
+    
+    return xResult;
+}
+
+#if (configUSE_MUTEX_STATS == 1)
+
+/**
+ * 计算时长所在的直方图桶：0 tick 在第 0 桶，[2^(k-1), 2^k) 在第 k 桶
+ * @param xTicks 时长
+ * @return 桶序号
+ */
+static UBaseType_t prvHistogramBucket(TickType_t xTicks)
+{
+    UBaseType_t uxBucket = 0;
+    
+    while (xTicks != 0 && uxBucket < (configMUTEX_STATS_HISTOGRAM_BUCKETS - 1))
+    {
+        xTicks >>= 1;
+        uxBucket++;
+    }
+    
+    return uxBucket;
+}
+
+/**
+ * 把一次持有的时长记入直方图，调用者必须处于临界区内
+ * 自适应阈值只随直方图变化，在这里重新估计并缓存
+ *
+ * @param pxInfo 跟踪信息
+ * @param xHeld 持有时长
+ */
+static void prvRecordHoldTime(MutexInfo_t *pxInfo, TickType_t xHeld)
+{
+    pxInfo->stats.holdHistogram[prvHistogramBucket(xHeld)]++;
+
+#if (configDEADLOCK_STALL_DETECTION == 1) && (configDEADLOCK_STALL_ADAPTIVE == 1)
+    {
+        TickType_t xOldLimit = pxInfo->stallLimit;
+        
+        prvUpdateHoldLimit(pxInfo);
+        
+        /* 计数信号量的其余持有者按变小的阈值可能比已设置的检查更早到期 */
+        if (pxInfo->stallLimit < xOldLimit && deadlockIS_SHARED(pxInfo) && pxInfo->sharedHolderCount > 0)
+        {
+            prvArmStallTimer(xTaskGetTickCount(), 1);
+        }
+    }
+#endif
+}
+
+#endif /* configUSE_MUTEX_STATS */
+
+/**
+ * 获取所有被跟踪互斥量的竞争统计
+ */
+UBaseType_t uxDeadlockGetMutexStats(MutexStatsStatus_t * const pxStatsArray, const UBaseType_t uxArraySize)
+{
+    UBaseType_t uxCount = 0;
+
+#if (configUSE_MUTEX_STATS == 1)
+    UBaseType_t uxMutexes = uxMutexCount;
+    
+    if (pxStatsArray != NULL && uxArraySize >= uxMutexes)
+    {
+        for (UBaseType_t i = 0; i < uxMutexes; i++)
+        {
+            /* 逐个互斥量复制，避免长时间停留在临界区；已删除对象的槽位跳过 */
+            taskENTER_CRITICAL();
+            {
+                if (!deadlockIS_FREE(&xMutexList[i]))
+                {
+                    pxStatsArray[uxCount].type = xMutexList[i].type;
+                    pxStatsArray[uxCount].mutex = xMutexList[i].mutex;
+                    pxStatsArray[uxCount].mutexName = xMutexList[i].mutexName;
+                    pxStatsArray[uxCount].stats = xMutexList[i].stats;
+                    uxCount++;
+                }
+            }
+            taskEXIT_CRITICAL();
+        }
+    }
+#else
+    (void)pxStatsArray;
+    (void)uxArraySize;
+#endif
+
+    return uxCount;
+}
+
+/**
+ * 以表格形式打印所有被跟踪互斥量的竞争统计
+ */
+void vDeadlockPrintMutexStats(void)
+{
+#if (configUSE_MUTEX_STATS == 1)
+    /* 跟踪数组可能配置得很大，不放在任务栈上 */
+    static MutexStatsStatus_t xStats[configMAX_MUTEX_TRACKING];
+    UBaseType_t uxCount = uxDeadlockGetMutexStats(xStats, configMAX_MUTEX_TRACKING);
+    
+    printf("互斥量竞争统计 (直方图第 k 列为 [2^(k-1), 2^k) tick):\r\n");
+    printf("%-16s %10s %10s %8s\r\n", "名称", "获取次数", "阻塞次数", "最大等待者");
+    
+    for (UBaseType_t i = 0; i < uxCount; i++)
+    {
+        printf("%-16s %10u %10u %8u\r\n",
+               xStats[i].mutexName != NULL ? xStats[i].mutexName : "未命名",
+               (unsigned int)xStats[i].stats.acquireCount,
+               (unsigned int)xStats[i].stats.contendedCount,
+               (unsigned int)xStats[i].stats.maxWaiters);
+        
+        printf("  等待:");
+        for (UBaseType_t b = 0; b < configMUTEX_STATS_HISTOGRAM_BUCKETS; b++)
+        {
+            printf(" %u", (unsigned int)xStats[i].stats.waitHistogram[b]);
+        }
+        printf("\r\n  持有:");
+        for (UBaseType_t b = 0; b < configMUTEX_STATS_HISTOGRAM_BUCKETS; b++)
+        {
+            printf(" %u", (unsigned int)xStats[i].stats.holdHistogram[b]);
+        }
+        printf("\r\n");
+    }
+#endif
+}
+
+/**
+ * 获取锁顺序检测发现的加锁顺序颠倒次数
+ */
+UBaseType_t uxGetLockOrderViolationCount(void)
+{
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    return uxLockOrderViolations;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * 在临界区内复制一份互斥量跟踪信息快照，供打印使用
+ */
+static void prvTakeMutexSnapshot(void)
+{
+    taskENTER_CRITICAL();
+    {
+        uxSnapshotCount = uxMutexCount;
+        xSnapshotTime = xTaskGetTickCount();
+        memcpy(xMutexSnapshot, xMutexList, uxSnapshotCount * sizeof(MutexInfo_t));
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 获取任务当前的等待信息
+ * @param xTask 任务句柄
+ * @return 等待信息，任务未阻塞在被跟踪的互斥量上时返回NULL
+ */
+static TaskWaitInfo_t *prvGetTaskWaitInfo(TaskHandle_t xTask)
+{
+    return (TaskWaitInfo_t *)pvTaskGetThreadLocalStoragePointer(xTask, configDEADLOCK_TLS_INDEX);
+}
+
+/**
+ * 沿等待图检查任务等待指定互斥量是否会形成环
+ * 调用者必须处于临界区内
+ *
+ * @param xTask 等待的任务
+ * @param pxWaitMutex 任务将要等待的互斥量
+ * @return pdTRUE 形成环（死锁），pdFALSE 未形成环
+ */
+static BaseType_t prvDetectWaitForCycle(TaskHandle_t xTask, MutexInfo_t *pxWaitMutex)
+{
+    uxCycleLength = 0;
+    
+    if (prvObjectWaitsOnTask(pxWaitMutex, xTask, 0) == pdTRUE)
+    {
+        /* 回到等待的任务，形成环 */
+        return pdTRUE;
+    }
+    
+    uxCycleLength = 0;
+    
+    return pdFALSE;
+}
+
+/**
+ * 检查对象是否只能由目标任务来解开：它的每个持有者要么就是目标任务，
+ * 要么无限期地阻塞在另一个同样只能由目标任务解开的对象上
+ * 调用者必须处于临界区内
+ *
+ * 互斥量只有一个持有者，路径退化为一条链；多个持有者时从后往前检查，
+ * 最后留在 pxCyclePath/xCycleHolders 中的是第一个持有者所在的环
+ *
+ * @param pxObject 被等待的对象
+ * @param xTarget 目标任务（检测到死锁的任务）
+ * @param uxDepth pxObject 在路径中的位置
+ * @return pdTRUE 对象只能由目标任务解开，pdFALSE 其他情况
+ */
+static BaseType_t prvObjectWaitsOnTask(MutexInfo_t *pxObject, TaskHandle_t xTarget, UBaseType_t uxDepth)
+{
+    UBaseType_t uxHolders = prvGetHolderCount(pxObject);
+    TaskWaitInfo_t *pxWaitInfo;
+    TaskHandle_t xHolder;
+    
+    /* 没有持有者的对象随时可能被释放；持有者记录不全时无法判断 */
+    if (uxHolders == 0 || pxObject->sharedOverflow == pdTRUE || uxDepth >= uxMutexCount)
+    {
+        return pdFALSE;
+    }
+    
+    /* 路径上已经出现过的对象属于一个不经过目标任务的环 */
+    for (UBaseType_t i = 0; i < uxDepth; i++)
+    {
+        if (pxCyclePath[i] == pxObject)
+        {
+            return pdFALSE;
+        }
+    }
+    
+    pxCyclePath[uxDepth] = pxObject;
+    
+    for (UBaseType_t i = uxHolders; i > 0; i--)
+    {
+        xHolder = prvGetHolder(pxObject, i - 1);
+        
+        if (xHolder != xTarget)
+        {
+            /* 持有者阻塞在有限超时的等待上时，环终会自行解开，不视为死锁 */
+            pxWaitInfo = prvGetTaskWaitInfo(xHolder);
+            if (pxWaitInfo == NULL || pxWaitInfo->timeout != portMAX_DELAY ||
+                prvObjectWaitsOnTask(pxWaitInfo->waitingFor, xTarget, uxDepth + 1) == pdFALSE)
+            {
+                return pdFALSE;
+            }
+        }
+        else
+        {
+            uxCycleLength = uxDepth + 1;
+        }
+        
+        xCycleHolders[uxDepth] = xHolder;
+    }
+    
+    return pdTRUE;
+}
+
+/**
+ * 打印最近一次检测到的死锁环
+ * @param xTask 检测到死锁的任务
+ */
+static void prvPrintWaitForCycle(TaskHandle_t xTask)
+{
+    printf("死锁检测: 任务 %s 的阻塞请求将在等待图中形成环:\r\n", pcTaskGetName(xTask));
+    
+    for (UBaseType_t i = 0; i < uxCycleLength; i++)
+    {
+        printf("  %s --等待--> %s --%s--> %s\r\n",
+               i == 0 ? pcTaskGetName(xTask) : pcTaskGetName(xCycleHolders[i - 1]),
+               pxCyclePath[i]->mutexName != NULL ? pxCyclePath[i]->mutexName : "未命名",
+               pxCyclePath[i]->type == eTrackedEventGroup ? "设置者" : "持有者",
+               pcTaskGetName(xCycleHolders[i]));
+    }
+}
+
+/**
+ * 报告最近一次检测到的死锁环：打印到控制台，并按配置导出快照
+ * @param xTask 检测到死锁的任务
+ */
+static void prvReportDeadlock(TaskHandle_t xTask)
+{
+    prvPrintWaitForCycle(xTask);
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1)
+    prvRecordLastCycle(xTask);
+    
+    /* 复位策略下由 vDeadlockSystemReset 导出，避免同一个环写两次 */
+#if (configDEADLOCK_EXPORT_ON_DETECTION == 1) && (configDEADLOCK_RECOVERY_POLICY != deadlockRECOVERY_SYSTEM_RESET)
+    prvExportToFiles("deadlock", pcTaskGetName(xTask));
+#endif
+#endif
+}
+
+/**
+ * 按恢复策略处理刚检测到的死锁环
+ * 受害任务不是当前任务时，中止它的等待；是当前任务时，只标记不再阻塞
+ *
+ * @param xTask 检测到死锁的任务，环中的第一个任务
+ * @param pxTaskWait 该任务的等待信息
+ */
+static void prvResolveDeadlock(TaskHandle_t xTask, TaskWaitInfo_t *pxTaskWait)
+{
+    TaskHandle_t xVictim = NULL;
+    TaskWaitInfo_t *pxVictimWait;
+    BaseType_t xAction = configDEADLOCK_RECOVERY_POLICY;
+    BaseType_t xInCycle = pdFALSE;
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 0)
+    BaseType_t xStillWaiting;
+#endif
+    UBaseType_t uxTaskCount = uxCycleLength;
+    
+    /* 环中第 i 个任务等待 pxCyclePath[i]，持有 pxCyclePath[i - 1] */
+    xCycleTasks[0] = xTask;
+    for (UBaseType_t i = 1; i < uxTaskCount; i++)
+    {
+        xCycleTasks[i] = xCycleHolders[i - 1];
+    }
+
+#if (configDEADLOCK_RECOVERY_POLICY == deadlockRECOVERY_SYSTEM_RESET)
+    vDeadlockSystemReset();
+#elif (configDEADLOCK_RECOVERY_POLICY == deadlockRECOVERY_USER_HOOK)
+    xVictim = xApplicationDeadlockHook(xCycleTasks, uxTaskCount);
+    xAction = deadlockRECOVERY_ABORT_WAIT;
+#else
+    xVictim = prvSelectVictim(uxTaskCount);
+#endif
+
+    for (UBaseType_t i = 0; i < uxTaskCount; i++)
+    {
+        if (xCycleTasks[i] == xVictim)
+        {
+            xInCycle = pdTRUE;
+            break;
+        }
+    }
+    
+    if (xInCycle == pdFALSE)
+    {
+        /* 没有可用的受害任务，只能复位 */
+        vDeadlockSystemReset();
+    }
+    
+    if (xAction == deadlockRECOVERY_RESTART_TASK && prvFindRestartableTask(xVictim) == NULL)
+    {
+        /* 受害任务没有登记入口信息，退而中止其等待 */
+        xAction = deadlockRECOVERY_ABORT_WAIT;
+    }
+    
+    printf("死锁恢复: %s任务 %s\r\n",
+           xAction == deadlockRECOVERY_RESTART_TASK ? "重启" : "中止等待，",
+           pcTaskGetName(xVictim));
+    
+    /* 当前任务只可能作为检测到死锁的任务出现在环中 */
+    if (xVictim == xTaskGetCurrentTaskHandle())
+    {
+        pxTaskWait->recoveryAction = xAction;
+        return;
+    }
+    
+    taskENTER_CRITICAL();
+    {
+        pxVictimWait = prvGetTaskWaitInfo(xVictim);
+        if (pxVictimWait != NULL)
+        {
+            pxVictimWait->recoveryAction = xAction;
+        }
+    }
+    taskEXIT_CRITICAL();
+    
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+    /* 这里运行在定时器服务任务中，不能睡眠重试。中止失败说明受害任务已被唤醒、还没有结束等待：
+     * 它要么自己结束等待，要么再次阻塞，届时 prvKernelBeginWait 看到 recoveryAction 会重新挂起中止 */
+    (void)xTaskAbortDelay(xVictim);
+#else
+    /* 受害任务可能已经登记了等待边但还没有真正进入阻塞态，此时中止会失败，稍后重试；
+     * 这里运行在检测到死锁的任务中，它随后也要阻塞，睡眠不影响其他任务 */
+    while (xTaskAbortDelay(xVictim) == pdFAIL)
+    {
+        taskENTER_CRITICAL();
+        {
+            xStillWaiting = (prvGetTaskWaitInfo(xVictim) == pxVictimWait) ? pdTRUE : pdFALSE;
+        }
+        taskEXIT_CRITICAL();
+        
+        if (xStillWaiting == pdFALSE)
+        {
+            break;
+        }
+        
+        vTaskDelay(1);
+    }
+#endif
+}
+
+/**
+ * 从死锁环中选择受害任务
+ * 条件相同时优先选择当前任务，这样无需唤醒其他任务
+ *
+ * @param uxTaskCount 环中的任务数量
+ * @return 受害任务
+ */
+static TaskHandle_t prvSelectVictim(UBaseType_t uxTaskCount)
+{
+    UBaseType_t uxVictim = 0;
+
+#if (configDEADLOCK_VICTIM_SELECTION == deadlockVICTIM_SHORTEST_HOLD)
+    TickType_t xNow = xTaskGetTickCount();
+    TickType_t xShortest = portMAX_DELAY;
+    
+    for (UBaseType_t i = 0; i < uxTaskCount; i++)
+    {
+        /* 第 i 个任务持有的环中互斥量，当前任务持有的是环的最后一个 */
+        MutexInfo_t *pxHeld = pxCyclePath[(i == 0) ? (uxTaskCount - 1) : (i - 1)];
+        TickType_t xHeldTime = xNow - prvGetHoldStart(pxHeld, xCycleTasks[i]);
+        
+        if (xHeldTime < xShortest)
+        {
+            xShortest = xHeldTime;
+            uxVictim = i;
+        }
+    }
+#else
+    UBaseType_t uxLowest = configMAX_PRIORITIES;
+    TaskStatus_t xStatus;
+    
+    for (UBaseType_t i = 0; i < uxTaskCount; i++)
+    {
+        /* 环中的持有者通常继承了等待者的优先级，比较继承前的基础优先级；
+         * 环中的任务都在等待，直接给出状态，省去查找 */
+        vTaskGetInfo(xCycleTasks[i], &xStatus, pdFALSE, eBlocked);
+        
+        if (xStatus.uxBasePriority < uxLowest)
+        {
+            uxLowest = xStatus.uxBasePriority;
+            uxVictim = i;
+        }
+    }
+#endif
+
+    return xCycleTasks[uxVictim];
+}
+
+/**
+ * 查找任务的重启入口信息
+ * @param xTask 任务句柄
+ * @return 入口信息，任务未登记时返回NULL
+ */
+static RestartableTask_t *prvFindRestartableTask(TaskHandle_t xTask)
+{
+    for (UBaseType_t i = 0; i < uxRestartableTaskCount; i++)
+    {
+        if (xRestartableTasks[i].handle == xTask)
+        {
+            return &xRestartableTasks[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * 重启当前任务：释放它持有的所有被跟踪互斥量，用登记的入口信息创建新任务后删除自己
+ */
+static void prvRestartCurrentTask(void)
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    RestartableTask_t *pxEntry = prvFindRestartableTask(xCurrentTask);
+    
+    configASSERT(pxEntry != NULL);
+    
+    /* 只有持有者自己才能释放互斥量，因此由受害任务自己完成；
+     * 递归互斥量和多次获取的计数信号量需要逐层释放 */
+    for (UBaseType_t i = 0; i < uxMutexCount; i++)
+    {
+        MutexInfo_t *pxInfo = &xMutexList[i];
+        TickType_t xUnused;
+        
+        if (deadlockIS_FREE(pxInfo))
+        {
+            continue;
+        }
+        
+        if (pxInfo->type != eTrackedEventGroup)
+        {
+            while (prvHoldsObject(pxInfo, xCurrentTask) == pdTRUE &&
+                   xGiveMutexWithDeadlockDetection(pxInfo->mutex) == pdTRUE)
+            {
+            }
+        }
+        
+        if (deadlockIS_SHARED(pxInfo))
+        {
+            /* 旧任务即将被删除，不能再作为持有者或设置者留在等待图中 */
+            taskENTER_CRITICAL();
+            {
+                while (prvRemoveSharedHolder(pxInfo, xCurrentTask, &xUnused) == pdTRUE)
+                {
+                }
+            }
+            taskEXIT_CRITICAL();
+        }
+    }
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    prvLockOrderReleaseState();
+#endif
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+    prvKernelReleaseWaitInfo(xCurrentTask);
+#endif
+
+    if (xTaskCreate(pxEntry->code, pxEntry->name, pxEntry->stackDepth,
+                    pxEntry->parameters, pxEntry->priority, &pxEntry->handle) != pdPASS)
+    {
+        printf("死锁恢复: 重新创建任务 %s 失败\r\n", pxEntry->name);
+        vDeadlockSystemReset();
+    }
+    
+    if (pxEntry->pxCreatedTask != NULL)
+    {
+        *pxEntry->pxCreatedTask = pxEntry->handle;
+    }
+    
+    vTaskDelete(NULL);
+}
+
+/**
+ * 打印指定任务持有的所有互斥量
+ * 使用最近一次 prvTakeMutexSnapshot 获取的快照
+ * @param xTask 要检查的任务句柄
+ */
+static void prvPrintTaskHeldMutexes(TaskHandle_t xTask)
+{
+    const char *pcTaskName = pcTaskGetName(xTask);
+    UBaseType_t uxHeldCount = 0;
+    
+    printf("任务 %s 持有的互斥量列表:\r\n", pcTaskName);
+    
+    /* 检查所有互斥量，多次获取的计数信号量每次持有单独列出 */
+    for (UBaseType_t i = 0; i < uxSnapshotCount; i++)
+    {
+        for (UBaseType_t j = 0; j < prvGetHolderCount(&xMutexSnapshot[i]); j++)
+        {
+            if (prvGetHolder(&xMutexSnapshot[i], j) == xTask)
+            {
+                printf("  - %s (持有时间: %u ms)\r\n",
+                      xMutexSnapshot[i].mutexName != NULL ? xMutexSnapshot[i].mutexName : "未命名",
+                      (unsigned int)((xSnapshotTime - prvGetHolderTime(&xMutexSnapshot[i], j)) * portTICK_PERIOD_MS));
+                uxHeldCount++;
+            }
+        }
+    }
+    
+    if (uxHeldCount == 0)
+    {
+        printf("  没有持有任何互斥量\r\n");
+    }
+}
+
+/**
+ * 复位系统（在检测到死锁时调用）
+ */
+void vDeadlockSystemReset(void)
+{
+    const char *pcCurrentTaskName = pcTaskGetName(xTaskGetCurrentTaskHandle());
+    /* 跟踪数组可能配置得很大，不放在任务栈上 */
+    static TaskHandle_t xInvolvedTasks[configMAX_MUTEX_TRACKING];
+    UBaseType_t uxInvolvedTaskCount = 0;
+    
+    /* 打印死锁警告 */
+    printf("检测到死锁！系统将重置...（触发任务: %s）\r\n", pcCurrentTaskName);
+    
+    /* 获取一致的跟踪信息快照 */
+    prvTakeMutexSnapshot();
+    
+    /* 收集所有持有互斥量的任务 */
+    for (UBaseType_t i = 0; i < uxSnapshotCount; i++)
+    {
+        for (UBaseType_t k = 0; k < prvGetHolderCount(&xMutexSnapshot[i]); k++)
+        {
+            TaskHandle_t xHolder = prvGetHolder(&xMutexSnapshot[i], k);
+            
+            /* 检查这个任务是否已经在列表中 */
+            BaseType_t xFound = pdFALSE;
+            for (UBaseType_t j = 0; j < uxInvolvedTaskCount; j++)
+            {
+                if (xInvolvedTasks[j] == xHolder)
+                {
+                    xFound = pdTRUE;
+                    break;
+                }
+            }
+            
+            /* 如果任务不在列表中，添加它 */
+            if (xFound == pdFALSE && uxInvolvedTaskCount < configMAX_MUTEX_TRACKING)
+            {
+                xInvolvedTasks[uxInvolvedTaskCount++] = xHolder;
+            }
+        }
+    }
+    
+    /* 打印所有被锁定的互斥量状态 */
+    printf("死锁相关的互斥量状态:\r\n");
+    for (UBaseType_t i = 0; i < uxSnapshotCount; i++)
+    {
+        for (UBaseType_t k = 0; k < prvGetHolderCount(&xMutexSnapshot[i]); k++)
+        {
+            printf("%s %s 被任务 %s %s (持有时间: %u ms)\r\n",
+                   xMutexSnapshot[i].type == eTrackedEventGroup ? "事件组" : "互斥量",
+                   xMutexSnapshot[i].mutexName != NULL ? xMutexSnapshot[i].mutexName : "未命名",
+                   pcTaskGetName(prvGetHolder(&xMutexSnapshot[i], k)),
+                   xMutexSnapshot[i].type == eTrackedEventGroup ? "设置" : "持有",
+                   (unsigned int)((xSnapshotTime - prvGetHolderTime(&xMutexSnapshot[i], k)) * portTICK_PERIOD_MS));
+        }
+    }
+    
+    /* 打印每个相关任务持有的所有互斥量 */
+    printf("\n相关任务持有的互斥量详情:\r\n");
+    for (UBaseType_t i = 0; i < uxInvolvedTaskCount; i++)
+    {
+        prvPrintTaskHeldMutexes(xInvolvedTasks[i]);
+    }
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1) && (configDEADLOCK_EXPORT_ON_DETECTION == 1)
+    prvExportToFiles("reset", pcCurrentTaskName);
+#endif
+
+    /* 在实际的嵌入式系统中，这里应该调用系统复位函数 */
+    /* 在模拟环境中，我们直接退出程序 */
+    printf("模拟系统复位...\r\n");
+    fflush(stdout);
+    
+    /* 退出程序 - 模拟系统复位 */
+    exit(0);
+}
+
+#if (configDEADLOCK_STALL_DETECTION == 1)
+
+/**
+ * 持有时间检查定时器回调，在定时器服务任务中运行
+ * 在一个临界区内检查所有对象，报告已经超过阈值的持有，并把定时器设置到剩余持有中最早的到期时间；
+ * 每个对象的每次持有只报告一次，对象空闲后重新检查
+ */
+static void prvStallCheckCallback(TimerHandle_t xTimer)
+{
+    /* 跟踪数组可能配置得很大，不放在任务栈上；只在定时器服务任务中运行，不会重入 */
+    static const MutexInfo_t *pxStalled[configMAX_MUTEX_TRACKING];
+    static TaskHandle_t xHolders[configMAX_MUTEX_TRACKING];
+    static TickType_t xHeldTimes[configMAX_MUTEX_TRACKING];
+    UBaseType_t uxStalled = 0;
+    TickType_t xNext = portMAX_DELAY;
+    
+    (void)xTimer;
+    
+    taskENTER_CRITICAL();
+    {
+        TickType_t xNow = xTaskGetTickCount();
+        
+        /* 定时器已经到期，检查期间记录的持有会重新设置它 */
+        xStallTimerArmed = pdFALSE;
+        
+        for (UBaseType_t i = 0; i < uxMutexCount; i++)
+        {
+            MutexInfo_t *pxInfo = &xMutexList[i];
+            
+            /* 事件组的设置者并不持有它，没有持有时间 */
+            if (pxInfo->type == eTrackedEventGroup || pxInfo->stallReported == pdTRUE ||
+                pxInfo->stallLimit == deadlockHOLD_LIMIT_NONE)
+            {
+                continue;
+            }
+            
+            for (UBaseType_t k = 0; k < prvGetHolderCount(pxInfo); k++)
+            {
+                TickType_t xHeld = xNow - prvGetHolderTime(pxInfo, k);
+                
+                if (xHeld > pxInfo->stallLimit)
+                {
+                    pxStalled[uxStalled] = pxInfo;
+                    xHolders[uxStalled] = prvGetHolder(pxInfo, k);
+                    xHeldTimes[uxStalled] = xHeld;
+                    uxStalled++;
+                    pxInfo->stallReported = pdTRUE;
+                    break;
+                }
+                
+                if (pxInfo->stallLimit + 1 - xHeld < xNext)
+                {
+                    xNext = pxInfo->stallLimit + 1 - xHeld;
+                }
+            }
+        }
+        
+        if (xNext != portMAX_DELAY)
+        {
+            prvArmStallTimer(xNow, xNext);
+        }
+    }
+    taskEXIT_CRITICAL();
+    
+    /* 阈值和 p99 在报告期间可能被更新，打印的是缓存中的当前值 */
+    for (UBaseType_t i = 0; i < uxStalled; i++)
+    {
+        prvReportStall(pxStalled[i], xHolders[i], xHeldTimes[i], pxStalled[i]->stallLimit, pxStalled[i]->stallP99);
+    }
+}
+
+/**
+ * 在 xRemaining 个 tick 后检查持有时间，已设置的检查不晚于这个时间时保持不变
+ * 调用者必须处于临界区内；内核钩子中也会调用，因此只使用 FromISR 版本的定时器命令
+ *
+ * @param xNow 当前 tick
+ * @param xRemaining 距离需要检查的时间，至少为1
+ */
+static void prvArmStallTimer(TickType_t xNow, TickType_t xRemaining)
+{
+    TickType_t xArmedRemaining = xStallTimerDeadline - xNow;
+    
+    /* 已设置的检查更早，或者已经到期、定时器服务任务还没来得及运行 */
+    if (xStallTimerArmed == pdTRUE && (xArmedRemaining <= xRemaining || xArmedRemaining > (portMAX_DELAY >> 1)))
+    {
+        return;
+    }
+    
+    /* 命令队列满时不设置，下一次记录持有时再尝试 */
+    if (xStallTimer != NULL && xTimerChangePeriodFromISR(xStallTimer, xRemaining, NULL) == pdPASS)
+    {
+        xStallTimerArmed = pdTRUE;
+        xStallTimerDeadline = xNow + xRemaining;
+    }
+}
+
+/**
+ * 重新计算并缓存对象当前生效的持有时间阈值，调用者必须处于临界区内
+ * 优先使用单独设置的阈值；其次是由 p99 估计的自适应阈值；都没有时使用全局阈值
+ *
+ * @param pxInfo 跟踪信息，结果写入 stallLimit，使用自适应阈值时 p99 上界写入 stallP99，否则为0
+ */
+static void prvUpdateHoldLimit(MutexInfo_t *pxInfo)
+{
+    pxInfo->stallP99 = 0;
+    
+    if (pxInfo->holdLimit != deadlockHOLD_LIMIT_DEFAULT)
+    {
+        pxInfo->stallLimit = pxInfo->holdLimit;
+        return;
+    }
+
+#if (configDEADLOCK_STALL_ADAPTIVE == 1)
+    {
+        uint32_t ulSamples = 0;
+        uint32_t ulSeen = 0;
+        uint32_t ulRank;
+        
+        for (UBaseType_t b = 0; b < configMUTEX_STATS_HISTOGRAM_BUCKETS; b++)
+        {
+            ulSamples += pxInfo->stats.holdHistogram[b];
+        }
+        
+        if (ulSamples >= configDEADLOCK_STALL_MIN_SAMPLES)
+        {
+            /* 第 ceil(0.99 * n) 个样本所在的桶，取桶的上界作为 p99 的保守估计；
+             * 落在最后一个不封顶的桶时无法估计，退回全局阈值 */
+            ulRank = ulSamples - (ulSamples / 100);
+            
+            for (UBaseType_t b = 0; b < configMUTEX_STATS_HISTOGRAM_BUCKETS - 1; b++)
+            {
+                ulSeen += pxInfo->stats.holdHistogram[b];
+                if (ulSeen >= ulRank)
+                {
+                    TickType_t xLimit;
+                    
+                    pxInfo->stallP99 = (TickType_t)1 << b;
+                    xLimit = pxInfo->stallP99 * configDEADLOCK_STALL_P99_FACTOR;
+                    
+                    pxInfo->stallLimit = (xLimit > configDEADLOCK_STALL_MIN_LIMIT) ? xLimit : configDEADLOCK_STALL_MIN_LIMIT;
+                    return;
+                }
+            }
+        }
+    }
+#endif
+
+    pxInfo->stallLimit = configDEADLOCK_DETECTION_TIMEOUT;
+}
+
+/**
+ * 报告持有时间超过阈值的对象
+ *
+ * @param pxInfo 跟踪信息
+ * @param xHolder 超时的持有者
+ * @param xHeld 已经持有的时间
+ * @param xLimit 生效的阈值
+ * @param xP99 估计的 p99 上界，未使用自适应阈值时为0
+ */
+static void prvReportStall(const MutexInfo_t *pxInfo, TaskHandle_t xHolder, TickType_t xHeld,
+                           TickType_t xLimit, TickType_t xP99)
+{
+    printf("持有时间检测: 任务 %s 持有 %s 已 %u ms，超过阈值 %u ms",
+           pcTaskGetName(xHolder),
+           pxInfo->mutexName != NULL ? pxInfo->mutexName : "未命名",
+           (unsigned int)(xHeld * portTICK_PERIOD_MS),
+           (unsigned int)(xLimit * portTICK_PERIOD_MS));
+    
+    if (xP99 != 0)
+    {
+        printf("（自适应: p99 < %u ms，倍数 %u）", (unsigned int)(xP99 * portTICK_PERIOD_MS),
+               (unsigned int)configDEADLOCK_STALL_P99_FACTOR);
+    }
+    printf("\r\n");
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1) && (configDEADLOCK_EXPORT_ON_DETECTION == 1)
+    prvExportToFiles("stall", pcTaskGetName(xHolder));
+#endif
+}
+
+#endif /* configDEADLOCK_STALL_DETECTION */
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1)
+
+/**
+ * 导出当前的等待图快照到缓冲区
+ */
+size_t xDeadlockExportSnapshot(DeadlockExportFormat_t eFormat, char *pcBuffer, size_t xBufferSize)
+{
+    size_t xLength;
+    
+    /* 挂起调度器期间快照和格式化都不会被其他导出打断 */
+    vTaskSuspendAll();
+    {
+        prvCaptureExportState();
+        xLength = prvFormatSnapshot(eFormat, pcBuffer, xBufferSize, "manual", pcTaskGetName(NULL));
+    }
+    (void)xTaskResumeAll();
+    
+    return xLength;
+}
+
+/**
+ * 保存刚检测到的死锁环，供之后的快照使用
+ * @param xTask 检测到死锁的任务，环中的第一个任务
+ */
+static void prvRecordLastCycle(TaskHandle_t xTask)
+{
+    taskENTER_CRITICAL();
+    {
+        uxLastCycleLength = uxCycleLength;
+        xLastCycleTime = xTaskGetTickCount();
+        
+        for (UBaseType_t i = 0; i < uxCycleLength; i++)
+        {
+            xLastCycleTasks[i] = (i == 0) ? xTask : xCycleHolders[i - 1];
+            uxLastCycleSlots[i] = (UBaseType_t)(pxCyclePath[i] - xMutexList);
+            xLastCycleHolders[i] = xCycleHolders[i];
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 获取任务状态、对象跟踪信息和每个任务的等待信息
+ * 调用者必须已经挂起调度器，使任务列表和等待信息属于同一时刻
+ */
+static void prvCaptureExportState(void)
+{
+    TaskWaitInfo_t *pxWait;
+    
+    /* 数组不足以容纳所有任务时返回0，快照中的任务列表为空 */
+    uxExportTaskCount = uxTaskGetSystemState(xExportTasks, configDEADLOCK_EXPORT_MAX_TASKS, NULL);
+    
+    taskENTER_CRITICAL();
+    {
+        xExportTime = xTaskGetTickCount();
+        uxExportObjectCount = uxMutexCount;
+        memcpy(xExportObjects, xMutexList, uxExportObjectCount * sizeof(MutexInfo_t));
+        
+        for (UBaseType_t i = 0; i < uxExportTaskCount; i++)
+        {
+            pxWait = prvGetTaskWaitInfo(xExportTasks[i].xHandle);
+            if (pxWait != NULL)
+            {
+                xExportWaits[i] = *pxWait;
+            }
+            else
+            {
+                memset(&xExportWaits[i], 0, sizeof(TaskWaitInfo_t));
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 按指定格式格式化已获取的快照
+ *
+ * @param eFormat 导出格式
+ * @param pcBuffer 输出缓冲区
+ * @param xBufferSize 缓冲区大小
+ * @param pcReason 导出原因
+ * @param pcTrigger 触发导出的任务名称
+ * @return 写入的字节数，缓冲区不足时返回0
+ */
+static size_t prvFormatSnapshot(DeadlockExportFormat_t eFormat, char *pcBuffer, size_t xBufferSize,
+                                const char *pcReason, const char *pcTrigger)
+{
+    ExportWriter_t xWriter = { pcBuffer, xBufferSize, 0, pdFALSE };
+    
+    if (eFormat == eDeadlockExportDot)
+    {
+        prvWriteDot(&xWriter, pcReason, pcTrigger);
+    }
+    else
+    {
+        prvWriteJson(&xWriter, pcReason, pcTrigger);
+    }
+    
+    return (xWriter.overflow == pdFALSE) ? xWriter.length : 0;
+}
+
+/**
+ * 以单行 JSON 对象格式写出快照
+ * 对象用跟踪槽位号 id 引用，任务用 uxTaskGetSystemState 给出的任务编号引用
+ */
+static void prvWriteJson(ExportWriter_t *pxWriter, const char *pcReason, const char *pcTrigger)
+{
+    static const char * const pcStateNames[] = { "running", "ready", "blocked", "suspended", "deleted", "invalid" };
+    static const char * const pcTypeNames[] = { "mutex", "recursiveMutex", "countingSemaphore", "eventGroup" };
+    BaseType_t xFirstObject = pdTRUE;
+    
+    prvWrite(pxWriter, "{\"tick\":%u,\"tickPeriodMs\":%u,\"reason\":",
+             (unsigned int)xExportTime, (unsigned int)portTICK_PERIOD_MS);
+    prvWriteString(pxWriter, pcReason);
+    prvWrite(pxWriter, ",\"trigger\":");
+    prvWriteString(pxWriter, pcTrigger);
+    
+    /* 任务状态和等待边 */
+    prvWrite(pxWriter, ",\"tasks\":[");
+    for (UBaseType_t i = 0; i < uxExportTaskCount; i++)
+    {
+        const TaskStatus_t *pxTask = &xExportTasks[i];
+        const TaskWaitInfo_t *pxWait = &xExportWaits[i];
+        
+        prvWrite(pxWriter, "%s{\"number\":%u,\"name\":", (i == 0) ? "" : ",", (unsigned int)pxTask->xTaskNumber);
+        prvWriteString(pxWriter, pxTask->pcTaskName);
+        prvWrite(pxWriter, ",\"state\":\"%s\",\"priority\":%u,\"basePriority\":%u",
+                 pcStateNames[pxTask->eCurrentState],
+                 (unsigned int)pxTask->uxCurrentPriority,
+                 (unsigned int)pxTask->uxBasePriority);
+        
+        if (pxWait->waitingFor != NULL)
+        {
+            /* 无限期等待的超时写为 -1 */
+            prvWrite(pxWriter, ",\"waitingFor\":%u,\"waitTicks\":%u,\"timeout\":%ld}",
+                     (unsigned int)(pxWait->waitingFor - xMutexList),
+                     (unsigned int)(xExportTime - pxWait->waitStartTime),
+                     (pxWait->timeout == portMAX_DELAY) ? -1L : (long)pxWait->timeout);
+        }
+        else
+        {
+            prvWrite(pxWriter, ",\"waitingFor\":null}");
+        }
+    }
+    
+    /* 对象的持有者和等待者 */
+    prvWrite(pxWriter, "],\"objects\":[");
+    for (UBaseType_t i = 0; i < uxExportObjectCount; i++)
+    {
+        const MutexInfo_t *pxObject = &xExportObjects[i];
+        BaseType_t xFirst = pdTRUE;
+        
+        /* id 是跟踪槽位，已删除对象的槽位不导出 */
+        if (deadlockIS_FREE(pxObject))
+        {
+            continue;
+        }
+        
+        prvWrite(pxWriter, "%s{\"id\":%u,\"name\":", (xFirstObject == pdTRUE) ? "" : ",", (unsigned int)i);
+        xFirstObject = pdFALSE;
+        if (pxObject->mutexName != NULL)
+        {
+            prvWriteString(pxWriter, pxObject->mutexName);
+        }
+        else
+        {
+            prvWrite(pxWriter, "null");
+        }
+        prvWrite(pxWriter, ",\"type\":\"%s\",\"holders\":[", pcTypeNames[pxObject->type]);
+        
+        for (UBaseType_t k = 0; k < prvGetHolderCount(pxObject); k++)
+        {
+            prvWrite(pxWriter, "%s{\"task\":", (k == 0) ? "" : ",");
+            prvWriteTaskRef(pxWriter, prvGetHolder(pxObject, k));
+            prvWrite(pxWriter, ",\"heldTicks\":%u}", (unsigned int)(xExportTime - prvGetHolderTime(pxObject, k)));
+        }
+        
+        prvWrite(pxWriter, "],\"waiters\":[");
+        for (UBaseType_t j = 0; j < uxExportTaskCount; j++)
+        {
+            if (xExportWaits[j].waitingFor == &xMutexList[i])
+            {
+                prvWrite(pxWriter, "%s%u", (xFirst == pdTRUE) ? "" : ",", (unsigned int)xExportTasks[j].xTaskNumber);
+                xFirst = pdFALSE;
+            }
+        }
+        
+        prvWrite(pxWriter, "]%s}", (pxObject->sharedOverflow != pdFALSE) ? ",\"holdersOverflow\":true" : "");
+    }
+    
+    /* 最近一次检测到的死锁环 */
+    prvWrite(pxWriter, "],\"cycle\":[");
+    for (UBaseType_t i = 0; i < uxLastCycleLength; i++)
+    {
+        prvWrite(pxWriter, "%s{\"task\":", (i == 0) ? "" : ",");
+        prvWriteTaskRef(pxWriter, xLastCycleTasks[i]);
+        prvWrite(pxWriter, ",\"waitsFor\":%u,\"heldBy\":", (unsigned int)uxLastCycleSlots[i]);
+        prvWriteTaskRef(pxWriter, xLastCycleHolders[i]);
+        prvWrite(pxWriter, "}");
+    }
+    
+    if (uxLastCycleLength > 0)
+    {
+        prvWrite(pxWriter, "],\"cycleTick\":%u}\n", (unsigned int)xLastCycleTime);
+    }
+    else
+    {
+        prvWrite(pxWriter, "],\"cycleTick\":null}\n");
+    }
+}
+
+/**
+ * 以 Graphviz DOT 格式写出快照
+ * 任务为方框，对象为椭圆；任务->对象 为等待边，对象->任务 为持有边，死锁环上的边标为红色
+ */
+static void prvWriteDot(ExportWriter_t *pxWriter, const char *pcReason, const char *pcTrigger)
+{
+    static const char * const pcStateNames[] = { "运行", "就绪", "阻塞", "挂起", "已删除", "无效" };
+    static const char * const pcTypeNames[] = { "互斥量", "递归互斥量", "计数信号量", "事件组" };
+    
+    prvWrite(pxWriter, "digraph deadlock_%u {\n    label=\"", (unsigned int)xExportTime);
+    prvWriteEscaped(pxWriter, pcReason);
+    prvWrite(pxWriter, " @ tick %u (", (unsigned int)xExportTime);
+    prvWriteEscaped(pxWriter, pcTrigger);
+    prvWrite(pxWriter, ")\";\n");
+    
+    for (UBaseType_t i = 0; i < uxExportTaskCount; i++)
+    {
+        prvWrite(pxWriter, "    t%u [shape=box,label=\"", (unsigned int)xExportTasks[i].xTaskNumber);
+        prvWriteEscaped(pxWriter, xExportTasks[i].pcTaskName);
+        prvWrite(pxWriter, "\\n%s 优先级 %u\"];\n",
+                 pcStateNames[xExportTasks[i].eCurrentState],
+                 (unsigned int)xExportTasks[i].uxCurrentPriority);
+    }
+    
+    for (UBaseType_t i = 0; i < uxExportObjectCount; i++)
+    {
+        if (deadlockIS_FREE(&xExportObjects[i]))
+        {
+            continue;
+        }
+        
+        prvWrite(pxWriter, "    o%u [shape=ellipse,label=\"", (unsigned int)i);
+        prvWriteEscaped(pxWriter, xExportObjects[i].mutexName != NULL ? xExportObjects[i].mutexName : "未命名");
+        prvWrite(pxWriter, "\\n%s\"];\n", pcTypeNames[xExportObjects[i].type]);
+    }
+    
+    /* 等待边 */
+    for (UBaseType_t i = 0; i < uxExportTaskCount; i++)
+    {
+        const TaskWaitInfo_t *pxWait = &xExportWaits[i];
+        UBaseType_t uxSlot;
+        
+        if (pxWait->waitingFor == NULL)
+        {
+            continue;
+        }
+        
+        uxSlot = (UBaseType_t)(pxWait->waitingFor - xMutexList);
+        prvWrite(pxWriter, "    t%u -> o%u [label=\"等待 %u\"%s];\n",
+                 (unsigned int)xExportTasks[i].xTaskNumber,
+                 (unsigned int)uxSlot,
+                 (unsigned int)(xExportTime - pxWait->waitStartTime),
+                 (prvIsCycleEdge(xExportTasks[i].xHandle, uxSlot, pdTRUE) == pdTRUE) ? ",color=red,penwidth=2" : "");
+    }
+    
+    /* 持有边，只画出快照中存在的任务 */
+    for (UBaseType_t i = 0; i < uxExportObjectCount; i++)
+    {
+        const MutexInfo_t *pxObject = &xExportObjects[i];
+        
+        for (UBaseType_t k = 0; k < prvGetHolderCount(pxObject); k++)
+        {
+            TaskHandle_t xHolder = prvGetHolder(pxObject, k);
+            BaseType_t xIndex = prvFindExportTask(xHolder);
+            
+            if (xIndex < 0)
+            {
+                continue;
+            }
+            
+            prvWrite(pxWriter, "    o%u -> t%u [label=\"%s %u\"%s];\n",
+                     (unsigned int)i,
+                     (unsigned int)xExportTasks[xIndex].xTaskNumber,
+                     (pxObject->type == eTrackedEventGroup) ? "设置" : "持有",
+                     (unsigned int)(xExportTime - prvGetHolderTime(pxObject, k)),
+                     (prvIsCycleEdge(xHolder, i, pdFALSE) == pdTRUE) ? ",color=red,penwidth=2" : "");
+        }
+    }
+    
+    prvWrite(pxWriter, "}\n");
+}
+
+/**
+ * 按格式追加写入，缓冲区不足时标记溢出
+ */
+static void prvWrite(ExportWriter_t *pxWriter, const char *pcFormat, ...)
+{
+    va_list xArgs;
+    size_t xRemaining = pxWriter->size - pxWriter->length;
+    int iWritten;
+    
+    if (pxWriter->overflow != pdFALSE)
+    {
+        return;
+    }
+    
+    va_start(xArgs, pcFormat);
+    iWritten = vsnprintf(pxWriter->buffer + pxWriter->length, xRemaining, pcFormat, xArgs);
+    va_end(xArgs);
+    
+    if (iWritten < 0 || (size_t)iWritten >= xRemaining)
+    {
+        pxWriter->overflow = pdTRUE;
+        return;
+    }
+    
+    pxWriter->length += (size_t)iWritten;
+}
+
+/**
+ * 写出转义后的文本，JSON 字符串和 DOT 标签通用
+ */
+static void prvWriteEscaped(ExportWriter_t *pxWriter, const char *pcText)
+{
+    for (; *pcText != '\0'; pcText++)
+    {
+        unsigned char ucChar = (unsigned char)*pcText;
+        
+        if (ucChar == '"' || ucChar == '\\')
+        {
+            prvWrite(pxWriter, "\\%c", ucChar);
+        }
+        else if (ucChar < 0x20)
+        {
+            prvWrite(pxWriter, "\\u%04x", ucChar);
+        }
+        else
+        {
+            prvWrite(pxWriter, "%c", ucChar);
+        }
+    }
+}
+
+/**
+ * 写出带引号的 JSON 字符串
+ */
+static void prvWriteString(ExportWriter_t *pxWriter, const char *pcText)
+{
+    prvWrite(pxWriter, "\"");
+    prvWriteEscaped(pxWriter, pcText);
+    prvWrite(pxWriter, "\"");
+}
+
+/**
+ * 以任务编号引用任务，任务不在快照中时写为 null
+ */
+static void prvWriteTaskRef(ExportWriter_t *pxWriter, TaskHandle_t xTask)
+{
+    BaseType_t xIndex = prvFindExportTask(xTask);
+    
+    if (xIndex >= 0)
+    {
+        prvWrite(pxWriter, "%u", (unsigned int)xExportTasks[xIndex].xTaskNumber);
+    }
+    else
+    {
+        prvWrite(pxWriter, "null");
+    }
+}
+
+/**
+ * 在快照的任务列表中查找任务
+ * @return 任务在 xExportTasks 中的下标，未找到时返回-1
+ */
+static BaseType_t prvFindExportTask(TaskHandle_t xTask)
+{
+    for (UBaseType_t i = 0; i < uxExportTaskCount; i++)
+    {
+        if (xExportTasks[i].xHandle == xTask)
+        {
+            return (BaseType_t)i;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * 判断一条边是否在最近一次检测到的死锁环上
+ *
+ * @param xTask 边上的任务
+ * @param uxSlot 边上的对象槽位号
+ * @param xIsWait pdTRUE 为等待边，pdFALSE 为持有边
+ */
+static BaseType_t prvIsCycleEdge(TaskHandle_t xTask, UBaseType_t uxSlot, BaseType_t xIsWait)
+{
+    for (UBaseType_t i = 0; i < uxLastCycleLength; i++)
+    {
+        if (uxLastCycleSlots[i] == uxSlot &&
+            ((xIsWait == pdTRUE) ? xLastCycleTasks[i] : xLastCycleHolders[i]) == xTask)
+        {
+            return pdTRUE;
+        }
+    }
+    
+    return pdFALSE;
+}
+
+#if (configDEADLOCK_EXPORT_ON_DETECTION == 1)
+
+/**
+ * 获取快照并以两种格式追加到导出文件
+ *
+ * @param pcReason 导出原因
+ * @param pcTrigger 触发导出的任务名称
+ */
+static void prvExportToFiles(const char *pcReason, const char *pcTrigger)
+{
+    /* 挂起调度器，共用的快照和格式化缓冲区不会被其他任务同时使用 */
+    vTaskSuspendAll();
+    {
+        prvCaptureExportState();
+        prvExportFile(eDeadlockExportJson, configDEADLOCK_EXPORT_PATH ".jsonl", pcReason, pcTrigger);
+        prvExportFile(eDeadlockExportDot, configDEADLOCK_EXPORT_PATH ".dot", pcReason, pcTrigger);
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * 格式化快照并追加到文件
+ */
+static void prvExportFile(DeadlockExportFormat_t eFormat, const char *pcPath,
+                          const char *pcReason, const char *pcTrigger)
+{
+    FILE *pxFile;
+    size_t xLength = prvFormatSnapshot(eFormat, cExportBuffer, sizeof(cExportBuffer), pcReason, pcTrigger);
+    
+    if (xLength == 0)
+    {
+        printf("死锁快照: 缓冲区不足，未写入 %s\r\n", pcPath);
+        return;
+    }
+    
+    pxFile = fopen(pcPath, "a");
+    if (pxFile == NULL)
+    {
+        printf("死锁快照: 无法打开 %s\r\n", pcPath);
+        return;
+    }
+    
+    (void)fwrite(cExportBuffer, 1, xLength, pxFile);
+    fclose(pxFile);
+    printf("死锁快照已写入 %s\r\n", pcPath);
+}
+
+#endif /* configDEADLOCK_EXPORT_ON_DETECTION */
+
+#endif /* configDEADLOCK_EXPORT_SNAPSHOT */
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1)
+
+/**
+ * 内核钩子：创建互斥量时自动注册
+ */
+void vDeadlockTraceCreateMutex(void *pvMutex, uint8_t ucQueueType)
+{
+    (void)prvRegisterObject((ucQueueType == queueQUEUE_TYPE_RECURSIVE_MUTEX) ? eTrackedRecursiveMutex : eTrackedMutex,
+                            (SemaphoreHandle_t)pvMutex, NULL, NULL);
+}
+
+/**
+ * 内核钩子：互斥量加入队列注册表时把注册名作为名称
+ */
+void vDeadlockTraceRegistryAdd(void *pvQueue, const char *pcQueueName)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    if (pxInfo != NULL && pxInfo->mutexName == NULL)
+    {
+        pxInfo->mutexName = pcQueueName;
+    }
+}
+
+/**
+ * 内核钩子：任务即将阻塞在队列上，调度器已挂起
+ */
+void vDeadlockTraceQueueBlocking(void *pvQueue, uint32_t ulTicksToWait)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    if (pxInfo == NULL)
+    {
+        return;
+    }
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    /* 阻塞前就检查加锁顺序，这次获取失败也能报告顺序颠倒 */
+    if (pxInfo->type != eTrackedCountingSemaphore)
+    {
+        prvValidateLockOrder(pxInfo);
+    }
+#endif
+
+    prvKernelBeginWait(pxInfo, (TickType_t)ulTicksToWait);
+}
+
+/**
+ * 内核钩子：成功获取信号量，调用时处于内核的临界区中，持有者尚未更新
+ */
+void vDeadlockTraceQueueReceive(void *pvQueue)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    if (pxInfo == NULL)
+    {
+        return;
+    }
+    
+    prvKernelEndWait(pxInfo, pdTRUE);
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1)
+    /* 计数信号量不是锁；递归互斥量的嵌套获取不经过这里 */
+    if (pxInfo->type != eTrackedCountingSemaphore)
+    {
+        prvValidateLockOrder(pxInfo);
+    }
+#endif
+
+    prvRecordAcquire(pxInfo);
+}
+
+/**
+ * 内核钩子：获取信号量失败（超时或被中止等待），调用时不在临界区中
+ */
+void vDeadlockTraceQueueReceiveFailed(void *pvQueue)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    if (pxInfo != NULL)
+    {
+        /* 被选为重启的受害任务在这里被重启，不会返回 */
+        prvKernelEndWait(pxInfo, pdFALSE);
+    }
+}
+
+/**
+ * 内核钩子：即将释放信号量，调用时处于内核的临界区中
+ * 递归互斥量只有最后一次释放才经过这里
+ */
+void vDeadlockTraceQueueSend(void *pvQueue)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    /* 创建互斥量时的第一次释放以及用作通知的信号量没有持有者 */
+    if (pxInfo != NULL && prvHoldsObject(pxInfo, xTaskGetCurrentTaskHandle()) == pdTRUE)
+    {
+        prvRecordRelease(pxInfo);
+    }
+}
+
+/**
+ * 内核钩子：队列即将被删除，被跟踪的互斥量和信号量在这里归还跟踪槽位
+ */
+void vDeadlockTraceQueueDelete(void *pvQueue)
+{
+    MutexInfo_t *pxInfo = prvGetMutexInfo((SemaphoreHandle_t)pvQueue);
+    
+    if (pxInfo != NULL)
+    {
+        prvReleaseObject(pxInfo);
+    }
+}
+
+/**
+ * 内核钩子：任务即将阻塞在事件组上，调度器已挂起
+ */
+void vDeadlockTraceEventGroupBlocking(void *pvEventGroup, uint32_t ulTicksToWait)
+{
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo((EventGroupHandle_t)pvEventGroup);
+    
+    if (pxInfo != NULL)
+    {
+        prvKernelBeginWait(pxInfo, (TickType_t)ulTicksToWait);
+    }
+}
+
+/**
+ * 内核钩子：事件组等待结束，调用时不在临界区中
+ */
+void vDeadlockTraceEventGroupWaitEnd(void *pvEventGroup, uint32_t ulTimeoutOccurred)
+{
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo((EventGroupHandle_t)pvEventGroup);
+    
+    if (pxInfo == NULL)
+    {
+        return;
+    }
+
+#if (configUSE_MUTEX_STATS == 1)
+    if (ulTimeoutOccurred == 0)
+    {
+        taskENTER_CRITICAL();
+        {
+            pxInfo->stats.acquireCount++;
+        }
+        taskEXIT_CRITICAL();
+    }
+#endif
+
+    prvKernelEndWait(pxInfo, (ulTimeoutOccurred == 0) ? pdTRUE : pdFALSE);
+}
+
+/**
+ * 内核钩子：设置事件组中的位，调度器已挂起
+ */
+void vDeadlockTraceEventGroupSetBits(void *pvEventGroup)
+{
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo((EventGroupHandle_t)pvEventGroup);
+    
+    if (pxInfo != NULL)
+    {
+        prvRecordSetter(pxInfo);
+    }
+}
+
+/**
+ * 内核钩子：事件组即将被删除，调度器已挂起，等待者尚未被唤醒
+ */
+void vDeadlockTraceEventGroupDelete(void *pvEventGroup)
+{
+    MutexInfo_t *pxInfo = prvGetEventGroupInfo((EventGroupHandle_t)pvEventGroup);
+    
+    if (pxInfo != NULL)
+    {
+        prvReleaseObject(pxInfo);
+    }
+}
+
+/**
+ * 内核钩子：任务即将被删除，由 portCLEAN_UP_TCB 在释放 TCB 之前调用
+ * 任务在等待中被删除时不会经过 prvKernelEndWait，在这里归还它的等待信息
+ */
+void vDeadlockTraceTaskDelete(void *pvTask)
+{
+    prvKernelReleaseWaitInfo((TaskHandle_t)pvTask);
+}
+
+/**
+ * 归还任务占用的等待信息，供其他任务复用
+ * @param xTask 任务句柄
+ */
+static void prvKernelReleaseWaitInfo(TaskHandle_t xTask)
+{
+    taskENTER_CRITICAL();
+    {
+        for (UBaseType_t i = 0; i < configDEADLOCK_MAX_WAITING_TASKS; i++)
+        {
+            if (xKernelWaitOwners[i] == xTask)
+            {
+                xKernelWaitOwners[i] = NULL;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * 从等待信息池中取出当前任务的等待信息并发布等待边，形成环时交给定时器服务任务处理
+ * 调度器已挂起，不能在这里阻塞或打印后等待
+ *
+ * @param pxInfo 将要等待的对象
+ * @param xTicksToWait 剩余的等待时间
+ */
+static void prvKernelBeginWait(MutexInfo_t *pxInfo, TickType_t xTicksToWait)
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+    TaskWaitInfo_t *pxWaitInfo = prvGetTaskWaitInfo(xCurrentTask);
+    BaseType_t xDeadlock = pdFALSE;
+    BaseType_t xReport = pdFALSE;
+    
+    if (pxWaitInfo != NULL && pxWaitInfo->recoveryAction != -1)
+    {
+        /* 被选为受害任务时已被唤醒、中止没有成功，现在再次阻塞，恢复调度器后立即中止 */
+        (void)xTimerPendFunctionCallFromISR(prvKernelAbortWait, xCurrentTask, 0, NULL);
+        return;
+    }
+    
+    if (pxWaitInfo != NULL)
+    {
+        /* 被唤醒后没有抢到对象，再次阻塞，等待边仍然有效，只需重新检查 */
+        taskENTER_CRITICAL();
+        {
+            xDeadlock = prvDetectWaitForCycle(xCurrentTask, pxInfo);
+        }
+        taskEXIT_CRITICAL();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+        {
+            for (UBaseType_t i = 0; i < configDEADLOCK_MAX_WAITING_TASKS; i++)
+            {
+                if (xKernelWaitOwners[i] == xCurrentTask || xKernelWaitOwners[i] == NULL)
+                {
+                    xKernelWaitOwners[i] = xCurrentTask;
+                    pxWaitInfo = &xKernelWaits[i];
+                    break;
+                }
+            }
+            
+            if (pxWaitInfo == NULL)
+            {
+                uxKernelWaitPoolMisses++;
+                if (xKernelWaitPoolReportPending == pdFALSE)
+                {
+                    xKernelWaitPoolReportPending = pdTRUE;
+                    xReport = pdTRUE;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+        
+        if (pxWaitInfo == NULL)
+        {
+            /* 等待信息池耗尽，本次等待不参与检测；调度器已挂起，报告交给定时器服务任务 */
+            if (xReport == pdTRUE &&
+                xTimerPendFunctionCallFromISR(prvKernelReportPoolExhausted, NULL, 0, NULL) != pdPASS)
+            {
+                xKernelWaitPoolReportPending = pdFALSE;
+            }
+            return;
+        }
+        
+        xDeadlock = prvPublishWait(pxInfo, xTicksToWait, pxWaitInfo);
+    }
+    
+    if (xDeadlock == pdTRUE)
+    {
+        /* 调度器已挂起，使用不会让出处理器的版本；队列满时丢弃，下次阻塞时会再次检测 */
+        (void)xTimerPendFunctionCallFromISR(prvKernelResolveDeadlock, xCurrentTask, 0, NULL);
+    }
+}
+
+/**
+ * 当前任务的等待结束，移除等待边
+ * @param pxInfo 等待的对象
+ * @param xSucceeded 等待是否成功
+ */
+static void prvKernelEndWait(MutexInfo_t *pxInfo, BaseType_t xSucceeded)
+{
+    TaskWaitInfo_t *pxWaitInfo = prvGetTaskWaitInfo(NULL);
+    
+    /* 没有阻塞过的获取不需要任何处理 */
+    if (pxWaitInfo != NULL)
+    {
+        /* 被选为重启的受害任务不会从这里返回，由 prvRestartCurrentTask 归还等待信息 */
+        prvEndWait(pxInfo, pxWaitInfo, xSucceeded);
+        
+        /* 等待边已移除，归还等待信息；只有自己会写自己的槽位，无需临界区 */
+        xKernelWaitOwners[pxWaitInfo - xKernelWaits] = NULL;
+    }
+}
+
+/**
+ * 在定时器服务任务中报告等待信息池耗尽
+ * @param pvUnused 未使用
+ * @param ulUnused 未使用
+ */
+static void prvKernelReportPoolExhausted(void *pvUnused, uint32_t ulUnused)
+{
+    (void)pvUnused;
+    (void)ulUnused;
+    
+    xKernelWaitPoolReportPending = pdFALSE;
+    printf("死锁检测: 等待信息池已满（configDEADLOCK_MAX_WAITING_TASKS = %u），累计 %u 次阻塞未参与检测\r\n",
+           (unsigned)configDEADLOCK_MAX_WAITING_TASKS, (unsigned)uxKernelWaitPoolMisses);
+}
+
+/**
+ * 在定时器服务任务中中止受害任务的等待
+ * 受害任务在这之前又被唤醒时中止会失败，它再次阻塞时会重新挂起本函数
+ *
+ * @param pvTask 受害任务
+ * @param ulUnused 未使用
+ */
+static void prvKernelAbortWait(void *pvTask, uint32_t ulUnused)
+{
+    (void)ulUnused;
+    (void)xTaskAbortDelay((TaskHandle_t)pvTask);
+}
+
+/**
+ * 在定时器服务任务中打印并处理阻塞钩子检测到的死锁
+ * 从检测到死锁到这里期间环可能已经解开，因此先重新检查
+ *
+ * @param pvTask 检测到死锁的任务
+ * @param ulUnused 未使用
+ */
+static void prvKernelResolveDeadlock(void *pvTask, uint32_t ulUnused)
+{
+    TaskHandle_t xTask = (TaskHandle_t)pvTask;
+    TaskWaitInfo_t *pxWaitInfo;
+    BaseType_t xDeadlock = pdFALSE;
+    
+    (void)ulUnused;
+    
+    taskENTER_CRITICAL();
+    {
+        pxWaitInfo = prvGetTaskWaitInfo(xTask);
+        if (pxWaitInfo != NULL)
+        {
+            xDeadlock = prvDetectWaitForCycle(xTask, pxWaitInfo->waitingFor);
+        }
+    }
+    taskEXIT_CRITICAL();
+    
+    if (xDeadlock == pdTRUE)
+    {
+        prvReportDeadlock(xTask);
+        prvResolveDeadlock(xTask, pxWaitInfo);
+    }
+}
+
+#endif /* configDEADLOCK_USE_KERNEL_HOOKS */
+
+/**
+ * 查找互斥量的跟踪信息
+ * 槽位号保存在互斥量的队列编号中，查找为O(1)；
+ * 未注册的互斥量其队列编号未经初始化，因此需要校验句柄
+ *
+ * @param mutex 互斥量句柄
+ * @return 跟踪信息，互斥量未被跟踪时返回NULL
+ */
+static MutexInfo_t *prvGetMutexInfo(SemaphoreHandle_t mutex)
+{
+    UBaseType_t uxSlot = uxQueueGetQueueNumber(mutex);
+    
+    if (uxSlot == 0 || uxSlot > uxMutexCount || xMutexList[uxSlot - 1].mutex != mutex)
+    {
+        return NULL;
+    }
+    
+    return &xMutexList[uxSlot - 1];
+}
+
+/**
+ * 查找事件组的跟踪信息，槽位号保存在事件组编号中
+ * @param xEventGroup 事件组句柄
+ * @return 跟踪信息，事件组未被跟踪时返回NULL
+ */
+static MutexInfo_t *prvGetEventGroupInfo(EventGroupHandle_t xEventGroup)
+{
+    UBaseType_t uxSlot = uxEventGroupGetNumber(xEventGroup);
+    
+    if (uxSlot == 0 || uxSlot > uxMutexCount || xMutexList[uxSlot - 1].eventGroup != xEventGroup)
+    {
+        return NULL;
     }
     
-    return xFound;
+    return &xMutexList[uxSlot - 1];
 } 
\ No newline at end of file
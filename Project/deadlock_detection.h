@@ -9,27 +9,261 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "event_groups.h"
 
-/* 配置死锁检测超时时间（以tick为单位） */
+/* 配置是否启用死锁检测 */
+#ifndef configENABLE_DEADLOCK_DETECTION
+    #define configENABLE_DEADLOCK_DETECTION     1
+#endif
+
+/*
+ * 是否由内核的跟踪宏驱动死锁检测（见 deadlock_trace.h）
+ * 在 FreeRTOSConfig.h 中定义为 1 并包含 deadlock_trace.h 后，所有互斥量在创建时自动注册，
+ * 直接使用 xSemaphoreTake/xSemaphoreGive 的代码同样被检测，包装接口只负责命名；
+ * 检测到的死锁交给定时器服务任务打印和恢复
+ */
+#ifndef configDEADLOCK_USE_KERNEL_HOOKS
+    #define configDEADLOCK_USE_KERNEL_HOOKS     0
+#endif
+
+/* 内核钩子模式下同时处于阻塞等待中的被跟踪任务数量上限 */
+#ifndef configDEADLOCK_MAX_WAITING_TASKS
+    #define configDEADLOCK_MAX_WAITING_TASKS    16
+#endif
+
+#if (configDEADLOCK_USE_KERNEL_HOOKS == 1) && ((configUSE_TIMERS != 1) || (INCLUDE_xTimerPendFunctionCall != 1))
+    #error 内核钩子模式需要 configUSE_TIMERS 和 INCLUDE_xTimerPendFunctionCall 设置为 1
+#endif
+
+/* 用于记录任务等待信息的线程本地存储指针索引 */
+#ifndef configDEADLOCK_TLS_INDEX
+    #define configDEADLOCK_TLS_INDEX            0
+#endif
+
+#if (configENABLE_DEADLOCK_DETECTION == 1) && (configNUM_THREAD_LOCAL_STORAGE_POINTERS <= configDEADLOCK_TLS_INDEX)
+    #error 死锁检测需要 configNUM_THREAD_LOCAL_STORAGE_POINTERS 大于 configDEADLOCK_TLS_INDEX
+#endif
+
+/* 死锁恢复策略 */
+#define deadlockRECOVERY_SYSTEM_RESET       0   /* 打印状态后复位整个系统 */
+#define deadlockRECOVERY_ABORT_WAIT         1   /* 中止受害任务的等待，其获取操作返回失败 */
+#define deadlockRECOVERY_RESTART_TASK       2   /* 释放受害任务持有的互斥量并重新创建该任务 */
+#define deadlockRECOVERY_USER_HOOK          3   /* 由 xApplicationDeadlockHook 选择受害任务 */
+
+#ifndef configDEADLOCK_RECOVERY_POLICY
+    #define configDEADLOCK_RECOVERY_POLICY      deadlockRECOVERY_ABORT_WAIT
+#endif
+
+/* 受害任务选择方式 */
+#define deadlockVICTIM_LOWEST_PRIORITY      0   /* 选择环中优先级最低的任务 */
+#define deadlockVICTIM_SHORTEST_HOLD        1   /* 选择环中持有互斥量时间最短的任务，损失的工作最少 */
+
+#ifndef configDEADLOCK_VICTIM_SELECTION
+    #define configDEADLOCK_VICTIM_SELECTION     deadlockVICTIM_LOWEST_PRIORITY
+#endif
+
+#if (configDEADLOCK_VICTIM_SELECTION == deadlockVICTIM_LOWEST_PRIORITY) && ((configUSE_TRACE_FACILITY != 1) || (configUSE_MUTEXES != 1))
+    #error 按优先级选择受害任务需要 configUSE_TRACE_FACILITY 和 configUSE_MUTEXES 设置为 1，以读取基础优先级
+#endif
+
+/* 可被重启的任务数量上限 */
+#ifndef configDEADLOCK_MAX_RESTARTABLE_TASKS
+    #define configDEADLOCK_MAX_RESTARTABLE_TASKS    8
+#endif
+
+/* 配置是否启用锁顺序检测（lockdep风格），即使没有真正发生死锁也能报告加锁顺序颠倒
+ * 第一次登记某个顺序时沿已登记的顺序搜索路径，跨越多个互斥量的环（A->B、B->C、C->A）同样会被报告；
+ * 顺序保存在 configMAX_MUTEX_TRACKING 的平方位的矩阵中，跟踪 1000 个对象约需 125KB */
+#ifndef configUSE_LOCK_ORDER_VALIDATION
+    #define configUSE_LOCK_ORDER_VALIDATION     1
+#endif
+
+/* 锁顺序检测使用的线程本地存储指针索引 */
+#ifndef configLOCK_ORDER_TLS_INDEX
+    #define configLOCK_ORDER_TLS_INDEX          1
+#endif
+
+/* 每个任务同时持有的互斥量的最大嵌套深度 */
+#ifndef configLOCK_ORDER_MAX_HELD
+    #define configLOCK_ORDER_MAX_HELD           8
+#endif
+
+/* 参与锁顺序检测的任务数量上限 */
+#ifndef configLOCK_ORDER_MAX_TASKS
+    #define configLOCK_ORDER_MAX_TASKS          16
+#endif
+
+#if (configUSE_LOCK_ORDER_VALIDATION == 1) && (configNUM_THREAD_LOCAL_STORAGE_POINTERS <= configLOCK_ORDER_TLS_INDEX)
+    #error 锁顺序检测需要 configNUM_THREAD_LOCAL_STORAGE_POINTERS 大于 configLOCK_ORDER_TLS_INDEX
+#endif
+
+/* 互斥量的跟踪槽位号保存在队列编号中，需要启用跟踪功能 */
+#if (configUSE_TRACE_FACILITY != 1)
+    #error 死锁检测需要 configUSE_TRACE_FACILITY 设置为 1
+#endif
+
+/* 配置是否统计每个互斥量的竞争情况 */
+#ifndef configUSE_MUTEX_STATS
+    #define configUSE_MUTEX_STATS               1
+#endif
+
+/* 等待/持有时间直方图的桶数，第 0 桶为 0 tick，第 k 桶为 [2^(k-1), 2^k) tick，最后一桶包含更长的时间 */
+#ifndef configMUTEX_STATS_HISTOGRAM_BUCKETS
+    #define configMUTEX_STATS_HISTOGRAM_BUCKETS 16
+#endif
+
+/* 计数信号量持有者或事件组设置者的跟踪数量上限，超出后该对象不再参与死锁判断 */
+#ifndef configDEADLOCK_MAX_SHARED_HOLDERS
+    #define configDEADLOCK_MAX_SHARED_HOLDERS   4
+#endif
+
+/*
+ * 持有时间检测：在最早的持有到期时检查互斥量/信号量的持有时间，超过阈值时报告可能的停滞
+ * 这类停滞不一定构成等待图中的环，例如持有者在等待不被跟踪的资源或陷入死循环
+ */
+#ifndef configDEADLOCK_STALL_DETECTION
+    #define configDEADLOCK_STALL_DETECTION      1
+#endif
+
+/* 没有单独设置阈值、也尚未学习到持有时间分布的对象使用的全局持有时间阈值 */
 #ifndef configDEADLOCK_DETECTION_TIMEOUT
     #define configDEADLOCK_DETECTION_TIMEOUT    ( ( TickType_t ) 5000 ) /* 默认5秒 */
 #endif
 
-/* 配置是否启用死锁检测 */
-#ifndef configENABLE_DEADLOCK_DETECTION
-    #define configENABLE_DEADLOCK_DETECTION     1
+/* 自适应阈值：从持有时间直方图估计 p99，持有时间超过 p99 的 k 倍即报告；默认随竞争统计一起启用 */
+#ifndef configDEADLOCK_STALL_ADAPTIVE
+    #define configDEADLOCK_STALL_ADAPTIVE       configUSE_MUTEX_STATS
 #endif
 
-/* 互斥量信息结构体 */
+/* 自适应阈值的倍数 k */
+#ifndef configDEADLOCK_STALL_P99_FACTOR
+    #define configDEADLOCK_STALL_P99_FACTOR     8
+#endif
+
+/* 启用自适应阈值前至少需要的持有次数，样本太少时 p99 没有意义 */
+#ifndef configDEADLOCK_STALL_MIN_SAMPLES
+    #define configDEADLOCK_STALL_MIN_SAMPLES    100
+#endif
+
+/* 自适应阈值的下限（tick），避免一两个 tick 的抖动被误报 */
+#ifndef configDEADLOCK_STALL_MIN_LIMIT
+    #define configDEADLOCK_STALL_MIN_LIMIT      ( ( TickType_t ) 4 )
+#endif
+
+#if (configDEADLOCK_STALL_DETECTION == 1) && (configUSE_TIMERS != 1)
+    #error 持有时间检测需要 configUSE_TIMERS 设置为 1
+#endif
+
+#if (configDEADLOCK_STALL_DETECTION == 1) && (configDEADLOCK_STALL_ADAPTIVE == 1) && (configUSE_MUTEX_STATS != 1)
+    #error 自适应持有时间阈值需要 configUSE_MUTEX_STATS 设置为 1
+#endif
+
+/* 单个对象的持有时间阈值的特殊取值 */
+#define deadlockHOLD_LIMIT_DEFAULT      ( ( TickType_t ) 0 )    /* 使用自适应阈值，尚未学习到时使用全局阈值 */
+#define deadlockHOLD_LIMIT_NONE         portMAX_DELAY           /* 不检查该对象的持有时间 */
+
+/* 是否提供机器可读的死锁快照导出（JSON 和 Graphviz DOT） */
+#ifndef configDEADLOCK_EXPORT_SNAPSHOT
+    #define configDEADLOCK_EXPORT_SNAPSHOT      1
+#endif
+
+/* 检测到死锁或复位系统时是否自动把快照追加到 configDEADLOCK_EXPORT_PATH 对应的文件 */
+#ifndef configDEADLOCK_EXPORT_ON_DETECTION
+    #define configDEADLOCK_EXPORT_ON_DETECTION  1
+#endif
+
+/* 自动导出的文件名前缀，JSON 快照每行一个追加到 <前缀>.jsonl，DOT 图追加到 <前缀>.dot */
+#ifndef configDEADLOCK_EXPORT_PATH
+    #define configDEADLOCK_EXPORT_PATH          "deadlock_snapshot"
+#endif
+
+/* 自动导出使用的格式化缓冲区大小 */
+#ifndef configDEADLOCK_EXPORT_BUFFER_SIZE
+    #define configDEADLOCK_EXPORT_BUFFER_SIZE   8192
+#endif
+
+/* 快照中 uxTaskGetSystemState 能容纳的任务数量上限 */
+#ifndef configDEADLOCK_EXPORT_MAX_TASKS
+    #define configDEADLOCK_EXPORT_MAX_TASKS     32
+#endif
+
+/* 被跟踪对象的类型 */
+typedef enum
+{
+    eTrackedMutex = 0,             /* 普通互斥量 */
+    eTrackedRecursiveMutex,        /* 递归互斥量 */
+    eTrackedCountingSemaphore,     /* 计数信号量，可以有多个持有者 */
+    eTrackedEventGroup             /* 事件组，设置过位的任务视为它的"持有者" */
+} TrackedObjectType_t;
+
+/* 死锁快照的导出格式 */
+typedef enum
+{
+    eDeadlockExportJson = 0,       /* 单行 JSON 对象 */
+    eDeadlockExportDot             /* Graphviz DOT 有向图 */
+} DeadlockExportFormat_t;
+
+/* 互斥量竞争统计结构体 */
+typedef struct MutexStats
+{
+    uint32_t acquireCount;                                      /* 成功获取次数 */
+    uint32_t contendedCount;                                    /* 需要阻塞等待的获取次数 */
+    uint32_t waitHistogram[configMUTEX_STATS_HISTOGRAM_BUCKETS]; /* 等待时间直方图（log2 tick） */
+    uint32_t holdHistogram[configMUTEX_STATS_HISTOGRAM_BUCKETS]; /* 持有时间直方图（log2 tick） */
+    UBaseType_t currentWaiters;                                 /* 当前等待者数量 */
+    UBaseType_t maxWaiters;                                     /* 等待者数量的最大值 */
+} MutexStats_t;
+
+/*
+ * 互斥量信息结构体
+ * 互斥量和递归互斥量使用 holder/acquireTime；
+ * 计数信号量和事件组使用 sharedHolders，一个任务多次持有计数信号量时会出现多次
+ */
 typedef struct MutexInfo
 {
-    SemaphoreHandle_t mutex;       /* 互斥量句柄 */
+    TrackedObjectType_t type;      /* 对象类型 */
+    SemaphoreHandle_t mutex;       /* 互斥量/信号量句柄，事件组为NULL */
+    EventGroupHandle_t eventGroup; /* 事件组句柄，其他类型为NULL */
     TaskHandle_t holder;           /* 当前持有者 */
     TickType_t acquireTime;        /* 获取时间 */
+    UBaseType_t recursionDepth;    /* 递归互斥量的嵌套深度 */
+    TaskHandle_t sharedHolders[configDEADLOCK_MAX_SHARED_HOLDERS];      /* 计数信号量持有者/事件组设置者 */
+    TickType_t sharedAcquireTimes[configDEADLOCK_MAX_SHARED_HOLDERS];   /* 对应的获取/最近设置时间 */
+    UBaseType_t sharedHolderCount; /* sharedHolders 中的有效项数 */
+    BaseType_t sharedOverflow;     /* 持有者曾经超出上限，无法判断是否死锁 */
     const char *mutexName;         /* 互斥量名称（可选） */
+    TickType_t holdLimit;          /* 持有时间阈值，见 deadlockHOLD_LIMIT_DEFAULT/deadlockHOLD_LIMIT_NONE */
+    BaseType_t stallReported;      /* 本次持有已经报告过超时，对象空闲后重新检查 */
+    TickType_t stallLimit;         /* 当前生效的持有时间阈值，阈值或持有时间直方图变化时更新 */
+    TickType_t stallP99;           /* stallLimit 由 p99 估计时的 p99 上界，否则为0 */
+#if (configUSE_MUTEX_STATS == 1)
+    MutexStats_t stats;            /* 竞争统计 */
+#endif
 } MutexInfo_t;
 
-/* 互斥量跟踪数组大小 */
+/* uxDeadlockGetMutexStats 返回的单个互斥量统计 */
+typedef struct MutexStatsStatus
+{
+    TrackedObjectType_t type;      /* 对象类型 */
+    SemaphoreHandle_t mutex;       /* 互斥量句柄，事件组为NULL */
+    const char *mutexName;         /* 互斥量名称 */
+    MutexStats_t stats;            /* 竞争统计 */
+} MutexStatsStatus_t;
+
+/*
+ * 任务等待信息结构体
+ * 任务阻塞期间存放在其自身栈上（内核钩子模式下从等待信息池中分配），并通过线程本地存储指针公开，
+ * 构成等待图中 任务->互斥量 的边
+ */
+typedef struct TaskWaitInfo
+{
+    MutexInfo_t *waitingFor;       /* 正在等待的互斥量、信号量或事件组 */
+    TickType_t waitStartTime;      /* 开始等待的时间 */
+    TickType_t timeout;            /* 等待超时时间 */
+    BaseType_t recoveryAction;     /* 死锁恢复对该任务采取的动作，未被选为受害者时为 -1 */
+} TaskWaitInfo_t;
+
+/* 互斥量跟踪数组大小，查找为O(1)，可按需配置到数千 */
 #ifndef configMAX_MUTEX_TRACKING
     #define configMAX_MUTEX_TRACKING      10
 #endif
@@ -50,7 +284,80 @@ void vDeadlockDetectionInit(void);
 SemaphoreHandle_t xCreateMutexWithDeadlockDetection(const char *name);
 
 /**
- * 使用超时参数获取互斥量
+ * 创建互斥量并注册到死锁检测模块，同时设置它的持有时间阈值
+ * 持有时间相差很大的锁（例如寄存器锁和闪存写入锁）应分别设置阈值
+ *
+ * @param name 互斥量名称，用于调试
+ * @param xHoldLimit 持有时间阈值（tick），deadlockHOLD_LIMIT_DEFAULT 使用自适应/全局阈值，
+ *                   deadlockHOLD_LIMIT_NONE 不检查
+ * @return 互斥量句柄
+ */
+SemaphoreHandle_t xCreateMutexWithHoldLimit(const char *name, TickType_t xHoldLimit);
+
+/**
+ * 修改已注册的互斥量、递归互斥量或计数信号量的持有时间阈值
+ * 用于不经 xCreateMutexWithHoldLimit 创建的对象，例如内核钩子模式下自动注册的互斥量
+ *
+ * @param mutex 互斥量句柄
+ * @param xHoldLimit 持有时间阈值，取值同 xCreateMutexWithHoldLimit
+ * @return pdTRUE 设置成功，pdFALSE 对象未被跟踪
+ */
+BaseType_t xDeadlockSetHoldLimit(SemaphoreHandle_t mutex, TickType_t xHoldLimit);
+
+/**
+ * 创建递归互斥量并注册到死锁检测模块
+ * 获取和释放同样使用 xTakeMutexWithDeadlockDetection/xGiveMutexWithDeadlockDetection，
+ * 嵌套获取只增加深度，最后一次释放时才清除持有者
+ *
+ * @param name 互斥量名称，用于调试
+ * @return 互斥量句柄
+ */
+SemaphoreHandle_t xCreateRecursiveMutexWithDeadlockDetection(const char *name);
+
+/**
+ * 创建计数信号量并注册到死锁检测模块
+ * 获取了信号量但尚未归还的任务被视为持有者；只用于通知（只释放不获取）的信号量没有持有者，
+ * 不会参与死锁判断
+ *
+ * @param name 信号量名称，用于调试
+ * @param uxMaxCount 最大计数值
+ * @param uxInitialCount 初始计数值
+ * @return 信号量句柄
+ */
+SemaphoreHandle_t xCreateCountingSemaphoreWithDeadlockDetection(const char *name,
+                                                                UBaseType_t uxMaxCount,
+                                                                UBaseType_t uxInitialCount);
+
+/**
+ * 创建事件组并注册到死锁检测模块
+ * 通过 xEventGroupSetBitsWithDeadlockDetection 设置过位的任务被视为该事件组的设置者；
+ * 等待者只有在所有设置者都无限期地阻塞在等待自己的对象上时才被判定为死锁
+ *
+ * @param name 事件组名称，用于调试
+ * @return 事件组句柄
+ */
+EventGroupHandle_t xCreateEventGroupWithDeadlockDetection(const char *name);
+
+/**
+ * 等待事件组中的位，参数和返回值与 xEventGroupWaitBits 相同
+ * 如果本次阻塞会在等待图中形成环，则立即报告死锁
+ */
+EventBits_t xEventGroupWaitBitsWithDeadlockDetection(EventGroupHandle_t xEventGroup,
+                                                     const EventBits_t uxBitsToWaitFor,
+                                                     const BaseType_t xClearOnExit,
+                                                     const BaseType_t xWaitForAllBits,
+                                                     TickType_t xTicksToWait);
+
+/**
+ * 设置事件组中的位，并把当前任务登记为该事件组的设置者
+ * 参数和返回值与 xEventGroupSetBits 相同
+ */
+EventBits_t xEventGroupSetBitsWithDeadlockDetection(EventGroupHandle_t xEventGroup,
+                                                    const EventBits_t uxBitsToSet);
+
+/**
+ * 使用超时参数获取互斥量、递归互斥量或计数信号量
+ * 如果本次阻塞会在等待图中形成环，则立即报告死锁
  *
  * @param mutex 互斥量句柄
  * @param timeout 超时时间
@@ -59,7 +366,7 @@ SemaphoreHandle_t xCreateMutexWithDeadlockDetection(const char *name);
 BaseType_t xTakeMutexWithDeadlockDetection(SemaphoreHandle_t mutex, TickType_t timeout);
 
 /**
- * 释放互斥量
+ * 释放互斥量、递归互斥量或计数信号量
  *
  * @param mutex 互斥量句柄
  * @return pdTRUE 成功释放，pdFALSE 释放失败
@@ -67,12 +374,86 @@ BaseType_t xTakeMutexWithDeadlockDetection(SemaphoreHandle_t mutex, TickType_t t
 BaseType_t xGiveMutexWithDeadlockDetection(SemaphoreHandle_t mutex);
 
 /**
- * 开始死锁检测任务
+ * 删除互斥量、递归互斥量或计数信号量，并归还它的跟踪槽位供以后创建的对象复用
+ * 与 vSemaphoreDelete 相同，删除前应确保没有任务持有或等待它；
+ * 钩子模式下直接调用 vSemaphoreDelete 也会归还槽位
+ *
+ * @param mutex 互斥量句柄
  */
-void vStartDeadlockDetectionTask(void);
+void vDeleteMutexWithDeadlockDetection(SemaphoreHandle_t mutex);
+
+/**
+ * 删除事件组，并归还它的跟踪槽位供以后创建的对象复用
+ * 钩子模式下直接调用 vEventGroupDelete 也会归还槽位
+ *
+ * @param xEventGroup 事件组句柄
+ */
+void vDeleteEventGroupWithDeadlockDetection(EventGroupHandle_t xEventGroup);
+
+/**
+ * 创建任务并登记其入口信息，使死锁恢复可以重启该任务
+ * 参数与 xTaskCreate 相同；任务被重启后 *pxCreatedTask 会更新为新句柄
+ *
+ * @return pdPASS 创建成功，其他值表示失败
+ */
+BaseType_t xCreateTaskWithDeadlockRecovery(TaskFunction_t pxTaskCode,
+                                           const char * const pcName,
+                                           const uint16_t usStackDepth,
+                                           void * const pvParameters,
+                                           UBaseType_t uxPriority,
+                                           TaskHandle_t * const pxCreatedTask);
+
+#if (configDEADLOCK_RECOVERY_POLICY == deadlockRECOVERY_USER_HOOK)
+/**
+ * 应用程序提供的死锁处理钩子，在检测到死锁的任务上下文中调用；
+ * 内核钩子模式下在定时器服务任务中调用
+ *
+ * @param pxCycleTasks 死锁环中的任务，第一个是检测到死锁的当前任务
+ * @param uxTaskCount 环中的任务数量
+ * @return 要中止等待的受害任务，必须是环中的任务；返回NULL则复位系统
+ */
+TaskHandle_t xApplicationDeadlockHook(TaskHandle_t *pxCycleTasks, UBaseType_t uxTaskCount);
+#endif
+
+/**
+ * 获取所有被跟踪互斥量的竞争统计，用法与 uxTaskGetSystemState 类似
+ * 每个互斥量的统计在临界区内复制，数据一致
+ *
+ * @param pxStatsArray 用于存放统计的数组
+ * @param uxArraySize 数组长度
+ * @return 实际填充的互斥量数量，数组不足以容纳所有互斥量时返回0
+ */
+UBaseType_t uxDeadlockGetMutexStats(MutexStatsStatus_t * const pxStatsArray, const UBaseType_t uxArraySize);
+
+/**
+ * 以表格形式打印所有被跟踪互斥量的竞争统计
+ */
+void vDeadlockPrintMutexStats(void);
+
+/**
+ * 获取锁顺序检测发现的加锁顺序颠倒次数
+ * 每一对互斥量只在第一次发现颠倒时计数一次
+ *
+ * @return 顺序颠倒的互斥量对数
+ */
+UBaseType_t uxGetLockOrderViolationCount(void);
+
+#if (configDEADLOCK_EXPORT_SNAPSHOT == 1)
+/**
+ * 导出当前的等待图快照：uxTaskGetSystemState 得到的任务状态、每个被跟踪对象的持有者和等待者
+ * 以及最近一次检测到的死锁环，所有数据在同一次调度器挂起期间获取
+ * 结果写入调用者的缓冲区，可以再写入文件或用 xStreamBufferSend 发送到流缓冲区
+ *
+ * @param eFormat 导出格式
+ * @param pcBuffer 输出缓冲区，结果以 '\0' 结尾
+ * @param xBufferSize 缓冲区大小
+ * @return 写入的字节数（不含结尾的 '\0'），缓冲区不足时返回0
+ */
+size_t xDeadlockExportSnapshot(DeadlockExportFormat_t eFormat, char *pcBuffer, size_t xBufferSize);
+#endif
 
 /**
- * 复位系统（在检测到死锁时调用）
+ * 复位系统（恢复策略为 deadlockRECOVERY_SYSTEM_RESET 或无法恢复时调用）
  */
 void vDeadlockSystemReset(void);
 
@@ -0,0 +1,61 @@
+/*
+ * FreeRTOS死锁检测模块的内核跟踪钩子
+ * 由 FreeRTOSConfig.h 在 configDEADLOCK_USE_KERNEL_HOOKS 为 1 时包含，
+ * 所有互斥量在创建时自动注册到死锁检测模块，调用处不必改用包装接口
+ *
+ * 这些宏在 queue.c/event_groups.c 内部展开，可以直接访问对象的私有成员
+ * 和所在函数的局部变量 xTicksToWait；未被跟踪的对象编号为0，钩子只多一次比较
+ */
+
+#ifndef DEADLOCK_TRACE_H
+#define DEADLOCK_TRACE_H
+
+/* 本文件在FreeRTOS的类型定义之前被包含，原型只能使用基本类型 */
+void vDeadlockTraceCreateMutex(void *pvMutex, uint8_t ucQueueType);
+void vDeadlockTraceRegistryAdd(void *pvQueue, const char *pcQueueName);
+void vDeadlockTraceQueueBlocking(void *pvQueue, uint32_t ulTicksToWait);
+void vDeadlockTraceQueueReceive(void *pvQueue);
+void vDeadlockTraceQueueReceiveFailed(void *pvQueue);
+void vDeadlockTraceQueueSend(void *pvQueue);
+void vDeadlockTraceQueueDelete(void *pvQueue);
+void vDeadlockTraceEventGroupBlocking(void *pvEventGroup, uint32_t ulTicksToWait);
+void vDeadlockTraceEventGroupWaitEnd(void *pvEventGroup, uint32_t ulTimeoutOccurred);
+void vDeadlockTraceEventGroupSetBits(void *pvEventGroup);
+void vDeadlockTraceEventGroupDelete(void *pvEventGroup);
+void vDeadlockTraceTaskDelete(void *pvTask);
+
+/* 对象编号保存跟踪槽位号，创建时清零，未注册的对象在钩子中直接跳过 */
+#define traceQUEUE_CREATE(pxNewQueue)                   (pxNewQueue)->uxQueueNumber = 0
+#define traceEVENT_GROUP_CREATE(pxEventBits)            (pxEventBits)->uxEventGroupNumber = 0
+
+#define traceCREATE_MUTEX(pxNewQueue)                   vDeadlockTraceCreateMutex((void *)(pxNewQueue), (pxNewQueue)->ucQueueType)
+#define traceQUEUE_REGISTRY_ADD(xQueue, pcQueueName)    vDeadlockTraceRegistryAdd((void *)(xQueue), (pcQueueName))
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+    do { if ((pxQueue)->uxQueueNumber != 0) { vDeadlockTraceQueueBlocking((void *)(pxQueue), (uint32_t)xTicksToWait); } } while (0)
+#define traceQUEUE_RECEIVE(pxQueue) \
+    do { if ((pxQueue)->uxQueueNumber != 0) { vDeadlockTraceQueueReceive((void *)(pxQueue)); } } while (0)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) \
+    do { if ((pxQueue)->uxQueueNumber != 0) { vDeadlockTraceQueueReceiveFailed((void *)(pxQueue)); } } while (0)
+#define traceQUEUE_SEND(pxQueue) \
+    do { if ((pxQueue)->uxQueueNumber != 0) { vDeadlockTraceQueueSend((void *)(pxQueue)); } } while (0)
+#define traceQUEUE_DELETE(pxQueue) \
+    do { if ((pxQueue)->uxQueueNumber != 0) { vDeadlockTraceQueueDelete((void *)(pxQueue)); } } while (0)
+
+#define traceEVENT_GROUP_WAIT_BITS_BLOCK(xEventGroup, uxBitsToWaitFor) \
+    do { if (((EventGroup_t *)(xEventGroup))->uxEventGroupNumber != 0) { vDeadlockTraceEventGroupBlocking((void *)(xEventGroup), (uint32_t)xTicksToWait); } } while (0)
+#define traceEVENT_GROUP_SYNC_BLOCK(xEventGroup, uxBitsToSet, uxBitsToWaitFor) \
+    traceEVENT_GROUP_WAIT_BITS_BLOCK(xEventGroup, uxBitsToWaitFor)
+#define traceEVENT_GROUP_WAIT_BITS_END(xEventGroup, uxBitsToWaitFor, xTimeoutOccurred) \
+    do { if (((EventGroup_t *)(xEventGroup))->uxEventGroupNumber != 0) { vDeadlockTraceEventGroupWaitEnd((void *)(xEventGroup), (uint32_t)(xTimeoutOccurred)); } } while (0)
+#define traceEVENT_GROUP_SYNC_END(xEventGroup, uxBitsToSet, uxBitsToWaitFor, xTimeoutOccurred) \
+    traceEVENT_GROUP_WAIT_BITS_END(xEventGroup, uxBitsToWaitFor, xTimeoutOccurred)
+#define traceEVENT_GROUP_SET_BITS(xEventGroup, uxBitsToSet) \
+    do { if (((EventGroup_t *)(xEventGroup))->uxEventGroupNumber != 0) { vDeadlockTraceEventGroupSetBits((void *)(xEventGroup)); } } while (0)
+#define traceEVENT_GROUP_DELETE(xEventGroup) \
+    do { if (((EventGroup_t *)(xEventGroup))->uxEventGroupNumber != 0) { vDeadlockTraceEventGroupDelete((void *)(xEventGroup)); } } while (0)
+
+/* 任务删除时归还它占用的等待信息，由移植层的 portCLEAN_UP_TCB 在释放 TCB 之前调用 */
+#define configCLEAN_UP_TCB(pxTCB)                       vDeadlockTraceTaskDelete((void *)(pxTCB))
+
+#endif /* DEADLOCK_TRACE_H */ 
\ No newline at end of file
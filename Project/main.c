@@ -53,6 +53,9 @@ static void prvCheckTask(void *pvParameters)
         
         /* 打印运行状态信息 */
         printf("系统运行中 - 时间节拍: %u\n", (unsigned int)xTaskGetTickCount());
+        
+        /* 打印互斥量竞争统计 */
+        vDeadlockPrintMutexStats();
         fflush(stdout);
     }
 }
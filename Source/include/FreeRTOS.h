@@ -692,6 +692,12 @@ extern "C" {
 	#define configGENERATE_RUN_TIME_STATS 0
 #endif
 
+#ifndef configRUN_TIME_COUNTER_TYPE
+	/* Defaults to uint32_t for backward compatibility.  Set to uint64_t in
+	FreeRTOSConfig.h when a fast run time counter would overflow 32 bits. */
+	#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
 	#ifndef portCONFIGURE_TIMER_FOR_RUN_TIME_STATS
@@ -798,6 +804,10 @@ extern "C" {
 	#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
 #endif
 
+#ifndef configNUMBER_OF_CORES
+	#define configNUMBER_OF_CORES 1
+#endif
+
 #ifndef configAPPLICATION_ALLOCATED_HEAP
 	#define configAPPLICATION_ALLOCATED_HEAP 0
 #endif
@@ -826,6 +836,37 @@ extern "C" {
 	#define configSTACK_DEPTH_TYPE uint16_t
 #endif
 
+#ifndef configUSE_EDF_SCHEDULING
+	/* Set to 1 to schedule tasks given a deadline earliest deadline first
+	within their priority. */
+	#define configUSE_EDF_SCHEDULING 0
+#endif
+
+#ifndef configUSE_TASK_BUDGETS
+	/* Set to 1 to allow tasks to be given a CPU budget with vTaskSetBudget(). */
+	#define configUSE_TASK_BUDGETS 0
+#endif
+
+#ifndef configTASK_BUDGET_EXHAUSTED_PRIORITY
+	/* The priority a task runs at between using up its budget and the budget
+	being replenished. */
+	#define configTASK_BUDGET_EXHAUSTED_PRIORITY 0
+#endif
+
+#ifndef configUSE_DELAYED_TASK_WHEEL
+	/* Set to 1 to hold delayed tasks in a timing wheel rather than a sorted
+	list, which makes blocking constant time. */
+	#define configUSE_DELAYED_TASK_WHEEL 0
+#endif
+
+#ifndef configDELAYED_TASK_WHEEL_SIZE
+	/* Slots in each level of the timing wheel.  Each level spans this many
+	times the level below, with enough levels to span the tick count, so a task
+	that is delayed beyond the first level is moved down a level at a time as
+	its wake time nears.  The wheel holds this many lists for each level. */
+	#define configDELAYED_TASK_WHEEL_SIZE 256
+#endif
+
 /* Sanity check the configuration. */
 #if( configUSE_TICKLESS_IDLE != 0 )
 	#if( INCLUDE_vTaskSuspend != 1 )
@@ -841,6 +882,49 @@ extern "C" {
 	#error configUSE_MUTEXES must be set to 1 to use recursive mutexes
 #endif
 
+#if( ( configUSE_TASK_BUDGETS == 1 ) && ( configUSE_MUTEXES != 1 ) )
+	#error configUSE_MUTEXES must be set to 1 to use task budgets
+#endif
+
+#if( ( configUSE_TASK_BUDGETS == 1 ) && ( configTASK_BUDGET_EXHAUSTED_PRIORITY >= configMAX_PRIORITIES ) )
+	#error configTASK_BUDGET_EXHAUSTED_PRIORITY must be less than configMAX_PRIORITIES
+#endif
+
+#if( ( configUSE_DELAYED_TASK_WHEEL == 1 ) && ( ( ( configDELAYED_TASK_WHEEL_SIZE & ( configDELAYED_TASK_WHEEL_SIZE - 1 ) ) != 0 ) || ( configDELAYED_TASK_WHEEL_SIZE < 16 ) || ( configDELAYED_TASK_WHEEL_SIZE > 256 ) ) )
+	#error configDELAYED_TASK_WHEEL_SIZE must be a power of 2 from 16 to 256
+#endif
+
+#if( configNUMBER_OF_CORES > 1 )
+	/* The port must say which core is executing, interrupt other cores and
+	provide the two recursive spinlocks that replace disabling interrupts as the
+	means of exclusion: the task lock serialises kernel code called from tasks
+	and the ISR lock serialises kernel code called from interrupts. */
+	#if !defined( portGET_CORE_ID ) || !defined( portYIELD_CORE )
+		#error The port must define portGET_CORE_ID() and portYIELD_CORE() if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if !defined( portGET_TASK_LOCK ) || !defined( portRELEASE_TASK_LOCK ) || !defined( portGET_ISR_LOCK ) || !defined( portRELEASE_ISR_LOCK )
+		#error The port must define the task and ISR lock macros if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( configUSE_PORT_OPTIMISED_TASK_SELECTION != 0 )
+		#error configUSE_PORT_OPTIMISED_TASK_SELECTION must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( configUSE_TICKLESS_IDLE != 0 )
+		#error configUSE_TICKLESS_IDLE must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( configUSE_EDF_SCHEDULING != 0 )
+		#error configUSE_EDF_SCHEDULING must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( configUSE_TASK_BUDGETS != 0 )
+		#error configUSE_TASK_BUDGETS must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( configSUPPORT_STATIC_ALLOCATION != 0 )
+		#error configSUPPORT_STATIC_ALLOCATION must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+	#if( portCRITICAL_NESTING_IN_TCB != 0 )
+		#error portCRITICAL_NESTING_IN_TCB must be 0 if configNUMBER_OF_CORES is greater than 1
+	#endif
+#endif
+
 #ifndef configINITIAL_TICK_COUNT
 	#define configINITIAL_TICK_COUNT 0
 #endif
@@ -1010,7 +1094,7 @@ typedef struct xSTATIC_TCB
 		void			*pvDummy15[ configNUM_THREAD_LOCAL_STORAGE_POINTERS ];
 	#endif
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
-		uint32_t		ulDummy16;
+		configRUN_TIME_COUNTER_TYPE		ulDummy16;
 	#endif
 	#if ( configUSE_NEWLIB_REENTRANT == 1 )
 		struct	_reent	xDummy17;
@@ -1027,6 +1111,20 @@ typedef struct xSTATIC_TCB
 		uint8_t ucDummy21;
 	#endif
 
+	#if( configNUMBER_OF_CORES > 1 )
+		BaseType_t		xDummy22;
+		UBaseType_t		uxDummy23;
+	#endif
+	#if( configUSE_EDF_SCHEDULING == 1 )
+		TickType_t		xDummy24[ 4 ];
+		UBaseType_t		uxDummy25;
+	#endif
+	#if( configUSE_TASK_BUDGETS == 1 )
+		TickType_t		xDummy26[ 4 ];
+		StaticListItem_t	xDummy27;
+		UBaseType_t		uxDummy28;
+	#endif
+
 } StaticTask_t;
 
 /*
@@ -133,9 +133,16 @@ typedef struct xTASK_STATUS
 	eTaskState eCurrentState;		/* The state in which the task existed when the structure was populated. */
 	UBaseType_t uxCurrentPriority;	/* The priority at which the task was running (may be inherited) when the structure was populated. */
 	UBaseType_t uxBasePriority;		/* The priority to which the task will return if the task's current priority has been inherited to avoid unbounded priority inversion when obtaining a mutex.  Only valid if configUSE_MUTEXES is defined as 1 in FreeRTOSConfig.h. */
-	uint32_t ulRunTimeCounter;		/* The total run time allocated to the task so far, as defined by the run time stats clock.  See http://www.freertos.org/rtos-run-time-stats.html.  Only valid when configGENERATE_RUN_TIME_STATS is defined as 1 in FreeRTOSConfig.h. */
+	configRUN_TIME_COUNTER_TYPE ulRunTimeCounter;	/* The total run time allocated to the task so far, as defined by the run time stats clock.  See http://www.freertos.org/rtos-run-time-stats.html.  Only valid when configGENERATE_RUN_TIME_STATS is defined as 1 in FreeRTOSConfig.h. */
 	StackType_t *pxStackBase;		/* Points to the lowest address of the task's stack area. */
 	uint16_t usStackHighWaterMark;	/* The minimum amount of stack space that has remained for the task since the task was created.  The closer this value is to zero the closer the task has come to overflowing its stack. */
+	#if ( configUSE_EDF_SCHEDULING == 1 )
+		TickType_t xAbsoluteDeadline;	/* The deadline of the task's current job.  Only meaningful for tasks given a deadline with vTaskSetDeadline(). */
+		UBaseType_t uxDeadlineMisses;	/* The number of the task's jobs that completed after their deadline. */
+	#endif
+	#if ( configUSE_TASK_BUDGETS == 1 )
+		UBaseType_t uxBudgetExhaustions;	/* The number of times the task has used up its CPU budget and been demoted.  Only meaningful for tasks given a budget with vTaskSetBudget(). */
+	#endif
 } TaskStatus_t;
 
 /* Possible return values for eTaskConfirmSleepModeStatus(). */
@@ -153,6 +160,14 @@ typedef enum
  */
 #define tskIDLE_PRIORITY			( ( UBaseType_t ) 0U )
 
+/**
+ * The core affinity mask of a task that may run on any core.  Bit n of an
+ * affinity mask allows the task to run on core n.
+ *
+ * \ingroup TaskUtils
+ */
+#define tskNO_AFFINITY				( ( UBaseType_t ) -1 )
+
 /**
  * task. h
  *
@@ -1483,6 +1498,169 @@ BaseType_t xTaskCallApplicationTaskHook( TaskHandle_t xTask, void *pvParameter )
  */
 TaskHandle_t xTaskGetIdleTaskHandle( void ) PRIVILEGED_FUNCTION;
 
+#if ( configNUMBER_OF_CORES > 1 )
+
+/**
+ * task. h
+ * <pre>void vTaskCoreAffinitySet( TaskHandle_t xTask, UBaseType_t uxCoreAffinityMask );</pre>
+ *
+ * Only available when configNUMBER_OF_CORES is greater than 1.
+ *
+ * Sets the cores a task is allowed to run on.  Bit n of uxCoreAffinityMask
+ * allows the task to run on core n, and tskNO_AFFINITY allows any core.  If
+ * the task is running on a core the new mask excludes it is moved off that
+ * core straight away.  Tasks are created with an affinity of tskNO_AFFINITY.
+ *
+ * @param xTask The handle of the task to set the affinity of.  Passing NULL
+ * sets the affinity of the calling task.
+ *
+ * @param uxCoreAffinityMask The new affinity mask, which must allow at least
+ * one core.
+ *
+ * \defgroup vTaskCoreAffinitySet vTaskCoreAffinitySet
+ * \ingroup Tasks
+ */
+void vTaskCoreAffinitySet( TaskHandle_t xTask, UBaseType_t uxCoreAffinityMask ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <pre>UBaseType_t vTaskCoreAffinityGet( TaskHandle_t xTask );</pre>
+ *
+ * Only available when configNUMBER_OF_CORES is greater than 1.
+ *
+ * @param xTask The handle of the task to query.  Passing NULL queries the
+ * calling task.
+ *
+ * @return The core affinity mask of the task.
+ *
+ * \defgroup vTaskCoreAffinityGet vTaskCoreAffinityGet
+ * \ingroup Tasks
+ */
+UBaseType_t vTaskCoreAffinityGet( TaskHandle_t xTask ) PRIVILEGED_FUNCTION;
+
+/**
+ * Only available when configNUMBER_OF_CORES is greater than 1.
+ *
+ * Returns the handle of the task running on core xCoreID, which may be that
+ * core's idle task.  The result is only a snapshot, as the other core may
+ * switch tasks at any time.
+ */
+TaskHandle_t xTaskGetCurrentTaskHandleForCore( BaseType_t xCoreID ) PRIVILEGED_FUNCTION;
+
+#endif /* configNUMBER_OF_CORES */
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+/**
+ * task. h
+ * <pre>void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xPeriod, TickType_t xRelativeDeadline );</pre>
+ *
+ * Only available when configUSE_EDF_SCHEDULING is set to 1.
+ *
+ * Makes a task periodic, with a deadline.  Among the ready tasks of the same
+ * priority, the task whose current job has the earliest deadline runs first,
+ * ahead of any task without a deadline.  Tasks of different priorities are
+ * still scheduled by priority, so give the tasks to be scheduled by deadline
+ * the same priority.
+ *
+ * The first job is released when vTaskSetDeadline() is called.  The task
+ * calls vTaskWaitForNextPeriod() when each job is complete.
+ *
+ * @param xTask The handle of the task.  Passing NULL sets the deadline of the
+ * calling task.
+ *
+ * @param xPeriod The time in ticks between the release of one job and the
+ * next.  Passing 0 removes the deadline.
+ *
+ * @param xRelativeDeadline The time in ticks, from its release, by which each
+ * job should complete.
+ *
+ * Example usage:
+   <pre>
+ void vControlTask( void * pvParameters )
+ {
+	 // Run every 25 ticks, finishing within 20 ticks of each release.
+	 vTaskSetDeadline( NULL, 25, 20 );
+
+	 for( ;; )
+	 {
+		 // Perform the control step here.
+
+		 vTaskWaitForNextPeriod();
+	 }
+ }
+   </pre>
+ * \defgroup vTaskSetDeadline vTaskSetDeadline
+ * \ingroup TaskCtrl
+ */
+void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xPeriod, TickType_t xRelativeDeadline ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <pre>void vTaskWaitForNextPeriod( void );</pre>
+ *
+ * Only available when configUSE_EDF_SCHEDULING is set to 1.
+ *
+ * Called by a task given a deadline with vTaskSetDeadline() to complete its
+ * current job.  If the job completes after its deadline, the task's
+ * uxDeadlineMisses count, as reported by uxTaskGetSystemState(), is
+ * incremented.  The task then blocks until the next job is released, one
+ * period after the last.  If that time has already passed the task carries
+ * on straight away with the next job's deadline.
+ *
+ * \defgroup vTaskWaitForNextPeriod vTaskWaitForNextPeriod
+ * \ingroup TaskCtrl
+ */
+void vTaskWaitForNextPeriod( void ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_EDF_SCHEDULING */
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+/**
+ * task. h
+ * <pre>void vTaskSetBudget( TaskHandle_t xTask, TickType_t xBudget, TickType_t xReplenishmentPeriod );</pre>
+ *
+ * Only available when configUSE_TASK_BUDGETS is set to 1.
+ *
+ * Limits the processor time a task can use at its own priority.  Each tick
+ * the task is running for is charged to its budget.  Once the task has run
+ * for xBudget ticks within a replenishment period it is demoted to
+ * configTASK_BUDGET_EXHAUSTED_PRIORITY, so it can no longer hold up the tasks
+ * below it, and gets its priority back when the next period starts.  A
+ * demoted task that holds a mutex a higher priority task is waiting for still
+ * inherits that task's priority.
+ *
+ * The first replenishment period starts when vTaskSetBudget() is called.
+ *
+ * @param xTask The handle of the task.  Passing NULL sets the budget of the
+ * calling task.
+ *
+ * @param xBudget The number of ticks the task can run for in each
+ * replenishment period.  Passing 0 removes the budget, restoring the task's
+ * priority if it has been demoted.
+ *
+ * @param xReplenishmentPeriod The length of a replenishment period in ticks.
+ *
+ * Example usage:
+   <pre>
+ void vStartLogger( void )
+ {
+ TaskHandle_t xHandle;
+
+	 xTaskCreate( vLoggerTask, "LOG", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &xHandle );
+
+	 // The logger can use at most 20 ticks in every 100 at its priority.
+	 vTaskSetBudget( xHandle, 20, 100 );
+ }
+   </pre>
+ * \defgroup vTaskSetBudget vTaskSetBudget
+ * \ingroup TaskCtrl
+ */
+void vTaskSetBudget( TaskHandle_t xTask, TickType_t xBudget, TickType_t xReplenishmentPeriod ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TASK_BUDGETS */
+
 /**
  * configUSE_TRACE_FACILITY must be defined as 1 in FreeRTOSConfig.h for
  * uxTaskGetSystemState() to be available.
@@ -1580,7 +1758,7 @@ TaskHandle_t xTaskGetIdleTaskHandle( void ) PRIVILEGED_FUNCTION;
 	}
 	</pre>
  */
-UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, uint32_t * const pulTotalRunTime ) PRIVILEGED_FUNCTION;
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, configRUN_TIME_COUNTER_TYPE * const pulTotalRunTime ) PRIVILEGED_FUNCTION;
 
 /**
  * task. h
@@ -2139,6 +2317,23 @@ BaseType_t xTaskNotifyStateClear( TaskHandle_t xTask );
  */
 BaseType_t xTaskIncrementTick( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * As xTaskIncrementTick(), but moves the tick count on by xTicksToCatchUp
+ * ticks at once.  Called from the tick interrupt by a port that has counted
+ * more than one tick since the interrupt last ran, for example because
+ * interrupts were masked.  Every task whose timeout expires within those ticks
+ * is unblocked in a single pass, rather than one pass per tick, and the tick
+ * count overflowing part way through is handled.  The tick hook is called
+ * once for every tick caught up, so a hook that counts ticks sees them all;
+ * the time slice is only checked once, after the last.  A non-zero return
+ * value means a context switch is required, as for xTaskIncrementTick().
+ */
+BaseType_t xTaskCatchUpTicks( TickType_t xTicksToCatchUp ) PRIVILEGED_FUNCTION;
+
 /*
  * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS AN
  * INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
@@ -52,6 +52,39 @@
 
 /*-----------------------------------------------------------
  * Implementation of functions defined in portable.h for the Posix port.
+ *
+ * Every task runs on its own pthread, but only one of them is ever allowed to
+ * execute.  Each thread parks on a futex word in its thread state; a context
+ * switch stores the run token in the next thread's word, wakes it with a single
+ * FUTEX_WAKE and parks the current thread on its own word.
+ *
+ * Once the scheduler starts the main thread is the tick source.  It sleeps to
+ * absolute deadlines on portTICK_CLOCK, so a late wake-up does not push later
+ * ticks back, and counts every period that has elapsed, including any the host
+ * slept through.  It then sends SIG_INTERRUPT to the thread of the running task
+ * so that the tick handler runs in that thread, like a tick ISR interrupting the
+ * running task on hardware, and processes all the counted ticks.  With tickless
+ * idle the idle task tells the tick source the tick it next needs; the tick
+ * source sleeps straight to it and the idle task sleeps until the tick source
+ * posts the ticks, so an idle simulator does not wake up every tick.
+ *
+ * Simulated interrupts are raised into a bounded lock-free queue that any
+ * number of host threads may write and only the running thread of core 0
+ * reads.  The raiser whose interrupt makes the queue non-empty sends
+ * SIG_INTERRUPT, and the interrupts are then dispatched like the tick.
+ *
+ * The threads do not use the task stacks, so the top word of each task's stack
+ * holds a pointer to its thread state.  The TCB points at that word through
+ * pxTopOfStack, which makes finding the thread of a task a constant time load
+ * however many tasks exist.
+ *
+ * The interrupt mask and critical nesting of a core belong to the task running
+ * on it, so they are kept in the thread state.  With configNUMBER_OF_CORES
+ * above 1 one thread runs per simulated core, in parallel on the host.  Core 0
+ * takes the tick, and a core is asked to switch tasks by setting its yield
+ * request and sending SIG_INTERRUPT to its running thread.  Critical sections
+ * take two recursive spinlocks, the task lock and the ISR lock, and interrupt
+ * handlers take the ISR lock, as the kernel expects of an SMP port.
  *----------------------------------------------------------*/
 
 #include <pthread.h>
@@ -60,11 +93,12 @@
 #include <errno.h>
 #include <sys/time.h>
 #include <time.h>
-#include <sys/times.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 /* Scheduler includes. */
 #include "FreeRTOS.h"
@@ -73,56 +107,136 @@
 #ifndef MAX_NUMBER_OF_TASKS
 #define MAX_NUMBER_OF_TASKS 		( _POSIX_THREAD_THREADS_MAX )
 #endif
-/*-----------------------------------------------------------*/
 
-/* Parameters to pass to the newly created pthread. */
-typedef struct XPARAMS
-{
-	pdTASK_CODE pxCode;
-	void *pvParams;
-} xParams;
+/* Length of a tick in nanoseconds, exact enough for tick rates above 1 kHz. */
+#define portTICK_PERIOD_NS			( 1000000000ULL / ( unsigned long long )configTICK_RATE_HZ )
+
+/* On a multi-core host a parking thread polls its futex word this many times
+before sleeping, so a quick hand back costs no system call at all. */
+#ifndef portPARK_SPIN_COUNT
+#define portPARK_SPIN_COUNT			( 4000 )
+#endif
+
+/* Simulated interrupts that can wait at once, a power of two. */
+#ifndef portINTERRUPT_QUEUE_LENGTH
+#define portINTERRUPT_QUEUE_LENGTH	( 256 )
+#endif
+#define portINTERRUPT_QUEUE_MASK	( ( unsigned long )portINTERRUPT_QUEUE_LENGTH - 1UL )
+/*-----------------------------------------------------------*/
 
 /* Each task maintains its own interrupt status in the critical nesting variable. */
 typedef struct THREAD_SUSPENSIONS
 {
 	pthread_t hThread;
-	xTaskHandle hTask;
+	pid_t xThreadId;							/* Kernel thread id, the target of SIG_INTERRUPT. */
 	unsigned portBASE_TYPE uxCriticalNesting;
+	volatile portBASE_TYPE xInterruptsEnabled;	/* The interrupt mask of the core while this thread runs. */
+	volatile portLONG lCore;					/* The core the thread runs on, or last ran on. */
+	volatile int iRunToken;						/* Futex word, set to 1 to let the thread run. */
+	volatile portBASE_TYPE xDying;				/* The task was deleted while its thread was parked. */
 } xThreadState;
+
+#if ( configNUMBER_OF_CORES > 1 )
+/* A recursive spinlock, owned by a thread. */
+typedef struct SPIN_LOCK
+{
+	xThreadState * volatile pxOwner;
+	unsigned portBASE_TYPE uxCount;
+} xSpinLock;
+#endif
+
+/* A slot of the simulated interrupt queue.  The sequence is the lap of the
+position the slot is free for, plus 1 once an interrupt is in it. */
+typedef struct RAISED_INTERRUPT
+{
+	volatile unsigned long ulSequence;
+	unsigned portBASE_TYPE uxInterruptNumber;
+	void *pvParameter;
+} xRaisedInterrupt;
+
+typedef struct INTERRUPT_HANDLER
+{
+	SimulatedInterruptHandler_t pxHandler;
+	unsigned portBASE_TYPE uxPriority;
+} xInterruptHandler;
+
+/* Parameters to pass to the newly created pthread. */
+typedef struct XPARAMS
+{
+	pdTASK_CODE pxCode;
+	void *pvParams;
+	xThreadState *pxThread;
+} xParams;
 /*-----------------------------------------------------------*/
 
 static xThreadState *pxThreads;
 static pthread_once_t hSigSetupThread = PTHREAD_ONCE_INIT;
 static pthread_attr_t xThreadAttributes;
-static pthread_mutex_t xSuspendResumeThreadMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t xSingleThreadMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_t hMainThread = ( pthread_t )NULL;
+static xThreadState * volatile pxRunningThreads[ configNUMBER_OF_CORES ];
+
+/* The main thread runs kernel code until the scheduler starts. */
+static xThreadState xMainThread = { 0, 0, 0, pdTRUE, 0, 0, pdFALSE };
+static __thread xThreadState *pxThisThread = &xMainThread;
 /*-----------------------------------------------------------*/
 
-static volatile portBASE_TYPE xSentinel = 0;
+static volatile int iThreadStarted = 0;
 static volatile portBASE_TYPE xSchedulerEnd = pdFALSE;
-static volatile portBASE_TYPE xInterruptsEnabled = pdTRUE;
-static volatile portBASE_TYPE xServicingTick = pdFALSE;
-static volatile portBASE_TYPE xPendYield = pdFALSE;
-static volatile portLONG lIndexOfLastAddedTask = 0;
-static volatile unsigned portBASE_TYPE uxCriticalNesting;
+static volatile portBASE_TYPE xYieldRequests[ configNUMBER_OF_CORES ];
+static volatile unsigned portBASE_TYPE uxPendedTicks = 0;
+static portLONG lParkSpinCount = 0;
+
+/* Ticks counted by the tick source, and the tick before which it stays quiet
+while the idle task sleeps, or 0. */
+static volatile unsigned long long ullTicksIssued = 0;
+static volatile unsigned long long ullSleepUntilTick = 0;
+static volatile int iIdleWake = 0;
+static volatile int iTickSourceWake = 0;
+
+static xInterruptHandler xInterruptHandlers[ portMAX_INTERRUPTS ];
+static xRaisedInterrupt xInterruptQueue[ portINTERRUPT_QUEUE_LENGTH ];
+static xRaisedInterrupt xInterruptsToDispatch[ portINTERRUPT_QUEUE_LENGTH ];
+static volatile unsigned long ulInterruptQueueHead = 0;
+static volatile unsigned long ulInterruptQueueTail = 0;
+
+/* portRUN_TIME_CLOCK in nanoseconds when the scheduler started. */
+static unsigned long long ullRunTimeStart = 0;
+
+#ifdef portREADY_PRIORITY_GROUPS
+/* Second level of the ready priority bitmap, see portmacro.h. */
+UBaseType_t uxPortReadyPriorityGroups[ portREADY_PRIORITY_GROUPS ] = { 0 };
+#endif
+
+#if ( configNUMBER_OF_CORES > 1 )
+static xSpinLock xTaskLock = { NULL, 0 };
+static xSpinLock xISRLock = { NULL, 0 };
+#endif
 /*-----------------------------------------------------------*/
 
 /*
- * Setup the timer to generate the tick interrupts.
+ * Run the tick source on the main thread until the scheduler ends.
  */
-static void prvSetupTimerInterrupt( void );
+static void prvRunTickSource( void );
 static void *prvWaitForStart( void * pvParams );
-static void prvSuspendSignalHandler(int sig);
-static void prvResumeSignalHandler(int sig);
 static void prvSetupSignalsAndSchedulerPolicy( void );
-static void prvSuspendThread( pthread_t xThreadId );
-static void prvResumeThread( pthread_t xThreadId );
-static pthread_t prvGetThreadHandle( xTaskHandle hTask );
+static void prvProcessTicks( void );
+static void prvServiceInterrupts( void );
+static portBASE_TYPE prvInterruptPending( portLONG lCore );
+static portBASE_TYPE prvInterruptQueued( void );
+static void prvDispatchInterrupts( void );
+static void prvForwardInterrupts( void );
+static void prvSwitchTask( portLONG lCore );
+static void prvSwitchThread( xThreadState *pxThreadToResume, xThreadState *pxThreadToSuspend, portLONG lCore );
+static void prvParkThread( xThreadState *pxThread );
+static void prvWakeThread( xThreadState *pxThread );
+static void prvWaitForWord( volatile int *piWord );
+static void prvPostWord( volatile int *piWord );
+static void prvInterruptThread( xThreadState *pxThread );
 static portLONG prvGetFreeThreadState( void );
-static void prvSetTaskCriticalNesting( pthread_t xThreadId, unsigned portBASE_TYPE uxNesting );
-static unsigned portBASE_TYPE prvGetTaskCriticalNesting( pthread_t xThreadId );
-static void prvDeleteThread( void *xThreadId );
+static void prvDeleteThread( void *pvThread );
+#if ( configNUMBER_OF_CORES > 1 )
+static void prvGetLock( xSpinLock *pxLock );
+static void prvReleaseLock( xSpinLock *pxLock );
+#endif
 /*-----------------------------------------------------------*/
 
 /*
@@ -137,48 +251,66 @@ void vPortSystemTickHandler( int sig );
 void vPortStartFirstTask( void );
 /*-----------------------------------------------------------*/
 
+/* The TCB is opaque here; its first member is the pxTopOfStack value returned
+by pxPortInitialiseStack(). */
+typedef void tskTCB;
+#if ( configNUMBER_OF_CORES == 1 )
+extern volatile tskTCB * volatile pxCurrentTCB;
+#define prvGetCurrentTCB( lCore )		( pxCurrentTCB )
+#else
+extern volatile tskTCB * volatile pxCurrentTCBs[ configNUMBER_OF_CORES ];
+#define prvGetCurrentTCB( lCore )		( pxCurrentTCBs[ lCore ] )
+#endif
+
+/* The thread state of a task, read through the word pxTopOfStack points at. */
+#define prvGetThreadState( pxTCB )		( ( xThreadState * )**( portSTACK_TYPE ** )( pxTCB ) )
+/*-----------------------------------------------------------*/
+
 /*
  * See header file for description.
  */
 portSTACK_TYPE *pxPortInitialiseStack( portSTACK_TYPE *pxTopOfStack, pdTASK_CODE pxCode, void *pvParameters )
 {
-/* Should actually keep this struct on the stack. */
-xParams *pxThisThreadParams = pvPortMalloc( sizeof( xParams ) );
+/* The new thread copies its parameters before the creator carries on. */
+xParams xThisThreadParams;
+xThreadState *pxThread;
 
 	(void)pthread_once( &hSigSetupThread, prvSetupSignalsAndSchedulerPolicy );
 
-	if ( (pthread_t)NULL == hMainThread )
-	{
-		hMainThread = pthread_self();
-	}
-
 	/* No need to join the threads. */
 	pthread_attr_init( &xThreadAttributes );
 	pthread_attr_setdetachstate( &xThreadAttributes, PTHREAD_CREATE_DETACHED );
 
-	/* Add the task parameters. */
-	pxThisThreadParams->pxCode = pxCode;
-	pxThisThreadParams->pvParams = pvParameters;
-
 	vPortEnterCritical();
 
-	lIndexOfLastAddedTask = prvGetFreeThreadState();
+	pxThread = &pxThreads[ prvGetFreeThreadState() ];
+	pxThread->uxCriticalNesting = 0;
+	pxThread->xInterruptsEnabled = pdFALSE;
+	pxThread->lCore = 0;
+	pxThread->iRunToken = 0;
+	pxThread->xDying = pdFALSE;
+
+	/* Add the task parameters. */
+	xThisThreadParams.pxCode = pxCode;
+	xThisThreadParams.pvParams = pvParameters;
+	xThisThreadParams.pxThread = pxThread;
+
+	/* Link the task to its thread through the otherwise unused stack. */
+	*pxTopOfStack = ( portSTACK_TYPE )pxThread;
 
 	/* Create the new pThread. */
-	if ( 0 == pthread_mutex_lock( &xSingleThreadMutex ) )
+	iThreadStarted = 0;
+	if ( 0 != pthread_create( &( pxThread->hThread ), &xThreadAttributes, prvWaitForStart, (void *)&xThisThreadParams ) )
 	{
-		xSentinel = 0;
-		if ( 0 != pthread_create( &( pxThreads[ lIndexOfLastAddedTask ].hThread ), &xThreadAttributes, prvWaitForStart, (void *)pxThisThreadParams ) )
-		{
-			/* Thread create failed, signal the failure */
-			pxTopOfStack = 0;
-		}
-
-		/* Wait until the task suspends. */
-		(void)pthread_mutex_unlock( &xSingleThreadMutex );
-		while ( xSentinel == 0 );
-		vPortExitCritical();
+		/* Thread create failed, signal the failure */
+		pxTopOfStack = 0;
+	}
+	else
+	{
+		/* Sleep until the thread is ready to be scheduled. */
+		prvWaitForWord( &iThreadStarted );
 	}
+	vPortExitCritical();
 
 	return pxTopOfStack;
 }
@@ -186,14 +318,20 @@ xParams *pxThisThreadParams = pvPortMalloc( sizeof( xParams ) );
 
 void vPortStartFirstTask( void )
 {
-	/* Initialise the critical nesting count ready for the first task. */
-	uxCriticalNesting = 0;
+portLONG lCore;
 
-	/* Start the first task. */
-	vPortEnableInterrupts();
+	/* Place the task the kernel selected for each core on that core. */
+	for ( lCore = 0; lCore < configNUMBER_OF_CORES; lCore++ )
+	{
+		pxRunningThreads[ lCore ] = prvGetThreadState( prvGetCurrentTCB( lCore ) );
+		pxRunningThreads[ lCore ]->lCore = lCore;
+	}
 
-	/* Start the first task. */
-	prvResumeThread( prvGetThreadHandle( xTaskGetCurrentTaskHandle() ) );
+	/* Start the first tasks. */
+	for ( lCore = 0; lCore < configNUMBER_OF_CORES; lCore++ )
+	{
+		prvWakeThread( pxRunningThreads[ lCore ] );
+	}
 }
 /*-----------------------------------------------------------*/
 
@@ -202,9 +340,6 @@ void vPortStartFirstTask( void )
  */
 portBASE_TYPE xPortStartScheduler( void )
 {
-portBASE_TYPE xResult;
-int iSignal;
-sigset_t xSignals;
 sigset_t xSignalToBlock;
 sigset_t xSignalsBlocked;
 portLONG lIndex;
@@ -219,55 +354,48 @@ portLONG lIndex;
 	{
 		pxThreads[ lIndex ].uxCriticalNesting = 0;
 	}
+	xMainThread.uxCriticalNesting = 0;
 
-	/* Start the timer that generates the tick ISR.  Interrupts are disabled
-	here already. */
-	prvSetupTimerInterrupt();
-
-	/* Start the first task. Will not return unless all threads are killed. */
+	/* Start the first task. */
 	vPortStartFirstTask();
 
-	/* This is the end signal we are looking for. */
-	sigemptyset( &xSignals );
-	sigaddset( &xSignals, SIG_RESUME );
-
-	while ( pdTRUE != xSchedulerEnd )
-	{
-		if ( 0 != sigwait( &xSignals, &iSignal ) )
-		{
-			printf( "Main thread spurious signal: %d\n", iSignal );
-		}
-	}
+	/* Generate the tick interrupts until the scheduler ends. */
+	prvRunTickSource();
 
 	printf( "Cleaning Up, Exiting.\n" );
-	/* Cleanup the mutexes */
-	xResult = pthread_mutex_destroy( &xSuspendResumeThreadMutex );
-	xResult = pthread_mutex_destroy( &xSingleThreadMutex );
 	vPortFree( (void *)pxThreads );
 
 	/* Should not get here! */
-	return xResult;
+	return pdFALSE;
 }
 /*-----------------------------------------------------------*/
 
 void vPortEndScheduler( void )
 {
 portBASE_TYPE xNumberOfThreads;
-portBASE_TYPE xResult;
+portLONG lCore;
+portBASE_TYPE xRunning;
 	for ( xNumberOfThreads = 0; xNumberOfThreads < MAX_NUMBER_OF_TASKS; xNumberOfThreads++ )
 	{
-		if ( ( pthread_t )NULL != pxThreads[ xNumberOfThreads ].hThread )
+		xRunning = pdFALSE;
+		for ( lCore = 0; lCore < configNUMBER_OF_CORES; lCore++ )
+		{
+			if ( &pxThreads[ xNumberOfThreads ] == pxRunningThreads[ lCore ] )
+			{
+				xRunning = pdTRUE;
+			}
+		}
+
+		if ( ( ( pthread_t )NULL != pxThreads[ xNumberOfThreads ].hThread ) && ( pdFALSE == xRunning ) )
 		{
-			/* Kill all of the threads, they are in the detached state. */
-			xResult = pthread_cancel( pxThreads[ xNumberOfThreads ].hThread );
-            if (xResult)
-                printf("pthread_cancel error!\n");
+			/* Parked threads are not at a cancellation point, wake them to exit. */
+			pxThreads[ xNumberOfThreads ].xDying = pdTRUE;
+			prvWakeThread( &pxThreads[ xNumberOfThreads ] );
 		}
 	}
 
-	/* Signal the scheduler to exit its loop. */
+	/* The tick source stops and returns to xPortStartScheduler() within a tick. */
 	xSchedulerEnd = pdTRUE;
-	(void)pthread_kill( hMainThread, SIG_RESUME );
 }
 /*-----------------------------------------------------------*/
 
@@ -277,242 +405,569 @@ void vPortYieldFromISR( void )
 	 * xSingleThreadMutex is already owned by an original call to Yield. Therefore,
 	 * simply indicate that a yield is required soon.
 	 */
-	xPendYield = pdTRUE;
+	__atomic_store_n( &xYieldRequests[ pxThisThread->lCore ], pdTRUE, __ATOMIC_SEQ_CST );
 }
 /*-----------------------------------------------------------*/
 
 void vPortEnterCritical( void )
 {
-	vPortDisableInterrupts();
-	uxCriticalNesting++;
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+
+#if ( configNUMBER_OF_CORES > 1 )
+	if ( 0 == pxThisThread->uxCriticalNesting )
+	{
+		for ( ;; )
+		{
+			prvGetLock( &xTaskLock );
+			prvGetLock( &xISRLock );
+
+			/* Another core may have deleted, suspended or moved this task and
+			asked this core to switch away from it.  Once a lock is held the
+			kernel would treat the task as running, so take the switch first, as
+			the pending interrupt would have been taken just before the critical
+			section on hardware. */
+			if ( ( pdFALSE == xInterruptsWereEnabled ) || ( pdFALSE == __atomic_load_n( &xYieldRequests[ pxThisThread->lCore ], __ATOMIC_SEQ_CST ) ) ||
+				 ( pxRunningThreads[ pxThisThread->lCore ] != pxThisThread ) )
+			{
+				break;
+			}
+
+			prvReleaseLock( &xISRLock );
+			prvReleaseLock( &xTaskLock );
+			prvServiceInterrupts();
+			(void)xPortSetInterruptMask();
+		}
+	}
+#else
+	(void)xInterruptsWereEnabled;
+#endif
+
+	pxThisThread->uxCriticalNesting++;
 }
 /*-----------------------------------------------------------*/
 
 void vPortExitCritical( void )
 {
 	/* Check for unmatched exits. */
-	if ( uxCriticalNesting > 0 )
+	if ( pxThisThread->uxCriticalNesting > 0 )
 	{
-		uxCriticalNesting--;
+		pxThisThread->uxCriticalNesting--;
 	}
 
 	/* If we have reached 0 then re-enable the interrupts. */
-	if( uxCriticalNesting == 0 )
+	if( pxThisThread->uxCriticalNesting == 0 )
 	{
-		/* Have we missed ticks? This is the equivalent of pending an interrupt. */
-		if ( pdTRUE == xPendYield )
-		{
-			xPendYield = pdFALSE;
-			vPortYield();
-		}
-		vPortEnableInterrupts();
+#if ( configNUMBER_OF_CORES > 1 )
+		prvReleaseLock( &xISRLock );
+		prvReleaseLock( &xTaskLock );
+#endif
+
+		/* Take the ticks and yields that were held off, the equivalent of
+		pending interrupts firing. */
+		prvServiceInterrupts();
 	}
 }
 /*-----------------------------------------------------------*/
 
 void vPortYield( void )
 {
-pthread_t xTaskToSuspend;
-pthread_t xTaskToResume;
+portBASE_TYPE xInterruptsWereEnabled;
 
-	if ( 0 == pthread_mutex_lock( &xSingleThreadMutex ) )
+#if ( configNUMBER_OF_CORES > 1 )
+	if ( 0 != pxThisThread->uxCriticalNesting )
 	{
-		xTaskToSuspend = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
+		/* Other cores spin on the locks this task holds, so the task keeps
+		its core until it leaves the critical section. */
+		__atomic_store_n( &xYieldRequests[ pxThisThread->lCore ], pdTRUE, __ATOMIC_SEQ_CST );
+		return;
+	}
+#endif
 
-		vTaskSwitchContext();
+	/* Hold off the tick while the next task is selected. */
+	xInterruptsWereEnabled = xPortSetInterruptMask();
 
-		xTaskToResume = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
-		if ( xTaskToSuspend != xTaskToResume )
-		{
-			/* Remember and switch the critical nesting. */
-			prvSetTaskCriticalNesting( xTaskToSuspend, uxCriticalNesting );
-			uxCriticalNesting = prvGetTaskCriticalNesting( xTaskToResume );
-			/* Switch tasks. */
-			prvResumeThread( xTaskToResume );
-			prvSuspendThread( xTaskToSuspend );
-		}
-		else
-		{
-			/* Yielding to self */
-			(void)pthread_mutex_unlock( &xSingleThreadMutex );
-		}
+	prvSwitchTask( pxThisThread->lCore );
+
+	/* Running again, possibly much later and on another core.  Service what
+	arrived during the switch if this task had interrupts enabled. */
+	if ( pdTRUE == xInterruptsWereEnabled )
+	{
+		prvServiceInterrupts();
 	}
 }
 /*-----------------------------------------------------------*/
 
 void vPortDisableInterrupts( void )
 {
-	xInterruptsEnabled = pdFALSE;
+	pxThisThread->xInterruptsEnabled = pdFALSE;
 }
 /*-----------------------------------------------------------*/
 
 void vPortEnableInterrupts( void )
 {
-	xInterruptsEnabled = pdTRUE;
+	pxThisThread->xInterruptsEnabled = pdTRUE;
 }
 /*-----------------------------------------------------------*/
 
 portBASE_TYPE xPortSetInterruptMask( void )
 {
-portBASE_TYPE xReturn = xInterruptsEnabled;
-	xInterruptsEnabled = pdFALSE;
+portBASE_TYPE xReturn = pxThisThread->xInterruptsEnabled;
+	pxThisThread->xInterruptsEnabled = pdFALSE;
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
 
 void vPortClearInterruptMask( portBASE_TYPE xMask )
 {
-	xInterruptsEnabled = xMask;
+	if ( ( pdTRUE == xMask ) && ( 0 == pxThisThread->uxCriticalNesting ) )
+	{
+		/* Unmasking takes anything that is pending. */
+		prvServiceInterrupts();
+	}
+	else
+	{
+		pxThisThread->xInterruptsEnabled = xMask;
+	}
+}
+/*-----------------------------------------------------------*/
+
+#if ( configNUMBER_OF_CORES > 1 )
+
+portBASE_TYPE xPortEnterCriticalFromISR( void )
+{
+portBASE_TYPE xReturn = xPortSetInterruptMask();
+	prvGetLock( &xISRLock );
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCriticalFromISR( portBASE_TYPE xMask )
+{
+	prvReleaseLock( &xISRLock );
+	vPortClearInterruptMask( xMask );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortGetCoreID( void )
+{
+	return ( portBASE_TYPE )pxThisThread->lCore;
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldCore( portBASE_TYPE xCore )
+{
+	/* Called by the kernel holding the ISR lock, so the core cannot switch
+	threads before it is interrupted.  The calling core takes its own request
+	when it next enables interrupts. */
+	__atomic_store_n( &xYieldRequests[ xCore ], pdTRUE, __ATOMIC_SEQ_CST );
+	if ( xCore != pxThisThread->lCore )
+	{
+		prvInterruptThread( pxRunningThreads[ xCore ] );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetTaskLock( void )
+{
+	prvGetLock( &xTaskLock );
+}
+/*-----------------------------------------------------------*/
+
+void vPortReleaseTaskLock( void )
+{
+	prvReleaseLock( &xTaskLock );
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetISRLock( void )
+{
+	prvGetLock( &xISRLock );
+}
+/*-----------------------------------------------------------*/
+
+void vPortReleaseISRLock( void )
+{
+	prvReleaseLock( &xISRLock );
+}
+/*-----------------------------------------------------------*/
+
+void prvGetLock( xSpinLock *pxLock )
+{
+xThreadState *pxExpected;
+
+	/* Only this thread can have made itself the owner. */
+	if ( pxThisThread == __atomic_load_n( &pxLock->pxOwner, __ATOMIC_RELAXED ) )
+	{
+		pxLock->uxCount++;
+	}
+	else
+	{
+		for ( ;; )
+		{
+			pxExpected = NULL;
+			if ( __atomic_compare_exchange_n( &pxLock->pxOwner, &pxExpected, pxThisThread, pdFALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+			{
+				break;
+			}
+
+			/* The owner may be waiting for the host core this thread is on. */
+			sched_yield();
+		}
+		pxLock->uxCount = 1;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void prvReleaseLock( xSpinLock *pxLock )
+{
+	if ( 0 == --pxLock->uxCount )
+	{
+		__atomic_store_n( &pxLock->pxOwner, NULL, __ATOMIC_RELEASE );
+	}
 }
 /*-----------------------------------------------------------*/
 
+#endif /* configNUMBER_OF_CORES */
+/*-----------------------------------------------------------*/
+
 /*
  * Setup the systick timer to generate the tick interrupts at the required
  * frequency.
  */
-void prvSetupTimerInterrupt( void )
+void prvRunTickSource( void )
 {
-struct itimerval itimer, oitimer;
-portTickType xMicroSeconds = portTICK_PERIOD_MS * 1000;
+struct timespec xNow;
+struct timespec xDeadline;
+unsigned long long ullStart;
+unsigned long long ullNext;
+unsigned long long ullTicksDue;
+portBASE_TYPE xSleeping;
+
+	(void)clock_gettime( portTICK_CLOCK, &xNow );
+	ullStart = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
 
-	/* Initialise the structure with the current timer information. */
-	if ( 0 == getitimer( TIMER_TYPE, &itimer ) )
+	while ( pdTRUE != xSchedulerEnd )
 	{
-		/* Set the interval between timer events. */
-		itimer.it_interval.tv_sec = 0;
-		itimer.it_interval.tv_usec = xMicroSeconds;
+		/* While the idle task sleeps, skip the ticks it does not need. */
+		__atomic_store_n( &iTickSourceWake, 0, __ATOMIC_SEQ_CST );
+		ullNext = __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST );
+		xSleeping = ( ullNext > ullTicksIssued + 1 ) ? pdTRUE : pdFALSE;
+		if ( pdFALSE == xSleeping )
+		{
+			ullNext = ullTicksIssued + 1;
+		}
 
-		/* Set the current count-down. */
-		itimer.it_value.tv_sec = 0;
-		itimer.it_value.tv_usec = xMicroSeconds;
+		/* Deadlines are absolute, so time spent late does not accumulate. */
+		ullNext = ullStart + ullNext * portTICK_PERIOD_NS;
+		xDeadline.tv_sec = ( time_t )( ullNext / 1000000000ULL );
+		xDeadline.tv_nsec = ( long )( ullNext % 1000000000ULL );
+		if ( pdTRUE == xSleeping )
+		{
+			/* An interrupt can end the idle sleep early, and the idle task then
+			wakes us to carry on ticking.  The futex measures the deadline on
+			CLOCK_MONOTONIC. */
+			(void)syscall( SYS_futex, &iTickSourceWake, FUTEX_WAIT_BITSET_PRIVATE, 0, &xDeadline, NULL, FUTEX_BITSET_MATCH_ANY );
+		}
+		else
+		{
+			(void)clock_nanosleep( portTICK_CLOCK, TIMER_ABSTIME, &xDeadline, NULL );
+		}
 
-		/* Set-up the timer interrupt. */
-		if ( 0 != setitimer( TIMER_TYPE, &itimer, &oitimer ) )
+		/* Count every period that has passed, including any the host slept
+		through, and have the running task process them all. */
+		(void)clock_gettime( portTICK_CLOCK, &xNow );
+		ullTicksDue = ( ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec - ullStart ) / portTICK_PERIOD_NS;
+		if ( ( ullTicksDue > ullTicksIssued ) && ( ullTicksDue >= __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) ) )
 		{
-			printf( "Set Timer problem.\n" );
+			__atomic_add_fetch( &uxPendedTicks, ( unsigned portBASE_TYPE )( ullTicksDue - ullTicksIssued ), __ATOMIC_SEQ_CST );
+			__atomic_store_n( &ullTicksIssued, ullTicksDue, __ATOMIC_SEQ_CST );
+			if ( 0 != __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) )
+			{
+				prvPostWord( &iIdleWake );
+			}
+			prvInterruptThread( pxRunningThreads[ 0 ] );
 		}
 	}
-	else
+}
+/*-----------------------------------------------------------*/
+
+void vPortSystemTickHandler( int sig )
+{
+	(void)(sig);
+	if ( pxRunningThreads[ pxThisThread->lCore ] != pxThisThread )
+	{
+		/* This thread was switched out after the interrupt was sent to it. */
+		prvForwardInterrupts();
+	}
+	else if ( pdTRUE == pxThisThread->xInterruptsEnabled )
 	{
-		printf( "Get Timer problem.\n" );
+		prvServiceInterrupts();
 	}
+
+	/* Otherwise the interrupt stays pending until the running task re-enables
+	interrupts. */
 }
 /*-----------------------------------------------------------*/
 
-void vPortSystemTickHandler( int sig )
+void prvProcessTicks( void )
 {
-pthread_t xTaskToSuspend;
-pthread_t xTaskToResume;
+unsigned portBASE_TYPE uxTicks;
 
-    (void)(sig);
-	if ( ( pdTRUE == xInterruptsEnabled ) && ( pdTRUE != xServicingTick ) )
-	{
-		if ( 0 == pthread_mutex_trylock( &xSingleThreadMutex ) )
-		{
-			xServicingTick = pdTRUE;
+	/* Called on core 0 with interrupts masked, as a tick ISR would run. */
 
-			xTaskToSuspend = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
-			/* Tick Increment. */
-			xTaskIncrementTick();
+	/* Catch up on every tick counted since the last service in one pass. */
+	while ( 0 != ( uxTicks = __atomic_exchange_n( &uxPendedTicks, 0, __ATOMIC_SEQ_CST ) ) )
+	{
+		(void)xTaskCatchUpTicks( ( TickType_t )uxTicks );
+	}
 
-			/* Select Next Task. */
+	/* Select Next Task. */
 #if ( configUSE_PREEMPTION == 1 )
-			vTaskSwitchContext();
+	prvSwitchTask( 0 );
 #endif
-			xTaskToResume = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
+}
+/*-----------------------------------------------------------*/
 
-			/* The only thread that can process this tick is the running thread. */
-			if ( xTaskToSuspend != xTaskToResume )
-			{
-				/* Remember and switch the critical nesting. */
-				prvSetTaskCriticalNesting( xTaskToSuspend, uxCriticalNesting );
-				uxCriticalNesting = prvGetTaskCriticalNesting( xTaskToResume );
-				/* Resume next task. */
-				prvResumeThread( xTaskToResume );
-				/* Suspend the current task. */
-				prvSuspendThread( xTaskToSuspend );
-			}
-			else
+void prvServiceInterrupts( void )
+{
+portLONG lCore;
+
+	/* Called outside any critical section; returns with interrupts enabled. */
+	for ( ;; )
+	{
+		vPortDisableInterrupts();
+
+		/* Read after masking, the core cannot change until the next switch. */
+		lCore = pxThisThread->lCore;
+
+		if ( pxRunningThreads[ lCore ] != pxThisThread )
+		{
+			/* Only the running thread of a core takes its interrupts.  This
+			is the main thread before the scheduler starts. */
+			vPortEnableInterrupts();
+			break;
+		}
+		else if ( ( 0 == lCore ) && ( 0 != __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST ) ) )
+		{
+			/* The tick selects the next task itself. */
+			__atomic_store_n( &xYieldRequests[ 0 ], pdFALSE, __ATOMIC_SEQ_CST );
+			prvProcessTicks();
+		}
+		else if ( ( 0 == lCore ) && ( pdTRUE == prvInterruptQueued() ) )
+		{
+			/* Handlers that wake a task set the yield request. */
+			prvDispatchInterrupts();
+		}
+		else if ( pdFALSE != __atomic_exchange_n( &xYieldRequests[ lCore ], pdFALSE, __ATOMIC_SEQ_CST ) )
+		{
+			prvSwitchTask( lCore );
+		}
+		else
+		{
+			vPortEnableInterrupts();
+
+			/* A signal that arrived while interrupts were masked was dropped,
+			so look once more now that they are enabled. */
+			if ( pdFALSE == prvInterruptPending( pxThisThread->lCore ) )
 			{
-				/* Release the lock as we are Resuming. */
-				(void)pthread_mutex_unlock( &xSingleThreadMutex );
+				break;
 			}
-			xServicingTick = pdFALSE;
 		}
-		else
+	}
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE prvInterruptPending( portLONG lCore )
+{
+	return ( ( ( 0 == lCore ) && ( 0 != __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST ) ) ) ||
+			( ( 0 == lCore ) && ( pdTRUE == prvInterruptQueued() ) ) ||
+			( pdFALSE != __atomic_load_n( &xYieldRequests[ lCore ], __ATOMIC_SEQ_CST ) ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE prvInterruptQueued( void )
+{
+unsigned long ulTail = __atomic_load_n( &ulInterruptQueueTail, __ATOMIC_SEQ_CST );
+xRaisedInterrupt *pxSlot = &xInterruptQueue[ ulTail & portINTERRUPT_QUEUE_MASK ];
+
+	/* An interrupt is waiting once the slot at the tail has been filled. */
+	return ( __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_SEQ_CST ) == ( ulTail & ~portINTERRUPT_QUEUE_MASK ) + 1UL ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void prvDispatchInterrupts( void )
+{
+/* Called on core 0 with interrupts masked, which makes this the only reader
+of the queue. */
+unsigned long ulTail = ulInterruptQueueTail;
+unsigned long ulCount = 0;
+unsigned long ulIndex;
+xRaisedInterrupt *pxSlot;
+xRaisedInterrupt xRaised;
+SimulatedInterruptHandler_t pxHandler;
+
+	/* Take what has been raised so far, sorted by priority; interrupts raised
+	by the handlers wait for the next pass. */
+	while ( ( ulCount < portINTERRUPT_QUEUE_LENGTH ) && ( pdTRUE == prvInterruptQueued() ) )
+	{
+		pxSlot = &xInterruptQueue[ ulTail & portINTERRUPT_QUEUE_MASK ];
+		xRaised.uxInterruptNumber = pxSlot->uxInterruptNumber;
+		xRaised.pvParameter = pxSlot->pvParameter;
+
+		/* Free the slot for the next lap. */
+		__atomic_store_n( &pxSlot->ulSequence, ( ulTail & ~portINTERRUPT_QUEUE_MASK ) + portINTERRUPT_QUEUE_LENGTH, __ATOMIC_SEQ_CST );
+		ulTail++;
+		__atomic_store_n( &ulInterruptQueueTail, ulTail, __ATOMIC_SEQ_CST );
+
+		/* Insertion keeps interrupts of equal priority in the order raised. */
+		for ( ulIndex = ulCount; ( ulIndex > 0 ) && ( xInterruptHandlers[ xInterruptsToDispatch[ ulIndex - 1 ].uxInterruptNumber ].uxPriority < xInterruptHandlers[ xRaised.uxInterruptNumber ].uxPriority ); ulIndex-- )
 		{
-			xPendYield = pdTRUE;
+			xInterruptsToDispatch[ ulIndex ] = xInterruptsToDispatch[ ulIndex - 1 ];
 		}
+		xInterruptsToDispatch[ ulIndex ] = xRaised;
+		ulCount++;
 	}
-	else
+
+	for ( ulIndex = 0; ulIndex < ulCount; ulIndex++ )
 	{
-		xPendYield = pdTRUE;
+		pxHandler = xInterruptHandlers[ xInterruptsToDispatch[ ulIndex ].uxInterruptNumber ].pxHandler;
+		if ( ( NULL != pxHandler ) && ( pdFALSE != pxHandler( xInterruptsToDispatch[ ulIndex ].pvParameter ) ) )
+		{
+			vPortYieldFromISR();
+		}
 	}
 }
 /*-----------------------------------------------------------*/
 
-void vPortForciblyEndThread( void *pxTaskToDelete )
+void vPortSetInterruptHandler( UBaseType_t uxInterruptNumber, UBaseType_t uxPriority, SimulatedInterruptHandler_t pxHandler )
+{
+	if ( uxInterruptNumber < portMAX_INTERRUPTS )
+	{
+		vPortEnterCritical();
+		xInterruptHandlers[ uxInterruptNumber ].uxPriority = uxPriority;
+		xInterruptHandlers[ uxInterruptNumber ].pxHandler = pxHandler;
+		vPortExitCritical();
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortGenerateSimulatedInterrupt( UBaseType_t uxInterruptNumber, void *pvParameter )
 {
-xTaskHandle hTaskToDelete = ( xTaskHandle )pxTaskToDelete;
-pthread_t xTaskToDelete;
-pthread_t xTaskToResume;
-portBASE_TYPE xResult;
+unsigned long ulPosition;
+unsigned long ulLap;
+long lDifference;
+xRaisedInterrupt *pxSlot;
 
-	if ( 0 == pthread_mutex_lock( &xSingleThreadMutex ) )
+	if ( uxInterruptNumber >= portMAX_INTERRUPTS )
 	{
-		xTaskToDelete = prvGetThreadHandle( hTaskToDelete );
-		xTaskToResume = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
+		return pdFAIL;
+	}
 
-		if ( xTaskToResume == xTaskToDelete )
-		{
-			/* This is a suicidal thread, need to select a different task to run. */
-			vTaskSwitchContext();
-			xTaskToResume = prvGetThreadHandle( xTaskGetCurrentTaskHandle() );
-		}
+	/* Claim the slot at the head.  Producers race only for the head index. */
+	for ( ;; )
+	{
+		ulPosition = __atomic_load_n( &ulInterruptQueueHead, __ATOMIC_RELAXED );
+		ulLap = ulPosition & ~portINTERRUPT_QUEUE_MASK;
+		pxSlot = &xInterruptQueue[ ulPosition & portINTERRUPT_QUEUE_MASK ];
+		lDifference = ( long )( __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_ACQUIRE ) - ulLap );
 
-		if ( pthread_self() != xTaskToDelete )
+		if ( 0 == lDifference )
 		{
-			/* Cancelling a thread that is not me. */
-			if ( xTaskToDelete != ( pthread_t )NULL )
+			if ( __atomic_compare_exchange_n( &ulInterruptQueueHead, &ulPosition, ulPosition + 1UL, pdFALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
 			{
-				/* Send a signal to wake the task so that it definitely cancels. */
-				pthread_testcancel();
-				xResult = pthread_cancel( xTaskToDelete );
-                if (xResult)
-                    printf("pthread_cancel error!\n");
-				/* Pthread Clean-up function will note the cancellation. */
+				break;
 			}
-			(void)pthread_mutex_unlock( &xSingleThreadMutex );
 		}
-		else
+		else if ( lDifference < 0 )
 		{
-			/* Resume the other thread. */
-			prvResumeThread( xTaskToResume );
-			/* Pthread Clean-up function will note the cancellation. */
-			/* Release the execution. */
-			uxCriticalNesting = 0;
-			vPortEnableInterrupts();
-			(void)pthread_mutex_unlock( &xSingleThreadMutex );
-			/* Commit suicide */
-			pthread_exit( (void *)1 );
+			/* The slot still holds an interrupt from the last lap. */
+			return pdFAIL;
+		}
+	}
+
+	pxSlot->uxInterruptNumber = uxInterruptNumber;
+	pxSlot->pvParameter = pvParameter;
+	__atomic_store_n( &pxSlot->ulSequence, ulLap + 1UL, __ATOMIC_SEQ_CST );
+
+	/* Only the interrupt that made the queue non-empty needs to interrupt the
+	running task; the others are taken in the same pass. */
+	if ( ulPosition == __atomic_load_n( &ulInterruptQueueTail, __ATOMIC_SEQ_CST ) )
+	{
+		if ( 0 != __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) )
+		{
+			prvPostWord( &iIdleWake );
+		}
+		prvInterruptThread( pxRunningThreads[ 0 ] );
+	}
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+void prvForwardInterrupts( void )
+{
+portLONG lCore;
+xThreadState *pxRunning;
+
+	for ( lCore = 0; lCore < configNUMBER_OF_CORES; lCore++ )
+	{
+		pxRunning = pxRunningThreads[ lCore ];
+		if ( ( pxRunning != pxThisThread ) && ( pdTRUE == prvInterruptPending( lCore ) ) )
+		{
+			prvInterruptThread( pxRunning );
 		}
 	}
 }
 /*-----------------------------------------------------------*/
 
+void prvSwitchTask( portLONG lCore )
+{
+	/* Called with interrupts masked.  The thread of the selected task takes
+	over the core, and this thread waits until a core selects its task. */
+	vTaskSwitchContext();
+	prvSwitchThread( prvGetThreadState( prvGetCurrentTCB( lCore ) ), pxThisThread, lCore );
+}
+/*-----------------------------------------------------------*/
+
+void vPortForciblyEndThread( void *pxTaskToDelete )
+{
+xThreadState *pxThreadToDelete = prvGetThreadState( pxTaskToDelete );
+
+	/* Called as the TCB is freed, by which time a task that deleted itself has
+	long switched away, so the thread is always parked.  Wake it so that it
+	exits; the clean-up function releases its thread state. */
+	pxThreadToDelete->xDying = pdTRUE;
+	prvWakeThread( pxThreadToDelete );
+}
+/*-----------------------------------------------------------*/
+
 void *prvWaitForStart( void * pvParams )
 {
 xParams * pxParams = ( xParams * )pvParams;
 pdTASK_CODE pvCode = pxParams->pxCode;
 void * pParams = pxParams->pvParams;
-	vPortFree( pvParams );
+xThreadState * pxThread = pxParams->pxThread;
+sigset_t xSignals;
 
-	pthread_cleanup_push( prvDeleteThread, (void *)pthread_self() );
+	/* Interrupts use the state of the thread they run on. */
+	pxThisThread = pxThread;
 
-	if ( 0 == pthread_mutex_lock( &xSingleThreadMutex ) )
-	{
-		prvSuspendThread( pthread_self() );
-	}
+	/* The tick arrives as SIG_INTERRUPT, directed at this thread. */
+	sigemptyset( &xSignals );
+	sigaddset( &xSignals, SIG_INTERRUPT );
+	(void)pthread_sigmask( SIG_UNBLOCK, &xSignals, NULL );
+
+	pxThread->xThreadId = ( pid_t )syscall( SYS_gettid );
+
+	pthread_cleanup_push( prvDeleteThread, (void *)pxThread );
+
+	/* Let the creator continue and wait to be scheduled. */
+	prvPostWord( &iThreadStarted );
+	prvParkThread( pxThread );
+
+	/* First time this task runs; take anything pending for its core. */
+	pxThread->uxCriticalNesting = 0;
+	prvServiceInterrupts();
 
 	pvCode( pParams );
 
@@ -521,84 +976,74 @@ void * pParams = pxParams->pvParams;
 }
 /*-----------------------------------------------------------*/
 
-void prvSuspendSignalHandler(int sig)
+void prvSwitchThread( xThreadState *pxThreadToResume, xThreadState *pxThreadToSuspend, portLONG lCore )
 {
-sigset_t xSignals;
-
-	/* Only interested in the resume signal. */
-	sigemptyset( &xSignals );
-	sigaddset( &xSignals, SIG_RESUME );
-	xSentinel = 1;
-
-	/* Unlock the Single thread mutex to allow the resumed task to continue. */
-	if ( 0 != pthread_mutex_unlock( &xSingleThreadMutex ) )
+	if ( pxThreadToSuspend != pxThreadToResume )
 	{
-		printf( "Releasing someone else's lock.\n" );
+		/* Hand over with a single wake, then wait for our own turn.  Another
+		core may select this task and wake the thread before it parks, in
+		which case the park returns straight away. */
+		pxThreadToResume->lCore = lCore;
+		__atomic_store_n( &pxRunningThreads[ lCore ], pxThreadToResume, __ATOMIC_SEQ_CST );
+		prvWakeThread( pxThreadToResume );
+		prvParkThread( pxThreadToSuspend );
 	}
+}
+/*-----------------------------------------------------------*/
 
-	/* Wait on the resume signal. */
-	if ( 0 != sigwait( &xSignals, &sig ) )
-	{
-		printf( "SSH: Sw %d\n", sig );
-	}
+void prvParkThread( xThreadState *pxThread )
+{
+portLONG lSpin;
 
-	/* Will resume here when the SIG_RESUME signal is received. */
-	/* Need to set the interrupts based on the task's critical nesting. */
-	if ( uxCriticalNesting == 0 )
+	for ( lSpin = 0; ( lSpin < lParkSpinCount ) && ( 0 == __atomic_load_n( &pxThread->iRunToken, __ATOMIC_ACQUIRE ) ); lSpin++ )
 	{
-		vPortEnableInterrupts();
+		/* Spin briefly, the task switched to may hand straight back. */
 	}
-	else
+
+	prvWaitForWord( &pxThread->iRunToken );
+
+	if ( pdTRUE == pxThread->xDying )
 	{
-		vPortDisableInterrupts();
+		pthread_exit( (void *)1 );
 	}
 }
 /*-----------------------------------------------------------*/
 
-void prvSuspendThread( pthread_t xThreadId )
+void prvWakeThread( xThreadState *pxThread )
 {
-portBASE_TYPE xResult = pthread_mutex_lock( &xSuspendResumeThreadMutex );
-	if ( 0 == xResult )
-	{
-		/* Set-up for the Suspend Signal handler? */
-		xSentinel = 0;
-		xResult = pthread_mutex_unlock( &xSuspendResumeThreadMutex );
-		xResult = pthread_kill( xThreadId, SIG_SUSPEND );
-        if (xResult)
-            printf("pthread_kill error!\n");
-		while ( ( xSentinel == 0 ) && ( pdTRUE != xServicingTick ) )
-		{
-			sched_yield();
-		}
-	}
+	prvPostWord( &pxThread->iRunToken );
 }
 /*-----------------------------------------------------------*/
 
-void prvResumeSignalHandler(int sig)
+void prvWaitForWord( volatile int *piWord )
 {
-    (void)(sig);
-	/* Yield the Scheduler to ensure that the yielding thread completes. */
-	if ( 0 == pthread_mutex_lock( &xSingleThreadMutex ) )
+	/* FUTEX_WAIT returns straight away if the word has already been posted, so
+	a wake that arrives before we sleep is not lost.  Only system calls are used,
+	so this is safe inside the tick signal handler. */
+	while ( 0 == __atomic_load_n( piWord, __ATOMIC_ACQUIRE ) )
 	{
-		(void)pthread_mutex_unlock( &xSingleThreadMutex );
+		(void)syscall( SYS_futex, piWord, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0 );
 	}
+
+	/* Consume the post so that the next wait blocks again. */
+	*piWord = 0;
+}
+/*-----------------------------------------------------------*/
+
+void prvPostWord( volatile int *piWord )
+{
+	__atomic_store_n( piWord, 1, __ATOMIC_RELEASE );
+	(void)syscall( SYS_futex, piWord, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
 }
 /*-----------------------------------------------------------*/
 
-void prvResumeThread( pthread_t xThreadId )
+void prvInterruptThread( xThreadState *pxThread )
 {
-portBASE_TYPE xResult;
-	if ( 0 == pthread_mutex_lock( &xSuspendResumeThreadMutex ) )
+	/* Direct the tick at the kernel thread id; unlike pthread_kill() this is
+	harmless if the thread has just exited. */
+	if ( ( NULL != pxThread ) && ( 0 != pxThread->xThreadId ) )
 	{
-		if ( pthread_self() != xThreadId )
-		{
-			xResult = pthread_kill( xThreadId, SIG_RESUME );
-            if (xResult)
-                printf("pthread_kill error!\n");
-		}
-		xResult = pthread_mutex_unlock( &xSuspendResumeThreadMutex );
-        if (xResult)
-            printf("pthread_mutex_unlock error!\n");
+		(void)syscall( SYS_tgkill, getpid(), pxThread->xThreadId, SIG_INTERRUPT );
 	}
 }
 /*-----------------------------------------------------------*/
@@ -615,58 +1060,36 @@ int iSchedulerPriority;
 	iPolicy = SCHED_FIFO;
 	iResult = pthread_setschedparam( pthread_self(), iPolicy, &iSchedulerPriority );		*/
 
-struct sigaction sigsuspendself, sigresume, sigtick;
+struct sigaction siginterrupt;
 portLONG lIndex;
 
 	pxThreads = ( xThreadState *)pvPortMalloc( sizeof( xThreadState ) * MAX_NUMBER_OF_TASKS );
 	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
 	{
 		pxThreads[ lIndex ].hThread = ( pthread_t )NULL;
-		pxThreads[ lIndex ].hTask = ( xTaskHandle )NULL;
+		pxThreads[ lIndex ].xThreadId = 0;
 		pxThreads[ lIndex ].uxCriticalNesting = 0;
+		pxThreads[ lIndex ].xInterruptsEnabled = pdFALSE;
+		pxThreads[ lIndex ].lCore = 0;
+		pxThreads[ lIndex ].iRunToken = 0;
+		pxThreads[ lIndex ].xDying = pdFALSE;
 	}
 
-	sigsuspendself.sa_flags = 0;
-	sigsuspendself.sa_handler = prvSuspendSignalHandler;
-	sigfillset( &sigsuspendself.sa_mask );
-
-	sigresume.sa_flags = 0;
-	sigresume.sa_handler = prvResumeSignalHandler;
-	sigfillset( &sigresume.sa_mask );
-
-	sigtick.sa_flags = 0;
-	sigtick.sa_handler = vPortSystemTickHandler;
-	sigfillset( &sigtick.sa_mask );
+	siginterrupt.sa_flags = 0;
+	siginterrupt.sa_handler = vPortSystemTickHandler;
+	sigfillset( &siginterrupt.sa_mask );
 
-	if ( 0 != sigaction( SIG_SUSPEND, &sigsuspendself, NULL ) )
+	if ( 0 != sigaction( SIG_INTERRUPT, &siginterrupt, NULL ) )
 	{
-		printf( "Problem installing SIG_SUSPEND_SELF\n" );
+		printf( "Problem installing SIG_INTERRUPT\n" );
 	}
-	if ( 0 != sigaction( SIG_RESUME, &sigresume, NULL ) )
-	{
-		printf( "Problem installing SIG_RESUME\n" );
-	}
-	if ( 0 != sigaction( SIG_TICK, &sigtick, NULL ) )
-	{
-		printf( "Problem installing SIG_TICK\n" );
-	}
-	printf( "Running as PID: %d\n", getpid() );
-}
-/*-----------------------------------------------------------*/
 
-pthread_t prvGetThreadHandle( xTaskHandle hTask )
-{
-pthread_t hThread = ( pthread_t )NULL;
-portLONG lIndex;
-	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
+	/* Spinning only helps when the woken thread can run on another core. */
+	if ( sysconf( _SC_NPROCESSORS_ONLN ) > 1 )
 	{
-		if ( pxThreads[ lIndex ].hTask == hTask )
-		{
-			hThread = pxThreads[ lIndex ].hThread;
-			break;
-		}
+		lParkSpinCount = portPARK_SPIN_COUNT;
 	}
-	return hThread;
+	printf( "Running as PID: %d\n", getpid() );
 }
 /*-----------------------------------------------------------*/
 
@@ -692,96 +1115,107 @@ portLONG lIndex;
 }
 /*-----------------------------------------------------------*/
 
-void prvSetTaskCriticalNesting( pthread_t xThreadId, unsigned portBASE_TYPE uxNesting )
+void prvDeleteThread( void *pvThread )
 {
-portLONG lIndex;
-	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
-	{
-		if ( pxThreads[ lIndex ].hThread == xThreadId )
-		{
-			pxThreads[ lIndex ].uxCriticalNesting = uxNesting;
-			break;
-		}
-	}
+xThreadState *pxThread = ( xThreadState * )pvThread;
+
+	/* Runs on the exiting thread while another task may be running, so only
+	this thread's own state is touched, and the slot is released last. */
+	pxThread->xThreadId = 0;
+	pxThread->uxCriticalNesting = 0;
+	pxThread->xDying = pdFALSE;
+	__atomic_store_n( &pxThread->hThread, (pthread_t)NULL, __ATOMIC_RELEASE );
 }
 /*-----------------------------------------------------------*/
 
-unsigned portBASE_TYPE prvGetTaskCriticalNesting( pthread_t xThreadId )
+#if ( configUSE_VIRTUAL_TIME == 1 )
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
 {
-unsigned portBASE_TYPE uxNesting = 0;
-portLONG lIndex;
-	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+
+	/* The idle task calls this with the scheduler suspended.  Unless a task
+	became ready meanwhile, or no task waits with a timeout, jump to the tick
+	before the earliest unblock time and process that last tick here.  The
+	kernel holds it while the scheduler is suspended and replays it, which
+	unblocks the task, in xTaskResumeAll(). */
+	if ( eStandardSleep == eTaskConfirmSleepModeStatus() )
 	{
-		if ( pxThreads[ lIndex ].hThread == xThreadId )
-		{
-			uxNesting = pxThreads[ lIndex ].uxCriticalNesting;
-			break;
-		}
+		vTaskStepTick( xExpectedIdleTime - 1 );
+		(void)xTaskIncrementTick();
 	}
-	return uxNesting;
+
+	vPortClearInterruptMask( xInterruptsWereEnabled );
 }
 /*-----------------------------------------------------------*/
 
-void prvDeleteThread( void *xThreadId )
+#elif ( configUSE_TICKLESS_IDLE != 0 )
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
 {
-portLONG lIndex;
-	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+unsigned portBASE_TYPE uxSleptTicks;
+
+	/* The idle task calls this with the scheduler suspended.  Ticks counted
+	but not yet processed mean the kernel is behind the tick source, so only
+	sleep when there are none. */
+	if ( ( eAbortSleep != eTaskConfirmSleepModeStatus() ) && ( 0 == __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST ) ) && ( pdFALSE == prvInterruptQueued() ) )
 	{
-		if ( pxThreads[ lIndex ].hThread == ( pthread_t )xThreadId )
+		/* Have the tick source stay quiet until the tick that unblocks the
+		next task.  The tick signal is held off by the mask, so this thread
+		sleeps until the tick source posts the ticks or an interrupt is
+		raised. */
+		__atomic_store_n( &iIdleWake, 0, __ATOMIC_SEQ_CST );
+		__atomic_store_n( &ullSleepUntilTick, __atomic_load_n( &ullTicksIssued, __ATOMIC_SEQ_CST ) + xExpectedIdleTime, __ATOMIC_SEQ_CST );
+		while ( ( 0 == __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST ) ) && ( pdFALSE == prvInterruptQueued() ) )
 		{
-			pxThreads[ lIndex ].hThread = (pthread_t)NULL;
-			pxThreads[ lIndex ].hTask = (xTaskHandle)NULL;
-			if ( pxThreads[ lIndex ].uxCriticalNesting > 0 )
-			{
-				uxCriticalNesting = 0;
-				vPortEnableInterrupts();
-			}
-			pxThreads[ lIndex ].uxCriticalNesting = 0;
-			break;
+			prvWaitForWord( &iIdleWake );
 		}
-	}
-}
-/*-----------------------------------------------------------*/
+		__atomic_store_n( &ullSleepUntilTick, 0ULL, __ATOMIC_SEQ_CST );
 
-void vPortAddTaskHandle( void *pxTaskHandle )
-{
-portLONG lIndex;
+		/* After an early wake the tick source counts the ticks slept through
+		and carries on ticking. */
+		prvPostWord( &iTickSourceWake );
 
-	pxThreads[ lIndexOfLastAddedTask ].hTask = ( xTaskHandle )pxTaskHandle;
-	for ( lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++ )
-	{
-		if ( pxThreads[ lIndex ].hThread == pxThreads[ lIndexOfLastAddedTask ].hThread )
+		/* Step over the ticks slept through up to the one before the unblock
+		time.  The rest, including the one that unblocks the task, are
+		processed as normal ticks once interrupts are enabled again. */
+		uxSleptTicks = __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST );
+		if ( uxSleptTicks > ( unsigned portBASE_TYPE )( xExpectedIdleTime - 1 ) )
 		{
-			if ( pxThreads[ lIndex ].hTask != pxThreads[ lIndexOfLastAddedTask ].hTask )
-			{
-				pxThreads[ lIndex ].hThread = ( pthread_t )NULL;
-				pxThreads[ lIndex ].hTask = NULL;
-				pxThreads[ lIndex ].uxCriticalNesting = 0;
-			}
+			uxSleptTicks = ( unsigned portBASE_TYPE )( xExpectedIdleTime - 1 );
 		}
+		__atomic_sub_fetch( &uxPendedTicks, uxSleptTicks, __ATOMIC_SEQ_CST );
+		vTaskStepTick( ( TickType_t )uxSleptTicks );
 	}
+
+	vPortClearInterruptMask( xInterruptsWereEnabled );
 }
 /*-----------------------------------------------------------*/
 
+#endif /* configUSE_VIRTUAL_TIME */
+
 void vPortFindTicksPerSecond( void )
 {
-	/* Needs to be reasonably high for accuracy. */
-	unsigned long ulTicksPerSecond = sysconf(_SC_CLK_TCK);
-	printf( "Timer Resolution for Run TimeStats is %ld ticks per second.\n", ulTicksPerSecond );
+struct timespec xNow;
+
+	/* Count from the start of the scheduler so a 32 bit counter lasts as long
+	as it can. */
+	(void)clock_gettime( portRUN_TIME_CLOCK, &xNow );
+	ullRunTimeStart = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
+	printf( "Timer Resolution for Run TimeStats is %llu ticks per second.\n", 1000000000ULL / portRUN_TIME_COUNTER_PERIOD_NS );
 }
 /*-----------------------------------------------------------*/
 
-unsigned long ulPortGetTimerValue( void )
+unsigned long long ullPortGetTimerValue( void )
 {
-struct tms xTimes;
-	unsigned long ulTotalTime = times( &xTimes );
-	/* Return the application code times.
-	 * The timer only increases when the application code is actually running
-	 * which means that the total execution times should add up to 100%.
-	 */
-	return ( unsigned long ) xTimes.tms_utime;
-
-	/* Should check ulTotalTime for being clock_t max minus 1. */
-	(void)ulTotalTime;
+struct timespec xNow;
+unsigned long long ullNow;
+
+	/* The kernel reads the counter on every context switch, so it needs a
+	resolution well below the tick period or short runs go uncounted. */
+	(void)clock_gettime( portRUN_TIME_CLOCK, &xNow );
+	ullNow = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
+	return ( ullNow - ullRunTimeStart ) / portRUN_TIME_COUNTER_PERIOD_NS;
 }
 /*-----------------------------------------------------------*/
@@ -65,26 +65,111 @@ extern void vPortYield( void );
 
 /*-----------------------------------------------------------*/
 
+/* Architecture specific optimisations. */
+#if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 1 )
+
+	/* Ready priorities are kept as a bitmap in uxTopReadyPriority, and the
+	highest is found by counting leading zeros.  A word is an unsigned long,
+	32 bits in the -m32 build the Makefile produces and 64 bits in a 64 bit
+	build. */
+	#define portREADY_BITMAP_BITS		( __SIZEOF_LONG__ * 8 )
+	#define portTOP_BIT( uxBitmap )		( ( UBaseType_t ) ( portREADY_BITMAP_BITS - 1 ) - ( UBaseType_t ) __builtin_clzl( uxBitmap ) )
+
+	#if ( configMAX_PRIORITIES <= portREADY_BITMAP_BITS )
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities )		( uxReadyPriorities ) |= ( 1UL << ( uxPriority ) )
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities )		( uxReadyPriorities ) &= ~( 1UL << ( uxPriority ) )
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities )	uxTopPriority = portTOP_BIT( uxReadyPriorities )
+
+	#else
+
+		/* Too many priorities for one word, so use two levels: bit n of
+		uxTopReadyPriority is set while word n of uxPortReadyPriorityGroups,
+		which holds priorities n * portREADY_BITMAP_BITS upwards, is not zero. */
+		#define portREADY_PRIORITY_GROUPS	( ( configMAX_PRIORITIES + portREADY_BITMAP_BITS - 1 ) / portREADY_BITMAP_BITS )
+
+		#if ( portREADY_PRIORITY_GROUPS > portREADY_BITMAP_BITS )
+			#error configMAX_PRIORITIES is too large for port optimised task selection
+		#endif
+
+		extern UBaseType_t uxPortReadyPriorityGroups[ portREADY_PRIORITY_GROUPS ];
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities )																\
+		{																																\
+			uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] |= ( 1UL << ( ( uxPriority ) % portREADY_BITMAP_BITS ) );	\
+			( uxReadyPriorities ) |= ( 1UL << ( ( uxPriority ) / portREADY_BITMAP_BITS ) );											\
+		}
+
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities )																\
+		{																																\
+			uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] &= ~( 1UL << ( ( uxPriority ) % portREADY_BITMAP_BITS ) );	\
+			if( uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] == 0UL )											\
+			{																															\
+				( uxReadyPriorities ) &= ~( 1UL << ( ( uxPriority ) / portREADY_BITMAP_BITS ) );										\
+			}																															\
+		}
+
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities )															\
+		{																																\
+		UBaseType_t uxTopGroup = portTOP_BIT( uxReadyPriorities );																		\
+			uxTopPriority = ( uxTopGroup * portREADY_BITMAP_BITS ) + portTOP_BIT( uxPortReadyPriorityGroups[ uxTopGroup ] );			\
+		}
+
+	#endif
+
+#endif /* configUSE_PORT_OPTIMISED_TASK_SELECTION */
+
+/* The delayed task wheel finds its first occupied slot by counting trailing
+zeros in a word of its occupancy bitmap. */
+#define portLOWEST_BIT( uxBitmap )		( ( UBaseType_t ) __builtin_ctzl( uxBitmap ) )
+
+/*-----------------------------------------------------------*/
+
 /* Critical section management. */
 extern BaseType_t xPortSetInterruptMask( void );
 extern void vPortClearInterruptMask( portBASE_TYPE xMask );
 
-#define portSET_INTERRUPT_MASK_FROM_ISR()		xPortSetInterruptMask()
-#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	vPortClearInterruptMask(x)
+#if ( configNUMBER_OF_CORES > 1 )
+	/* Interrupt handlers also take the ISR lock to keep out the interrupts of
+	other cores. */
+	extern BaseType_t xPortEnterCriticalFromISR( void );
+	extern void vPortExitCriticalFromISR( portBASE_TYPE xMask );
+	#define portSET_INTERRUPT_MASK_FROM_ISR()		xPortEnterCriticalFromISR()
+	#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	vPortExitCriticalFromISR(x)
+#else
+	#define portSET_INTERRUPT_MASK_FROM_ISR()		xPortSetInterruptMask()
+	#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	vPortClearInterruptMask(x)
+#endif
 
 extern void vPortDisableInterrupts( void );
 extern void vPortEnableInterrupts( void );
-#define portSET_INTERRUPT_MASK()	( vPortDisableInterrupts() )
-#define portCLEAR_INTERRUPT_MASK()	( vPortEnableInterrupts() )
+#define portSET_INTERRUPT_MASK()	xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK(x)	vPortClearInterruptMask(x)
 
-#define portDISABLE_INTERRUPTS()	portSET_INTERRUPT_MASK()
-#define portENABLE_INTERRUPTS()		portCLEAR_INTERRUPT_MASK()
+#define portDISABLE_INTERRUPTS()	vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()		vPortEnableInterrupts()
 
 extern void vPortEnterCritical( void );
 extern void vPortExitCritical( void );
 #define portENTER_CRITICAL()		vPortEnterCritical()
 #define portEXIT_CRITICAL()			vPortExitCritical()
 
+/* Multi-core simulation: one thread runs per core. */
+#if ( configNUMBER_OF_CORES > 1 )
+	extern BaseType_t xPortGetCoreID( void );
+	extern void vPortYieldCore( BaseType_t xCore );
+	extern void vPortGetTaskLock( void );
+	extern void vPortReleaseTaskLock( void );
+	extern void vPortGetISRLock( void );
+	extern void vPortReleaseISRLock( void );
+	#define portGET_CORE_ID()			xPortGetCoreID()
+	#define portYIELD_CORE( xCore )		vPortYieldCore( xCore )
+	#define portGET_TASK_LOCK()			vPortGetTaskLock()
+	#define portRELEASE_TASK_LOCK()		vPortReleaseTaskLock()
+	#define portGET_ISR_LOCK()			vPortGetISRLock()
+	#define portRELEASE_ISR_LOCK()		vPortReleaseISRLock()
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* Task function macros as described on the FreeRTOS.org WEB site. */
@@ -95,31 +180,60 @@ extern void vPortExitCritical( void );
 
 #define portOUTPUT_BYTE( a, b )
 
+/* Tickless idle: once every task is blocked the idle task stops the tick and
+sleeps until the next unblock time.  With virtual time it moves the tick count
+straight to that time instead of sleeping at all. */
+#if ( configUSE_TICKLESS_IDLE != 0 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )	vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#elif ( configUSE_VIRTUAL_TIME == 1 )
+	#error configUSE_TICKLESS_IDLE must be set to 1 when configUSE_VIRTUAL_TIME is 1
+#endif
+
+/* Simulated interrupts.  Host threads, or tasks, raise interrupt
+uxInterruptNumber with xPortGenerateSimulatedInterrupt(), which fails only when
+portINTERRUPT_QUEUE_LENGTH interrupts are already waiting.  Handlers run on the thread of the task running on core 0
+with interrupts masked, like an ISR, so they may use the FromISR API; they
+return pdTRUE when they woke a task that should run.  Waiting interrupts are
+taken highest priority first, at the next tick or yield point, and are held
+while interrupts are masked. */
+#define portMAX_INTERRUPTS			( 32 )
+typedef BaseType_t ( *SimulatedInterruptHandler_t )( void *pvParameter );
+extern void vPortSetInterruptHandler( UBaseType_t uxInterruptNumber, UBaseType_t uxPriority, SimulatedInterruptHandler_t pxHandler );
+extern BaseType_t xPortGenerateSimulatedInterrupt( UBaseType_t uxInterruptNumber, void *pvParameter );
+
+/* Ends the thread of a deleted task while its TCB is still valid.  Clean-up
+the application chains in with configCLEAN_UP_TCB() runs first. */
 extern void vPortForciblyEndThread( void *pxTaskToDelete );
-#define traceTASK_DELETE( pxTaskToDelete )		vPortForciblyEndThread( pxTaskToDelete )
-
-extern void vPortAddTaskHandle( void *pxTaskHandle );
-#define traceTASK_CREATE( pxNewTCB )			vPortAddTaskHandle( pxNewTCB )
-
-/* Posix Signal definitions that can be changed or read as appropriate. */
-#define SIG_SUSPEND					SIGUSR1
-#define SIG_RESUME					SIGUSR2
-
-/* Enable the following hash defines to make use of the real-time tick where time progresses at real-time. */
-#define SIG_TICK					SIGALRM
-#define TIMER_TYPE					ITIMER_REAL
-/* Enable the following hash defines to make use of the process tick where time progresses only when the process is executing.
-#define SIG_TICK					SIGVTALRM
-#define TIMER_TYPE					ITIMER_VIRTUAL		*/
-/* Enable the following hash defines to make use of the profile tick where time progresses when the process or system calls are executing.
-#define SIG_TICK					SIGPROF
-#define TIMER_TYPE					ITIMER_PROF */
-
-/* Make use of times(man 2) to gather run-time statistics on the tasks. */
+#ifndef configCLEAN_UP_TCB
+	#define configCLEAN_UP_TCB( pxTCB )
+#endif
+#define portCLEAN_UP_TCB( pxTCB )				do { configCLEAN_UP_TCB( pxTCB ); vPortForciblyEndThread( pxTCB ); } while( 0 )
+
+/* Posix Signal definitions that can be changed or read as appropriate.
+SIG_INTERRUPT delivers the tick to the thread of the running task. */
+#define SIG_INTERRUPT				SIGUSR1
+
+/* Enable the following hash define to make use of the real-time tick where time progresses at real-time. */
+#define portTICK_CLOCK				CLOCK_MONOTONIC
+/* Enable the following hash define to make use of the process tick where time progresses only when the process is executing.
+#define portTICK_CLOCK				CLOCK_PROCESS_CPUTIME_ID		*/
+
+/* Enable the following hash define to charge tasks for the real time they hold the processor.  */
+#define portRUN_TIME_CLOCK			CLOCK_MONOTONIC
+/* Enable the following hash define to leave out time the host gives to other processes.
+#define portRUN_TIME_CLOCK			CLOCK_PROCESS_CPUTIME_ID		*/
+
+/* Nanoseconds per run time stats count.  A 64 bit configRUN_TIME_COUNTER_TYPE
+counts nanoseconds; a 32 bit one counts microseconds, which wraps after about
+71 minutes. */
+#define portRUN_TIME_COUNTER_PERIOD_NS	( ( sizeof( configRUN_TIME_COUNTER_TYPE ) >= 8 ) ? 1ULL : 1000ULL )
+
+/* Make use of clock_gettime(man 2) to gather run-time statistics on the tasks. */
 extern void vPortFindTicksPerSecond( void );
-#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vPortFindTicksPerSecond()		/* Nothing to do because the timer is already present. */
-extern unsigned long ulPortGetTimerValue( void );
-#define portGET_RUN_TIME_COUNTER_VALUE()			ulPortGetTimerValue()			/* Query the System time stats for this process. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vPortFindTicksPerSecond()		/* Start the counter from zero. */
+extern unsigned long long ullPortGetTimerValue( void );
+#define portGET_RUN_TIME_COUNTER_VALUE()			ullPortGetTimerValue()			/* Counts of portRUN_TIME_COUNTER_PERIOD_NS on portRUN_TIME_CLOCK. */
 
 #ifdef __cplusplus
 } /* extern C */
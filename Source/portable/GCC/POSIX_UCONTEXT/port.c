@@ -0,0 +1,822 @@
+/*
+	Copyright (C) 2009 William Davy - william.davy@wittenstein.co.uk
+	Contributed to FreeRTOS.org V5.3.0.
+
+	This file is part of the FreeRTOS.org distribution.
+
+	FreeRTOS.org is free software; you can redistribute it and/or modify it
+	under the terms of the GNU General Public License (version 2) as published
+	by the Free Software Foundation and modified by the FreeRTOS exception.
+
+	FreeRTOS.org is distributed in the hope that it will be useful,	but WITHOUT
+	ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+	FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+	more details.
+
+	You should have received a copy of the GNU General Public License along
+	with FreeRTOS.org; if not, write to the Free Software Foundation, Inc., 59
+	Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+
+	A special exception to the GPL is included to allow you to distribute a
+	combined work that includes FreeRTOS.org without being obliged to provide
+	the source code for any proprietary components.  See the licensing section
+	of http://www.FreeRTOS.org for full details.
+
+
+	***************************************************************************
+	*                                                                         *
+	* Get the FreeRTOS eBook!  See http://www.FreeRTOS.org/Documentation      *
+	*                                                                         *
+	* This is a concise, step by step, 'hands on' guide that describes both   *
+	* general multitasking concepts and FreeRTOS specifics. It presents and   *
+	* explains numerous examples that are written using the FreeRTOS API.     *
+	* Full source code for all the examples is provided in an accompanying    *
+	* .zip file.                                                              *
+	*                                                                         *
+	***************************************************************************
+
+	1 tab == 4 spaces!
+
+	Please ensure to read the configuration and relevant port sections of the
+	online documentation.
+
+	http://www.FreeRTOS.org - Documentation, latest information, license and
+	contact details.
+
+	http://www.SafeRTOS.com - A version that is certified for use in safety
+	critical systems.
+
+	http://www.OpenRTOS.com - Commercial support, development, porting,
+	licensing and training services.
+*/
+
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the single threaded
+ * Posix port.
+ *
+ * All tasks run on the one host thread as user-space contexts.  Each task runs
+ * on the stack that tasks.c allocated for it; the context of the task is kept
+ * at the top of that stack and pxTopOfStack in the TCB points at it, just as it
+ * points at the saved registers on hardware.  The first switch to a task enters
+ * it with setcontext(), every later switch is a _setjmp()/_longjmp() pair, so a
+ * context switch makes no system call at all.
+ *
+ * A helper thread is the tick source.  It sleeps to absolute deadlines on
+ * portTICK_CLOCK, counts every period that has elapsed, including any the host
+ * slept through, and sends SIG_TICK to the thread running the tasks.  That
+ * signal is the tick interrupt.  It is handled on the stack of the running task,
+ * processes all the counted ticks, and switches context from inside the handler
+ * when a tick makes another task ready.  A tick that interrupts the C library is held
+ * until the task is back in simulator code, because the library's locks are not
+ * re-entrant from a second task running on the same thread.  With tickless idle
+ * the idle task tells the tick thread the tick it next needs; the tick thread
+ * sleeps straight to it while the simulator thread waits on a futex word, so an
+ * idle simulator does not wake up every tick.
+ *
+ * Simulated interrupts are raised into a bounded lock-free queue that any
+ * number of host threads may write and only the simulator thread reads.  The
+ * raiser whose interrupt makes the queue non-empty sends SIG_TICK, and the
+ * interrupts are dispatched along with the tick.
+ *----------------------------------------------------------*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* _FORTIFY_SOURCE turns _longjmp() into a checked jump that rejects a jump to
+another stack. */
+#undef _FORTIFY_SOURCE
+
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <ucontext.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+/*-----------------------------------------------------------*/
+
+/* Length of a tick in nanoseconds, exact enough for tick rates above 1 kHz. */
+#define portTICK_PERIOD_NS			( 1000000000ULL / ( unsigned long long )configTICK_RATE_HZ )
+
+/* Simulated interrupts that can wait at once, a power of two. */
+#ifndef portINTERRUPT_QUEUE_LENGTH
+#define portINTERRUPT_QUEUE_LENGTH	( 256 )
+#endif
+#define portINTERRUPT_QUEUE_MASK	( ( unsigned long )portINTERRUPT_QUEUE_LENGTH - 1UL )
+/*-----------------------------------------------------------*/
+
+/* Each task maintains its own interrupt status in the critical nesting variable. */
+typedef struct TASK_CONTEXT
+{
+	jmp_buf xJumpBuffer;						/* Registers of the task while it is switched out. */
+	ucontext_t xStartContext;					/* Entry context, used once to start the task. */
+	pdTASK_CODE pxCode;
+	void *pvParams;
+	unsigned portBASE_TYPE uxCriticalNesting;
+	portBASE_TYPE xStarted;
+} xTaskContext;
+
+/* A slot of the simulated interrupt queue.  The sequence is the lap of the
+position the slot is free for, plus 1 once an interrupt is in it. */
+typedef struct RAISED_INTERRUPT
+{
+	volatile unsigned long ulSequence;
+	unsigned portBASE_TYPE uxInterruptNumber;
+	void *pvParameter;
+} xRaisedInterrupt;
+
+typedef struct INTERRUPT_HANDLER
+{
+	SimulatedInterruptHandler_t pxHandler;
+	unsigned portBASE_TYPE uxPriority;
+} xInterruptHandler;
+
+/* The TCB is opaque here; its first member is the pxTopOfStack value returned
+by pxPortInitialiseStack(), which is the task's context. */
+typedef void tskTCB;
+extern volatile tskTCB * volatile pxCurrentTCB;
+
+/* Bounds of the simulator's own code, provided by the linker. */
+extern char __executable_start;
+extern char etext;
+/*-----------------------------------------------------------*/
+
+static jmp_buf xSchedulerExit;
+static pthread_t hTickThread;
+static pid_t xSimulatorThreadId = 0;
+static volatile portBASE_TYPE xTickThreadStop = pdFALSE;
+static volatile portBASE_TYPE xInterruptsEnabled = pdTRUE;
+static volatile portBASE_TYPE xPendYield = pdFALSE;
+static volatile unsigned portBASE_TYPE uxPendedTicks = 0;
+static volatile unsigned portBASE_TYPE uxCriticalNesting;
+
+/* Ticks counted by the tick thread, and the tick before which it stays quiet
+while the idle task sleeps, or 0. */
+static volatile unsigned long long ullTicksIssued = 0;
+static volatile unsigned long long ullSleepUntilTick = 0;
+static volatile int iIdleWake = 0;
+static volatile int iTickThreadWake = 0;
+
+static xInterruptHandler xInterruptHandlers[ portMAX_INTERRUPTS ];
+static xRaisedInterrupt xInterruptQueue[ portINTERRUPT_QUEUE_LENGTH ];
+static xRaisedInterrupt xInterruptsToDispatch[ portINTERRUPT_QUEUE_LENGTH ];
+static volatile unsigned long ulInterruptQueueHead = 0;
+static volatile unsigned long ulInterruptQueueTail = 0;
+
+/* portRUN_TIME_CLOCK in nanoseconds when the scheduler started. */
+static unsigned long long ullRunTimeStart = 0;
+
+#ifdef portREADY_PRIORITY_GROUPS
+/* Second level of the ready priority bitmap, see portmacro.h. */
+UBaseType_t uxPortReadyPriorityGroups[ portREADY_PRIORITY_GROUPS ] = { 0 };
+#endif
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the thread that generates the tick interrupts.
+ */
+static void prvSetupTimerInterrupt( void );
+static void prvStopTimerInterrupt( void );
+static void *prvTickThread( void *pvParams );
+static void prvTaskEntry( void );
+static void prvProcessTicks( void );
+static portBASE_TYPE prvInterruptQueued( void );
+static void prvDispatchInterrupts( void );
+static void prvSwitchContext( xTaskContext *pxContextToResume, xTaskContext *pxContextToSuspend );
+static void prvResumeContext( xTaskContext *pxContext );
+static portBASE_TYPE prvInterruptedSimulatorCode( void *pvContext );
+/*-----------------------------------------------------------*/
+
+/*
+ * Exception handlers.
+ */
+void vPortYield( void );
+void vPortSystemTickHandler( int sig, siginfo_t *pxInfo, void *pvContext );
+
+/*
+ * Start first task is a separate function so it can be tested in isolation.
+ */
+void vPortStartFirstTask( void );
+/*-----------------------------------------------------------*/
+
+#define prvCurrentContext()		( *( xTaskContext ** )pxCurrentTCB )
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+portSTACK_TYPE *pxPortInitialiseStack( portSTACK_TYPE *pxTopOfStack, pdTASK_CODE pxCode, void *pvParameters )
+{
+xTaskContext * volatile pxContext;
+uintptr_t uxTop = ( uintptr_t )pxTopOfStack;
+
+	/* Reserve the context at the top of the stack, aligned for any type. */
+	uxTop = ( uxTop - sizeof( xTaskContext ) ) & ~( ( uintptr_t )15 );
+	pxContext = ( xTaskContext * )uxTop;
+
+	pxContext->pxCode = pxCode;
+	pxContext->pvParams = pvParameters;
+	pxContext->uxCriticalNesting = 0;
+	pxContext->xStarted = pdFALSE;
+
+	/* The task runs on the rest of its stack.  makecontext() places the first
+	frame at ss_sp + ss_size; the real depth is only known to tasks.c, so the
+	guaranteed minimum is reported. */
+	if ( 0 != getcontext( &pxContext->xStartContext ) )
+	{
+		return NULL;
+	}
+	pxContext->xStartContext.uc_stack.ss_sp = ( void * )( uxTop - ( configMINIMAL_STACK_SIZE * sizeof( portSTACK_TYPE ) ) );
+	pxContext->xStartContext.uc_stack.ss_size = configMINIMAL_STACK_SIZE * sizeof( portSTACK_TYPE );
+	pxContext->xStartContext.uc_link = NULL;
+	makecontext( &pxContext->xStartContext, prvTaskEntry, 0 );
+
+	return ( portSTACK_TYPE * )pxContext;
+}
+/*-----------------------------------------------------------*/
+
+void vPortStartFirstTask( void )
+{
+	/* Initialise the critical nesting count ready for the first task. */
+	uxCriticalNesting = 0;
+
+	/* Start the first task. */
+	prvResumeContext( prvCurrentContext() );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+portBASE_TYPE xPortStartScheduler( void )
+{
+struct sigaction sigtick;
+
+	/* The tick may switch context from inside the handler, so it must not
+	change the signal mask: the task switched to would inherit it. */
+	sigtick.sa_flags = SA_SIGINFO | SA_NODEFER | SA_RESTART;
+	sigtick.sa_sigaction = vPortSystemTickHandler;
+	sigemptyset( &sigtick.sa_mask );
+
+	if ( 0 != sigaction( SIG_TICK, &sigtick, NULL ) )
+	{
+		printf( "Problem installing SIG_TICK\n" );
+	}
+	printf( "Running as PID: %d\n", getpid() );
+
+	/* vPortEndScheduler() jumps back here. */
+	if ( 0 == _setjmp( xSchedulerExit ) )
+	{
+		/* Start the timer that generates the tick ISR.  Interrupts are disabled
+		here already. */
+		prvSetupTimerInterrupt();
+
+		/* Start the first task. Will not return unless the scheduler ends. */
+		vPortStartFirstTask();
+	}
+
+	printf( "Cleaning Up, Exiting.\n" );
+
+	/* Should not get here! */
+	return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	prvStopTimerInterrupt();
+
+	/* Leave the task stacks behind and continue in xPortStartScheduler(). */
+	_longjmp( xSchedulerExit, 1 );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+	/* The tick switches context itself on the way out; any other caller is
+	serviced when the critical section ends. */
+	xPendYield = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	vPortDisableInterrupts();
+	uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	/* Check for unmatched exits. */
+	if ( uxCriticalNesting > 0 )
+	{
+		uxCriticalNesting--;
+	}
+
+	/* If we have reached 0 then re-enable the interrupts. */
+	if( uxCriticalNesting == 0 )
+	{
+		if ( pdTRUE == xPendYield )
+		{
+			xPendYield = pdFALSE;
+			vPortYield();
+		}
+		vPortEnableInterrupts();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+xTaskContext *pxContextToSuspend;
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+
+	pxContextToSuspend = prvCurrentContext();
+	vTaskSwitchContext();
+	prvSwitchContext( prvCurrentContext(), pxContextToSuspend );
+
+	/* Running again, possibly much later; restore this task's interrupt state. */
+	vPortClearInterruptMask( xInterruptsWereEnabled );
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	xInterruptsEnabled = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	xInterruptsEnabled = pdTRUE;
+
+	/* Service ticks and interrupts that arrived while interrupts were masked.
+	The exchange keeps the tick handler out while they are processed. */
+	while ( ( ( 0 != uxPendedTicks ) || ( pdTRUE == prvInterruptQueued() ) ) && ( pdTRUE == __atomic_exchange_n( &xInterruptsEnabled, pdFALSE, __ATOMIC_SEQ_CST ) ) )
+	{
+		prvProcessTicks();
+		xInterruptsEnabled = pdTRUE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xPortSetInterruptMask( void )
+{
+	return __atomic_exchange_n( &xInterruptsEnabled, pdFALSE, __ATOMIC_SEQ_CST );
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( portBASE_TYPE xMask )
+{
+	if ( pdTRUE == xMask )
+	{
+		vPortEnableInterrupts();
+	}
+	else
+	{
+		xInterruptsEnabled = xMask;
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the systick timer to generate the tick interrupts at the required
+ * frequency.
+ */
+void prvSetupTimerInterrupt( void )
+{
+sigset_t xAllSignals;
+sigset_t xSignalsBefore;
+
+	xSimulatorThreadId = ( pid_t )syscall( SYS_gettid );
+	xTickThreadStop = pdFALSE;
+
+	/* The tick thread inherits a mask that blocks everything, so process
+	directed signals are never run on it. */
+	sigfillset( &xAllSignals );
+	(void)pthread_sigmask( SIG_SETMASK, &xAllSignals, &xSignalsBefore );
+	if ( 0 != pthread_create( &hTickThread, NULL, prvTickThread, NULL ) )
+	{
+		printf( "Tick thread problem.\n" );
+	}
+	(void)pthread_sigmask( SIG_SETMASK, &xSignalsBefore, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void prvStopTimerInterrupt( void )
+{
+	xTickThreadStop = pdTRUE;
+	(void)pthread_join( hTickThread, NULL );
+	(void)signal( SIG_TICK, SIG_IGN );
+}
+/*-----------------------------------------------------------*/
+
+void *prvTickThread( void *pvParams )
+{
+struct timespec xNow;
+struct timespec xDeadline;
+unsigned long long ullStart;
+unsigned long long ullNext;
+unsigned long long ullTicksDue;
+portBASE_TYPE xSleeping;
+
+	(void)pvParams;
+	(void)clock_gettime( portTICK_CLOCK, &xNow );
+	ullStart = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
+
+	while ( pdTRUE != xTickThreadStop )
+	{
+		/* While the idle task sleeps, skip the ticks it does not need. */
+		__atomic_store_n( &iTickThreadWake, 0, __ATOMIC_SEQ_CST );
+		ullNext = __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST );
+		xSleeping = ( ullNext > ullTicksIssued + 1 ) ? pdTRUE : pdFALSE;
+		if ( pdFALSE == xSleeping )
+		{
+			ullNext = ullTicksIssued + 1;
+		}
+
+		/* Deadlines are absolute, so time spent late does not accumulate. */
+		ullNext = ullStart + ullNext * portTICK_PERIOD_NS;
+		xDeadline.tv_sec = ( time_t )( ullNext / 1000000000ULL );
+		xDeadline.tv_nsec = ( long )( ullNext % 1000000000ULL );
+		if ( pdTRUE == xSleeping )
+		{
+			/* An interrupt can end the idle sleep early, and the idle task then
+			wakes us to carry on ticking.  The futex measures the deadline on
+			CLOCK_MONOTONIC. */
+			(void)syscall( SYS_futex, &iTickThreadWake, FUTEX_WAIT_BITSET_PRIVATE, 0, &xDeadline, NULL, FUTEX_BITSET_MATCH_ANY );
+		}
+		else
+		{
+			(void)clock_nanosleep( portTICK_CLOCK, TIMER_ABSTIME, &xDeadline, NULL );
+		}
+
+		/* Count every period that has passed, including any the host slept
+		through; the handler processes them all. */
+		(void)clock_gettime( portTICK_CLOCK, &xNow );
+		ullTicksDue = ( ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec - ullStart ) / portTICK_PERIOD_NS;
+		if ( ( ullTicksDue > ullTicksIssued ) && ( ullTicksDue >= __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) ) && ( pdTRUE != xTickThreadStop ) )
+		{
+			__atomic_add_fetch( &uxPendedTicks, ( unsigned portBASE_TYPE )( ullTicksDue - ullTicksIssued ), __ATOMIC_SEQ_CST );
+			__atomic_store_n( &ullTicksIssued, ullTicksDue, __ATOMIC_SEQ_CST );
+			if ( 0 != __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) )
+			{
+				__atomic_store_n( &iIdleWake, 1, __ATOMIC_SEQ_CST );
+				(void)syscall( SYS_futex, &iIdleWake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+			}
+			(void)syscall( SYS_tgkill, getpid(), xSimulatorThreadId, SIG_TICK );
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSystemTickHandler( int sig, siginfo_t *pxInfo, void *pvContext )
+{
+int iSavedErrno = errno;
+
+	(void)(sig);
+	(void)(pxInfo);
+
+	/* Only take the tick now if interrupts are enabled and the task was not
+	stopped inside the C library; otherwise it is serviced later by the next
+	tick, the end of the critical section or the next yield. */
+	if ( ( pdTRUE == prvInterruptedSimulatorCode( pvContext ) ) && ( pdTRUE == __atomic_exchange_n( &xInterruptsEnabled, pdFALSE, __ATOMIC_SEQ_CST ) ) )
+	{
+		prvProcessTicks();
+		vPortEnableInterrupts();
+	}
+
+	errno = iSavedErrno;
+}
+/*-----------------------------------------------------------*/
+
+void prvProcessTicks( void )
+{
+xTaskContext *pxContextToSuspend = prvCurrentContext();
+unsigned portBASE_TYPE uxTicks;
+
+	/* Catch up on every tick counted since the last service in one pass. */
+	while ( 0 != ( uxTicks = __atomic_exchange_n( &uxPendedTicks, 0, __ATOMIC_SEQ_CST ) ) )
+	{
+		(void)xTaskCatchUpTicks( ( TickType_t )uxTicks );
+	}
+
+	/* Then the simulated interrupts, which are dispatched on the same pass. */
+	prvDispatchInterrupts();
+
+	/* Select Next Task. */
+#if ( configUSE_PREEMPTION == 1 )
+	vTaskSwitchContext();
+	xPendYield = pdFALSE;
+#endif
+
+	prvSwitchContext( prvCurrentContext(), pxContextToSuspend );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE prvInterruptQueued( void )
+{
+unsigned long ulTail = __atomic_load_n( &ulInterruptQueueTail, __ATOMIC_SEQ_CST );
+xRaisedInterrupt *pxSlot = &xInterruptQueue[ ulTail & portINTERRUPT_QUEUE_MASK ];
+
+	/* An interrupt is waiting once the slot at the tail has been filled. */
+	return ( __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_SEQ_CST ) == ( ulTail & ~portINTERRUPT_QUEUE_MASK ) + 1UL ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void prvDispatchInterrupts( void )
+{
+/* Called with interrupts masked on the simulator thread, the only reader of
+the queue. */
+unsigned long ulTail = ulInterruptQueueTail;
+unsigned long ulCount = 0;
+unsigned long ulIndex;
+xRaisedInterrupt *pxSlot;
+xRaisedInterrupt xRaised;
+SimulatedInterruptHandler_t pxHandler;
+
+	/* Take what has been raised so far, sorted by priority; interrupts raised
+	by the handlers wait for the next pass. */
+	while ( ( ulCount < portINTERRUPT_QUEUE_LENGTH ) && ( pdTRUE == prvInterruptQueued() ) )
+	{
+		pxSlot = &xInterruptQueue[ ulTail & portINTERRUPT_QUEUE_MASK ];
+		xRaised.uxInterruptNumber = pxSlot->uxInterruptNumber;
+		xRaised.pvParameter = pxSlot->pvParameter;
+
+		/* Free the slot for the next lap. */
+		__atomic_store_n( &pxSlot->ulSequence, ( ulTail & ~portINTERRUPT_QUEUE_MASK ) + portINTERRUPT_QUEUE_LENGTH, __ATOMIC_SEQ_CST );
+		ulTail++;
+		__atomic_store_n( &ulInterruptQueueTail, ulTail, __ATOMIC_SEQ_CST );
+
+		/* Insertion keeps interrupts of equal priority in the order raised. */
+		for ( ulIndex = ulCount; ( ulIndex > 0 ) && ( xInterruptHandlers[ xInterruptsToDispatch[ ulIndex - 1 ].uxInterruptNumber ].uxPriority < xInterruptHandlers[ xRaised.uxInterruptNumber ].uxPriority ); ulIndex-- )
+		{
+			xInterruptsToDispatch[ ulIndex ] = xInterruptsToDispatch[ ulIndex - 1 ];
+		}
+		xInterruptsToDispatch[ ulIndex ] = xRaised;
+		ulCount++;
+	}
+
+	for ( ulIndex = 0; ulIndex < ulCount; ulIndex++ )
+	{
+		pxHandler = xInterruptHandlers[ xInterruptsToDispatch[ ulIndex ].uxInterruptNumber ].pxHandler;
+		if ( ( NULL != pxHandler ) && ( pdFALSE != pxHandler( xInterruptsToDispatch[ ulIndex ].pvParameter ) ) )
+		{
+			vPortYieldFromISR();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetInterruptHandler( UBaseType_t uxInterruptNumber, UBaseType_t uxPriority, SimulatedInterruptHandler_t pxHandler )
+{
+	if ( uxInterruptNumber < portMAX_INTERRUPTS )
+	{
+		vPortEnterCritical();
+		xInterruptHandlers[ uxInterruptNumber ].uxPriority = uxPriority;
+		xInterruptHandlers[ uxInterruptNumber ].pxHandler = pxHandler;
+		vPortExitCritical();
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortGenerateSimulatedInterrupt( UBaseType_t uxInterruptNumber, void *pvParameter )
+{
+unsigned long ulPosition;
+unsigned long ulLap;
+long lDifference;
+xRaisedInterrupt *pxSlot;
+
+	if ( uxInterruptNumber >= portMAX_INTERRUPTS )
+	{
+		return pdFAIL;
+	}
+
+	/* Claim the slot at the head.  Producers race only for the head index. */
+	for ( ;; )
+	{
+		ulPosition = __atomic_load_n( &ulInterruptQueueHead, __ATOMIC_RELAXED );
+		ulLap = ulPosition & ~portINTERRUPT_QUEUE_MASK;
+		pxSlot = &xInterruptQueue[ ulPosition & portINTERRUPT_QUEUE_MASK ];
+		lDifference = ( long )( __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_ACQUIRE ) - ulLap );
+
+		if ( 0 == lDifference )
+		{
+			if ( __atomic_compare_exchange_n( &ulInterruptQueueHead, &ulPosition, ulPosition + 1UL, pdFALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+			{
+				break;
+			}
+		}
+		else if ( lDifference < 0 )
+		{
+			/* The slot still holds an interrupt from the last lap. */
+			return pdFAIL;
+		}
+	}
+
+	pxSlot->uxInterruptNumber = uxInterruptNumber;
+	pxSlot->pvParameter = pvParameter;
+	__atomic_store_n( &pxSlot->ulSequence, ulLap + 1UL, __ATOMIC_SEQ_CST );
+
+	/* Only the interrupt that made the queue non-empty needs to interrupt the
+	simulator thread; the others are taken in the same pass. */
+	if ( ulPosition == __atomic_load_n( &ulInterruptQueueTail, __ATOMIC_SEQ_CST ) )
+	{
+		if ( 0 != __atomic_load_n( &ullSleepUntilTick, __ATOMIC_SEQ_CST ) )
+		{
+			__atomic_store_n( &iIdleWake, 1, __ATOMIC_SEQ_CST );
+			(void)syscall( SYS_futex, &iIdleWake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+		}
+		if ( 0 != xSimulatorThreadId )
+		{
+			(void)syscall( SYS_tgkill, getpid(), xSimulatorThreadId, SIG_TICK );
+		}
+	}
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE prvInterruptedSimulatorCode( void *pvContext )
+{
+ucontext_t *pxInterrupted = ( ucontext_t * )pvContext;
+uintptr_t uxPC;
+
+#if defined( __x86_64__ )
+	uxPC = ( uintptr_t )pxInterrupted->uc_mcontext.gregs[ REG_RIP ];
+#elif defined( __i386__ )
+	uxPC = ( uintptr_t )pxInterrupted->uc_mcontext.gregs[ REG_EIP ];
+#elif defined( __aarch64__ )
+	uxPC = ( uintptr_t )pxInterrupted->uc_mcontext.pc;
+#else
+	/* Unknown machine context, always take the tick. */
+	(void)pxInterrupted;
+	return pdTRUE;
+#endif
+
+	return ( ( uxPC >= ( uintptr_t )&__executable_start ) && ( uxPC < ( uintptr_t )&etext ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void prvTaskEntry( void )
+{
+xTaskContext *pxContext = prvCurrentContext();
+
+	/* First time this task runs. */
+	uxCriticalNesting = 0;
+	vPortEnableInterrupts();
+
+	pxContext->pxCode( pxContext->pvParams );
+
+	/* Tasks must not return; clean up as the thread port does when its thread ends. */
+	printf( "Task %s returned from its function.\n", pcTaskGetName( NULL ) );
+#if ( INCLUDE_vTaskDelete == 1 )
+	vTaskDelete( NULL );
+#endif
+	for ( ;; )
+	{
+		vPortYield();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void prvSwitchContext( xTaskContext *pxContextToResume, xTaskContext *pxContextToSuspend )
+{
+	if ( pxContextToSuspend != pxContextToResume )
+	{
+		/* Remember the critical nesting of the task being switched out. */
+		pxContextToSuspend->uxCriticalNesting = uxCriticalNesting;
+
+		if ( 0 == _setjmp( pxContextToSuspend->xJumpBuffer ) )
+		{
+			prvResumeContext( pxContextToResume );
+		}
+
+		uxCriticalNesting = pxContextToSuspend->uxCriticalNesting;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void prvResumeContext( xTaskContext *pxContext )
+{
+	if ( pdTRUE == pxContext->xStarted )
+	{
+		_longjmp( pxContext->xJumpBuffer, 1 );
+	}
+	else
+	{
+		/* setcontext() also restores the signal mask, which is only affordable
+		the first time. */
+		pxContext->xStarted = pdTRUE;
+		(void)setcontext( &pxContext->xStartContext );
+	}
+}
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_VIRTUAL_TIME == 1 )
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+
+	/* The idle task calls this with the scheduler suspended.  Unless a task
+	became ready meanwhile, or no task waits with a timeout, jump to the tick
+	before the earliest unblock time and process that last tick here.  The
+	kernel holds it while the scheduler is suspended and replays it, which
+	unblocks the task, in xTaskResumeAll(). */
+	if ( eStandardSleep == eTaskConfirmSleepModeStatus() )
+	{
+		vTaskStepTick( xExpectedIdleTime - 1 );
+		(void)xTaskIncrementTick();
+	}
+
+	vPortClearInterruptMask( xInterruptsWereEnabled );
+}
+/*-----------------------------------------------------------*/
+
+#elif ( configUSE_TICKLESS_IDLE != 0 )
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+portBASE_TYPE xInterruptsWereEnabled = xPortSetInterruptMask();
+unsigned portBASE_TYPE uxSleptTicks;
+
+	/* The idle task calls this with the scheduler suspended.  Ticks counted
+	but not yet processed mean the kernel is behind the tick thread, so only
+	sleep when there are none. */
+	if ( ( eAbortSleep != eTaskConfirmSleepModeStatus() ) && ( 0 == uxPendedTicks ) && ( pdFALSE == prvInterruptQueued() ) )
+	{
+		/* Have the tick thread stay quiet until the tick that unblocks the
+		next task.  The tick signal is held off by the mask, and only breaks
+		the wait early, so wait for the tick thread to post the ticks or for
+		an interrupt to be raised. */
+		__atomic_store_n( &iIdleWake, 0, __ATOMIC_SEQ_CST );
+		__atomic_store_n( &ullSleepUntilTick, __atomic_load_n( &ullTicksIssued, __ATOMIC_SEQ_CST ) + xExpectedIdleTime, __ATOMIC_SEQ_CST );
+		while ( ( 0 == __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST ) ) && ( pdFALSE == prvInterruptQueued() ) )
+		{
+			(void)syscall( SYS_futex, &iIdleWake, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0 );
+		}
+		__atomic_store_n( &ullSleepUntilTick, 0ULL, __ATOMIC_SEQ_CST );
+
+		/* After an early wake the tick thread counts the ticks slept through
+		and carries on ticking. */
+		__atomic_store_n( &iTickThreadWake, 1, __ATOMIC_SEQ_CST );
+		(void)syscall( SYS_futex, &iTickThreadWake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+
+		/* Step over the ticks slept through up to the one before the unblock
+		time.  The rest, including the one that unblocks the task, are
+		processed as normal ticks once interrupts are enabled again. */
+		uxSleptTicks = __atomic_load_n( &uxPendedTicks, __ATOMIC_SEQ_CST );
+		if ( uxSleptTicks > ( unsigned portBASE_TYPE )( xExpectedIdleTime - 1 ) )
+		{
+			uxSleptTicks = ( unsigned portBASE_TYPE )( xExpectedIdleTime - 1 );
+		}
+		__atomic_sub_fetch( &uxPendedTicks, uxSleptTicks, __ATOMIC_SEQ_CST );
+		vTaskStepTick( ( TickType_t )uxSleptTicks );
+	}
+
+	vPortClearInterruptMask( xInterruptsWereEnabled );
+}
+/*-----------------------------------------------------------*/
+
+#endif /* configUSE_VIRTUAL_TIME */
+
+void vPortFindTicksPerSecond( void )
+{
+struct timespec xNow;
+
+	/* Count from the start of the scheduler so a 32 bit counter lasts as long
+	as it can. */
+	(void)clock_gettime( portRUN_TIME_CLOCK, &xNow );
+	ullRunTimeStart = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
+	printf( "Timer Resolution for Run TimeStats is %llu ticks per second.\n", 1000000000ULL / portRUN_TIME_COUNTER_PERIOD_NS );
+}
+/*-----------------------------------------------------------*/
+
+unsigned long long ullPortGetTimerValue( void )
+{
+struct timespec xNow;
+unsigned long long ullNow;
+
+	/* The kernel reads the counter on every context switch, so it needs a
+	resolution well below the tick period or short runs go uncounted. */
+	(void)clock_gettime( portRUN_TIME_CLOCK, &xNow );
+	ullNow = ( unsigned long long )xNow.tv_sec * 1000000000ULL + ( unsigned long long )xNow.tv_nsec;
+	return ( ullNow - ullRunTimeStart ) / portRUN_TIME_COUNTER_PERIOD_NS;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,217 @@
+/*
+    POSIX Simulator, single host thread with user-space task contexts
+		Tested with FreeRTOS V10.0.1
+    1 tab == 4 spaces!
+*/
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/******************************************************************************
+	Defines
+******************************************************************************/
+/* Type definitions. */
+#define portCHAR		char
+#define portFLOAT		float
+#define portDOUBLE		double
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	size_t
+#define portBASE_TYPE	long
+#define portPOINTER_SIZE_TYPE size_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if( configUSE_16_BIT_TICKS == 1 )
+    typedef uint16_t TickType_t;
+    #define portMAX_DELAY ( TickType_t ) 0xffff
+#else
+    typedef uint32_t TickType_t;
+    #define portMAX_DELAY ( TickType_t ) 0xffffffffUL
+
+	/* 32/64-bit tick type on a 32/64-bit architecture, so reads of the tick
+	count do not need to be guarded with a critical section. */
+	#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+/* Hardware specifics. */
+#define portSTACK_GROWTH			( -1 )
+#define portTICK_PERIOD_MS			( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portINLINE __inline__
+
+#if defined( __x86_64__)
+	#define portBYTE_ALIGNMENT		8
+#else
+	#define portBYTE_ALIGNMENT		4
+#endif
+
+/*-----------------------------------------------------------*/
+
+/* Scheduler utilities. */
+extern void vPortYieldFromISR( void );
+extern void vPortYield( void );
+#define portYIELD()					vPortYield()
+#define portEND_SWITCHING_ISR( xSwitchRequired ) if( xSwitchRequired ) vPortYieldFromISR()
+#define portYIELD_FROM_ISR( x ) portEND_SWITCHING_ISR( x )
+
+/*-----------------------------------------------------------*/
+
+/* Architecture specific optimisations. */
+#if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 1 )
+
+	/* Ready priorities are kept as a bitmap in uxTopReadyPriority, and the
+	highest is found by counting leading zeros.  A word is an unsigned long,
+	32 bits in the -m32 build the Makefile produces and 64 bits in a 64 bit
+	build. */
+	#define portREADY_BITMAP_BITS		( __SIZEOF_LONG__ * 8 )
+	#define portTOP_BIT( uxBitmap )		( ( UBaseType_t ) ( portREADY_BITMAP_BITS - 1 ) - ( UBaseType_t ) __builtin_clzl( uxBitmap ) )
+
+	#if ( configMAX_PRIORITIES <= portREADY_BITMAP_BITS )
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities )		( uxReadyPriorities ) |= ( 1UL << ( uxPriority ) )
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities )		( uxReadyPriorities ) &= ~( 1UL << ( uxPriority ) )
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities )	uxTopPriority = portTOP_BIT( uxReadyPriorities )
+
+	#else
+
+		/* Too many priorities for one word, so use two levels: bit n of
+		uxTopReadyPriority is set while word n of uxPortReadyPriorityGroups,
+		which holds priorities n * portREADY_BITMAP_BITS upwards, is not zero. */
+		#define portREADY_PRIORITY_GROUPS	( ( configMAX_PRIORITIES + portREADY_BITMAP_BITS - 1 ) / portREADY_BITMAP_BITS )
+
+		#if ( portREADY_PRIORITY_GROUPS > portREADY_BITMAP_BITS )
+			#error configMAX_PRIORITIES is too large for port optimised task selection
+		#endif
+
+		extern UBaseType_t uxPortReadyPriorityGroups[ portREADY_PRIORITY_GROUPS ];
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities )																\
+		{																																\
+			uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] |= ( 1UL << ( ( uxPriority ) % portREADY_BITMAP_BITS ) );	\
+			( uxReadyPriorities ) |= ( 1UL << ( ( uxPriority ) / portREADY_BITMAP_BITS ) );											\
+		}
+
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities )																\
+		{																																\
+			uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] &= ~( 1UL << ( ( uxPriority ) % portREADY_BITMAP_BITS ) );	\
+			if( uxPortReadyPriorityGroups[ ( uxPriority ) / portREADY_BITMAP_BITS ] == 0UL )											\
+			{																															\
+				( uxReadyPriorities ) &= ~( 1UL << ( ( uxPriority ) / portREADY_BITMAP_BITS ) );										\
+			}																															\
+		}
+
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities )															\
+		{																																\
+		UBaseType_t uxTopGroup = portTOP_BIT( uxReadyPriorities );																		\
+			uxTopPriority = ( uxTopGroup * portREADY_BITMAP_BITS ) + portTOP_BIT( uxPortReadyPriorityGroups[ uxTopGroup ] );			\
+		}
+
+	#endif
+
+#endif /* configUSE_PORT_OPTIMISED_TASK_SELECTION */
+
+/* The delayed task wheel finds its first occupied slot by counting trailing
+zeros in a word of its occupancy bitmap. */
+#define portLOWEST_BIT( uxBitmap )		( ( UBaseType_t ) __builtin_ctzl( uxBitmap ) )
+
+/*-----------------------------------------------------------*/
+
+/* Critical section management. */
+extern BaseType_t xPortSetInterruptMask( void );
+extern void vPortClearInterruptMask( portBASE_TYPE xMask );
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()		xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	vPortClearInterruptMask(x)
+
+extern void vPortDisableInterrupts( void );
+extern void vPortEnableInterrupts( void );
+#define portSET_INTERRUPT_MASK()	( vPortDisableInterrupts() )
+#define portCLEAR_INTERRUPT_MASK()	( vPortEnableInterrupts() )
+
+#define portDISABLE_INTERRUPTS()	portSET_INTERRUPT_MASK()
+#define portENABLE_INTERRUPTS()		portCLEAR_INTERRUPT_MASK()
+
+extern void vPortEnterCritical( void );
+extern void vPortExitCritical( void );
+#define portENTER_CRITICAL()		vPortEnterCritical()
+#define portEXIT_CRITICAL()			vPortExitCritical()
+
+/* All tasks share one host thread, so there is only ever one core. */
+#if ( configNUMBER_OF_CORES > 1 )
+	#error The POSIX_UCONTEXT port runs a single core, use the POSIX port for configNUMBER_OF_CORES greater than 1
+#endif
+
+/*-----------------------------------------------------------*/
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void * pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void * pvParameters )
+
+#define portNOP()
+
+#define portOUTPUT_BYTE( a, b )
+
+/* Tickless idle: once every task is blocked the idle task stops the tick and
+sleeps until the next unblock time.  With virtual time it moves the tick count
+straight to that time instead of sleeping at all. */
+#if ( configUSE_TICKLESS_IDLE != 0 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )	vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#elif ( configUSE_VIRTUAL_TIME == 1 )
+	#error configUSE_TICKLESS_IDLE must be set to 1 when configUSE_VIRTUAL_TIME is 1
+#endif
+
+/* Simulated interrupts.  Host threads, or tasks, raise interrupt
+uxInterruptNumber with xPortGenerateSimulatedInterrupt(), which fails only when
+portINTERRUPT_QUEUE_LENGTH interrupts are already waiting.  Handlers run on the stack of the running task
+with interrupts masked, like an ISR, so they may use the FromISR API; they
+return pdTRUE when they woke a task that should run.  Waiting interrupts are
+taken highest priority first, at the next tick or yield point, and are held
+while interrupts are masked. */
+#define portMAX_INTERRUPTS			( 32 )
+typedef BaseType_t ( *SimulatedInterruptHandler_t )( void *pvParameter );
+extern void vPortSetInterruptHandler( UBaseType_t uxInterruptNumber, UBaseType_t uxPriority, SimulatedInterruptHandler_t pxHandler );
+extern BaseType_t xPortGenerateSimulatedInterrupt( UBaseType_t uxInterruptNumber, void *pvParameter );
+
+/* The application chains its own clean-up of a deleted task's TCB in with
+configCLEAN_UP_TCB(), as on the POSIX port. */
+#ifdef configCLEAN_UP_TCB
+	#define portCLEAN_UP_TCB( pxTCB )				configCLEAN_UP_TCB( pxTCB )
+#endif
+
+/* Posix Signal definitions that can be changed or read as appropriate.
+SIG_TICK is sent by the tick thread to the thread running the tasks. */
+#define SIG_TICK					SIGALRM
+
+/* Enable the following hash define to make use of the real-time tick where time progresses at real-time. */
+#define portTICK_CLOCK				CLOCK_MONOTONIC
+/* Enable the following hash define to make use of the process tick where time progresses only when the process is executing.
+#define portTICK_CLOCK				CLOCK_PROCESS_CPUTIME_ID		*/
+
+/* Enable the following hash define to charge tasks for the real time they hold the processor.  */
+#define portRUN_TIME_CLOCK			CLOCK_MONOTONIC
+/* Enable the following hash define to leave out time the host gives to other processes.
+#define portRUN_TIME_CLOCK			CLOCK_PROCESS_CPUTIME_ID		*/
+
+/* Nanoseconds per run time stats count.  A 64 bit configRUN_TIME_COUNTER_TYPE
+counts nanoseconds; a 32 bit one counts microseconds, which wraps after about
+71 minutes. */
+#define portRUN_TIME_COUNTER_PERIOD_NS	( ( sizeof( configRUN_TIME_COUNTER_TYPE ) >= 8 ) ? 1ULL : 1000ULL )
+
+/* Make use of clock_gettime(man 2) to gather run-time statistics on the tasks. */
+extern void vPortFindTicksPerSecond( void );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vPortFindTicksPerSecond()		/* Start the counter from zero. */
+extern unsigned long long ullPortGetTimerValue( void );
+#define portGET_RUN_TIME_COUNTER_VALUE()			ullPortGetTimerValue()			/* Counts of portRUN_TIME_COUNTER_PERIOD_NS on portRUN_TIME_CLOCK. */
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* PORTMACRO_H */
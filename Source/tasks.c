@@ -69,6 +69,21 @@ functions but without including stdio.h here. */
 #define taskWAITING_NOTIFICATION		( ( uint8_t ) 1 )
 #define taskNOTIFICATION_RECEIVED		( ( uint8_t ) 2 )
 
+#if ( configNUMBER_OF_CORES > 1 )
+	/* The xTaskRunState of a task that is not running on any core. */
+	#define taskTASK_NOT_RUNNING			( ( BaseType_t ) -1 )
+#endif
+
+/* Whether the calling task has the scheduler suspended.  With more than one
+core another core may have it suspended, which keeps that core holding the task
+lock.  Entering a critical section waits for the lock, so the count read inside
+one can only be the caller's own. */
+#if ( configNUMBER_OF_CORES == 1 )
+	#define taskSCHEDULER_SUSPENDED_BY_CALLER()	( uxSchedulerSuspended != ( UBaseType_t ) pdFALSE )
+#else
+	#define taskSCHEDULER_SUSPENDED_BY_CALLER()	prvSchedulerSuspendedByCaller()
+#endif
+
 /*
  * The value used to fill the stack of a task when the task is created.  This
  * is used purely for checking the high water mark for tasks.
@@ -129,6 +144,39 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 	#define configIDLE_TASK_NAME "IDLE"
 #endif
 
+/* pdTRUE if tick xA comes before tick xB, allowing for the tick count
+overflowing between them. */
+#define taskTICK_IS_BEFORE( xA, xB )	( ( ( TickType_t ) ( ( xA ) - ( xB ) ) ) > ( portMAX_DELAY >> 1 ) )
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+	/* Within a priority, tasks with a deadline are kept at the front of the
+	ready list, earliest deadline first, and the head is chosen.  Tasks without
+	a deadline share the processor in turn once no task with a deadline is
+	ready. */
+	#define taskGET_OWNER_OF_READY_ENTRY( pxTCB, pxList )												\
+	{																									\
+		if( ( ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxList ) )->xPeriod != ( TickType_t ) 0U )		\
+		{																								\
+			( pxTCB ) = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxList );								\
+		}																								\
+		else																							\
+		{																								\
+			listGET_OWNER_OF_NEXT_ENTRY( pxTCB, pxList );												\
+		}																								\
+	}
+
+	#define taskINSERT_READY_TASK( pxTCB )	prvInsertReadyTaskByDeadline( pxTCB )
+
+#else
+
+	#define taskGET_OWNER_OF_READY_ENTRY( pxTCB, pxList )	listGET_OWNER_OF_NEXT_ENTRY( pxTCB, pxList )
+	#define taskINSERT_READY_TASK( pxTCB )	vListInsertEnd( &( pxReadyTasksLists[ ( pxTCB )->uxPriority ] ), &( ( pxTCB )->xStateListItem ) )
+
+#endif /* configUSE_EDF_SCHEDULING */
+
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 )
 
 	/* If configUSE_PORT_OPTIMISED_TASK_SELECTION is 0 then task selection is
@@ -160,7 +208,7 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 																										\
 		/* listGET_OWNER_OF_NEXT_ENTRY indexes through the list, so the tasks of						\
 		the	same priority get an equal share of the processor time. */									\
-		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );			\
+		taskGET_OWNER_OF_READY_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );			\
 		uxTopReadyPriority = uxTopPriority;																\
 	} /* taskSELECT_HIGHEST_PRIORITY_TASK */
 
@@ -190,7 +238,7 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 		/* Find the highest priority list that contains ready tasks. */								\
 		portGET_HIGHEST_PRIORITY( uxTopPriority, uxTopReadyPriority );								\
 		configASSERT( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ uxTopPriority ] ) ) > 0 );		\
-		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );		\
+		taskGET_OWNER_OF_READY_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );		\
 	} /* taskSELECT_HIGHEST_PRIORITY_TASK() */
 
 	/*-----------------------------------------------------------*/
@@ -210,33 +258,100 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 
 /*-----------------------------------------------------------*/
 
-/* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
-count overflows. */
-#define taskSWITCH_DELAYED_LISTS()																	\
-{																									\
-	List_t *pxTemp;																					\
-																									\
-	/* The delayed tasks list should be empty when the lists are switched. */						\
-	configASSERT( ( listLIST_IS_EMPTY( pxDelayedTaskList ) ) );										\
-																									\
-	pxTemp = pxDelayedTaskList;																		\
-	pxDelayedTaskList = pxOverflowDelayedTaskList;													\
-	pxOverflowDelayedTaskList = pxTemp;																\
-	xNumOfOverflows++;																				\
-	prvResetNextTaskUnblockTime();																	\
-}
+#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+
+	/* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
+	count overflows. */
+	#define taskSWITCH_DELAYED_LISTS()																	\
+	{																									\
+		List_t *pxTemp;																					\
+																										\
+		/* The delayed tasks list should be empty when the lists are switched. */						\
+		configASSERT( ( listLIST_IS_EMPTY( pxDelayedTaskList ) ) );										\
+																										\
+		pxTemp = pxDelayedTaskList;																		\
+		pxDelayedTaskList = pxOverflowDelayedTaskList;													\
+		pxOverflowDelayedTaskList = pxTemp;																\
+		xNumOfOverflows++;																				\
+		prvResetNextTaskUnblockTime();																	\
+	}
+
+	/* Delayed tasks are held in wake time order. */
+	#define taskDELAYED_LIST_FOR( xTimeToWake )				pxDelayedTaskList
+	#define taskINSERT_DELAYED_TASK( pxList, pxListItem )	vListInsert( ( pxList ), ( pxListItem ) )
+	#define taskLIST_IS_DELAYED( pxList )					( ( ( pxList ) == pxDelayedTaskList ) || ( ( pxList ) == pxOverflowDelayedTaskList ) )
+
+#else /* configUSE_DELAYED_TASK_WHEEL */
+
+	/* The tasks whose wake time overflowed are moved into the timing wheel
+	when the tick count overflows, by which time the wheel is empty. */
+	#define taskSWITCH_DELAYED_LISTS()																	\
+	{																									\
+		prvMoveOverflowedTasksToWheel();																\
+		xNumOfOverflows++;																				\
+		prvResetNextTaskUnblockTime();																	\
+	}
+
+	/* Delayed tasks are held unordered in a slot of the timing wheel, so
+	blocking takes constant time however many tasks are delayed.  The overflow
+	list is unordered too. */
+	#define taskDELAYED_LIST_FOR( xTimeToWake )				prvGetDelayedTaskSlot( xTimeToWake )
+	#define taskINSERT_DELAYED_TASK( pxList, pxListItem )	vListInsertEnd( ( pxList ), ( pxListItem ) )
+	#define taskLIST_IS_DELAYED( pxList )					( ( ( ( pxList ) >= &( xDelayedTaskWheel[ 0 ] ) ) && ( ( pxList ) <= &( xDelayedTaskWheel[ taskWHEEL_SLOTS - 1 ] ) ) ) || ( ( pxList ) == pxOverflowDelayedTaskList ) )
+
+	/* Each level of the wheel has configDELAYED_TASK_WHEEL_SIZE slots and is
+	indexed by the next taskWHEEL_SLOT_BITS bits of the wake time up from the
+	level below, with enough levels to index every bit of a TickType_t. */
+	#if ( configDELAYED_TASK_WHEEL_SIZE == 16 )
+		#define taskWHEEL_SLOT_BITS		4U
+	#elif ( configDELAYED_TASK_WHEEL_SIZE == 32 )
+		#define taskWHEEL_SLOT_BITS		5U
+	#elif ( configDELAYED_TASK_WHEEL_SIZE == 64 )
+		#define taskWHEEL_SLOT_BITS		6U
+	#elif ( configDELAYED_TASK_WHEEL_SIZE == 128 )
+		#define taskWHEEL_SLOT_BITS		7U
+	#else
+		#define taskWHEEL_SLOT_BITS		8U
+	#endif
+
+	#define taskWHEEL_LEVELS			( ( UBaseType_t ) ( ( ( sizeof( TickType_t ) * 8U ) + taskWHEEL_SLOT_BITS - 1U ) / taskWHEEL_SLOT_BITS ) )
+	#define taskWHEEL_SLOTS				( taskWHEEL_LEVELS * ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE )
+
+	/* Each level has a bitmap of the slots that hold tasks, so the earliest
+	task is found without looking at the empty slots. */
+	#define taskWHEEL_BITMAP_BITS		( ( UBaseType_t ) ( sizeof( UBaseType_t ) * 8U ) )
+	#define taskWHEEL_BITMAP_WORDS		( ( ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE + taskWHEEL_BITMAP_BITS - 1U ) / taskWHEEL_BITMAP_BITS )
+
+	#ifdef portLOWEST_BIT
+		#define taskLOWEST_BIT( uxBitmap )	portLOWEST_BIT( uxBitmap )
+	#else
+		#define taskLOWEST_BIT( uxBitmap )	prvLowestBit( uxBitmap )
+	#endif
+
+#endif /* configUSE_DELAYED_TASK_WHEEL */
 
 /*-----------------------------------------------------------*/
 
 /*
  * Place the task represented by pxTCB into the appropriate ready list for
- * the task.  It is inserted at the end of the list.
+ * the task.  It is inserted at the end of the list, or in deadline order when
+ * configUSE_EDF_SCHEDULING is 1.
  */
-#define prvAddTaskToReadyList( pxTCB )																\
-	traceMOVED_TASK_TO_READY_STATE( pxTCB );														\
-	taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority );												\
-	vListInsertEnd( &( pxReadyTasksLists[ ( pxTCB )->uxPriority ] ), &( ( pxTCB )->xStateListItem ) ); \
-	tracePOST_MOVED_TASK_TO_READY_STATE( pxTCB )
+#if ( configNUMBER_OF_CORES == 1 )
+	#define prvAddTaskToReadyList( pxTCB )																\
+		traceMOVED_TASK_TO_READY_STATE( pxTCB );														\
+		taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority );												\
+		taskINSERT_READY_TASK( pxTCB );																	\
+		tracePOST_MOVED_TASK_TO_READY_STATE( pxTCB )
+#else
+	/* As above, then interrupt a core the task should now be running on. */
+	#define prvAddTaskToReadyList( pxTCB )																\
+		traceMOVED_TASK_TO_READY_STATE( pxTCB );														\
+		taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority );												\
+		taskINSERT_READY_TASK( pxTCB );																	\
+		tracePOST_MOVED_TASK_TO_READY_STATE( pxTCB );													\
+		prvYieldForTask( pxTCB )
+#endif
 /*-----------------------------------------------------------*/
 
 /*
@@ -307,7 +422,7 @@ typedef struct tskTaskControlBlock
 	#endif
 
 	#if( configGENERATE_RUN_TIME_STATS == 1 )
-		uint32_t		ulRunTimeCounter;	/*< Stores the amount of time the task has spent in the Running state. */
+		configRUN_TIME_COUNTER_TYPE	ulRunTimeCounter;	/*< Stores the amount of time the task has spent in the Running state. */
 	#endif
 
 	#if ( configUSE_NEWLIB_REENTRANT == 1 )
@@ -336,6 +451,28 @@ typedef struct tskTaskControlBlock
 		uint8_t ucDelayAborted;
 	#endif
 
+	#if( configNUMBER_OF_CORES > 1 )
+		volatile BaseType_t	xTaskRunState;		/*< The core the task is running on, or taskTASK_NOT_RUNNING. */
+		UBaseType_t			uxCoreAffinityMask;	/*< Bit n set allows the task to run on core n. */
+	#endif
+
+	#if( configUSE_EDF_SCHEDULING == 1 )
+		TickType_t			xPeriod;			/*< The time between releases of the task's jobs, or 0 if the task has no deadline. */
+		TickType_t			xRelativeDeadline;	/*< The deadline of each job, measured from its release. */
+		TickType_t			xReleaseTime;		/*< The release time of the current job. */
+		TickType_t			xAbsoluteDeadline;	/*< The deadline of the current job, which orders the ready list. */
+		UBaseType_t			uxDeadlineMisses;	/*< The number of jobs that completed after their deadline. */
+	#endif
+
+	#if( configUSE_TASK_BUDGETS == 1 )
+		TickType_t			xBudget;			/*< The ticks the task can run for in each replenishment period, or 0 if the task has no budget. */
+		TickType_t			xBudgetPeriod;		/*< The length of a replenishment period. */
+		TickType_t			xBudgetConsumed;	/*< The ticks charged to the task in the current period, up to when it was last switched out. */
+		TickType_t			xBudgetReplenishTime;	/*< The start of the next replenishment period. */
+		ListItem_t			xBudgetListItem;	/*< Used to reference the task from xBudgetExhaustedTaskList while it is demoted. */
+		UBaseType_t			uxBudgetExhaustions;	/*< The number of times the task has been demoted. */
+	#endif
+
 } tskTCB;
 
 /* The old tskTCB name is maintained above then typedefed to the new TCB_t name
@@ -345,14 +482,29 @@ typedef tskTCB TCB_t;
 /*lint -save -e956 A manual analysis and inspection has been used to determine
 which static variables must be declared volatile. */
 
-PRIVILEGED_DATA TCB_t * volatile pxCurrentTCB = NULL;
+#if ( configNUMBER_OF_CORES == 1 )
+	PRIVILEGED_DATA TCB_t * volatile pxCurrentTCB = NULL;
+#else
+	/* Each core runs its own task.  Within this file pxCurrentTCB names the
+	task of the calling core, see prvGetCurrentTCB(). */
+	PRIVILEGED_DATA TCB_t * volatile pxCurrentTCBs[ configNUMBER_OF_CORES ] = { NULL };
+	#define pxCurrentTCB	prvGetCurrentTCB()
+#endif
 
 /* Lists for ready and blocked tasks. --------------------*/
 PRIVILEGED_DATA static List_t pxReadyTasksLists[ configMAX_PRIORITIES ];/*< Prioritised ready tasks. */
+#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
 PRIVILEGED_DATA static List_t xDelayedTaskList1;						/*< Delayed tasks. */
 PRIVILEGED_DATA static List_t xDelayedTaskList2;						/*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
 PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;				/*< Points to the delayed task list currently being used. */
 PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList;		/*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+#else
+PRIVILEGED_DATA static List_t xDelayedTaskWheel[ taskWHEEL_SLOTS ];	/*< Delayed tasks, configDELAYED_TASK_WHEEL_SIZE slots for each level of the timing wheel. */
+PRIVILEGED_DATA static UBaseType_t uxDelayedTaskWheelOccupied[ taskWHEEL_LEVELS ][ taskWHEEL_BITMAP_WORDS ];	/*< A bit for each slot that may hold a task.  Bits are cleared when their slot is next found empty. */
+PRIVILEGED_DATA static TickType_t xDelayedTaskWheelTime = ( TickType_t ) 0U;	/*< No task in the wheel wakes before this time.  A task is in the level for the highest bits in which its wake time differs from it. */
+PRIVILEGED_DATA static List_t xOverflowDelayedTaskList;					/*< Delayed tasks whose wake time has overflowed the current tick count. */
+PRIVILEGED_DATA static List_t * const pxOverflowDelayedTaskList = &xOverflowDelayedTaskList;
+#endif
 PRIVILEGED_DATA static List_t xPendingReadyList;						/*< Tasks that have been readied while the scheduler was suspended.  They will be moved to the ready list when the scheduler is resumed. */
 
 #if( INCLUDE_vTaskDelete == 1 )
@@ -374,11 +526,23 @@ PRIVILEGED_DATA static volatile TickType_t xTickCount 				= ( TickType_t ) confi
 PRIVILEGED_DATA static volatile UBaseType_t uxTopReadyPriority 		= tskIDLE_PRIORITY;
 PRIVILEGED_DATA static volatile BaseType_t xSchedulerRunning 		= pdFALSE;
 PRIVILEGED_DATA static volatile UBaseType_t uxPendedTicks 			= ( UBaseType_t ) 0U;
-PRIVILEGED_DATA static volatile BaseType_t xYieldPending 			= pdFALSE;
+#if ( configNUMBER_OF_CORES == 1 )
+	PRIVILEGED_DATA static volatile BaseType_t xYieldPending 		= pdFALSE;
+#endif
 PRIVILEGED_DATA static volatile BaseType_t xNumOfOverflows 			= ( BaseType_t ) 0;
 PRIVILEGED_DATA static UBaseType_t uxTaskNumber 					= ( UBaseType_t ) 0U;
 PRIVILEGED_DATA static volatile TickType_t xNextTaskUnblockTime		= ( TickType_t ) 0U; /* Initialised to portMAX_DELAY before the scheduler starts. */
-PRIVILEGED_DATA static TaskHandle_t xIdleTaskHandle					= NULL;			/*< Holds the handle of the idle task.  The idle task is created automatically when the scheduler is started. */
+#if ( configNUMBER_OF_CORES == 1 )
+	PRIVILEGED_DATA static TaskHandle_t xIdleTaskHandle				= NULL;			/*< Holds the handle of the idle task.  The idle task is created automatically when the scheduler is started. */
+#else
+	/* Every core has an idle task, and pending context switches and the run
+	time stats switch-in time are kept per core.  The old names refer to the
+	calling core, and xIdleTaskHandle to the idle task of core 0. */
+	PRIVILEGED_DATA static volatile BaseType_t xYieldPendings[ configNUMBER_OF_CORES ] = { pdFALSE };
+	PRIVILEGED_DATA static TaskHandle_t xIdleTaskHandles[ configNUMBER_OF_CORES ] = { NULL };
+	#define xYieldPending		xYieldPendings[ portGET_CORE_ID() ]
+	#define xIdleTaskHandle		xIdleTaskHandles[ 0 ]
+#endif
 
 /* Context switches are held pending while the scheduler is suspended.  Also,
 interrupts must not manipulate the xStateListItem of a TCB, or any of the
@@ -392,8 +556,20 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
-	PRIVILEGED_DATA static uint32_t ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
-	PRIVILEGED_DATA static uint32_t ulTotalRunTime = 0UL;		/*< Holds the total amount of execution time as defined by the run time counter clock. */
+	#if ( configNUMBER_OF_CORES == 1 )
+		PRIVILEGED_DATA static configRUN_TIME_COUNTER_TYPE ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
+	#else
+		PRIVILEGED_DATA static configRUN_TIME_COUNTER_TYPE ulTaskSwitchedInTimes[ configNUMBER_OF_CORES ] = { 0UL };
+		#define ulTaskSwitchedInTime	ulTaskSwitchedInTimes[ portGET_CORE_ID() ]
+	#endif
+	PRIVILEGED_DATA static configRUN_TIME_COUNTER_TYPE ulTotalRunTime = 0UL;		/*< Holds the total amount of execution time as defined by the run time counter clock. */
+
+#endif
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+	PRIVILEGED_DATA static List_t xBudgetExhaustedTaskList;						/*< Tasks demoted for using up their budget, waiting for it to be replenished. */
+	PRIVILEGED_DATA static TickType_t xTaskSwitchedInTick = ( TickType_t ) 0U;	/*< The tick count when the running task was switched in. */
 
 #endif
 
@@ -534,6 +710,101 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait, const BaseT
  */
 static void prvResetNextTaskUnblockTime( void );
 
+/*
+ * Move every task whose wake time is no later than xConstTickCount from the
+ * delayed lists to the ready lists.  Returns pdTRUE if one of them should
+ * preempt the running task.
+ */
+static BaseType_t prvUnblockExpiredTasks( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+	/*
+	 * Insert the task into the ready list for its priority, after the tasks
+	 * whose deadline is no later than its own and before those without a
+	 * deadline.
+	 */
+	static void prvInsertReadyTaskByDeadline( TCB_t *pxTCB ) PRIVILEGED_FUNCTION;
+
+#endif
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+	/*
+	 * Called from the tick.  Replenishes the budgets of demoted tasks whose
+	 * replenishment period has started, and demotes the running task if it has
+	 * used up its budget.  Returns pdTRUE if either means a context switch is
+	 * required.
+	 */
+	static BaseType_t prvCheckTaskBudgets( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Start the replenishment period that contains xConstTickCount, with the
+	 * whole budget available, and restore the priority of a demoted task.
+	 */
+	static void prvReplenishTaskBudget( TCB_t *pxTCB, const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * If the task has been demoted, take it off xBudgetExhaustedTaskList and
+	 * restore its priority.
+	 */
+	static void prvRestoreBudgetPriority( TCB_t *pxTCB ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Change the priority the task runs at, moving it to the matching ready
+	 * list if it is ready.  Leaves uxBasePriority alone.
+	 */
+	static void prvSetBudgetPriority( TCB_t *pxTCB, UBaseType_t uxNewPriority ) PRIVILEGED_FUNCTION;
+
+#endif
+
+#if ( configUSE_DELAYED_TASK_WHEEL == 1 )
+
+	/*
+	 * Return the slot of the timing wheel for a task that wakes at
+	 * xTimeToWake, marking the slot as occupied.
+	 */
+	static List_t *prvGetDelayedTaskSlot( const TickType_t xTimeToWake ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Return the first slot in a level of the timing wheel that holds a task,
+	 * or configDELAYED_TASK_WHEEL_SIZE if none do.
+	 */
+	static UBaseType_t prvGetFirstOccupiedSlot( const UBaseType_t uxLevel ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Return the slot of the timing wheel that holds the earliest task, or NULL
+	 * if the wheel is empty, and set *pxSlotTime to the start of the slot.
+	 * Slots above the first level that start no later than xConstTickCount are
+	 * cascaded down first, so such a slot is only returned once it starts
+	 * after xConstTickCount.
+	 */
+	static List_t *prvGetFirstDelayedTaskSlot( const TickType_t xConstTickCount, TickType_t * const pxSlotTime ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Return a task from the timing wheel whose wake time is no later than
+	 * xConstTickCount.  If there are none set xNextTaskUnblockTime for the
+	 * earliest task that remains and return NULL.
+	 */
+	static TCB_t *prvGetExpiredDelayedTask( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Move the tasks whose wake time overflowed into the timing wheel once the
+	 * tick count has overflowed too.
+	 */
+	static void prvMoveOverflowedTasksToWheel( void ) PRIVILEGED_FUNCTION;
+
+	#ifndef portLOWEST_BIT
+
+		/*
+		 * Return the number of the lowest bit set in uxBitmap, which is not 0.
+		 */
+		static UBaseType_t prvLowestBit( UBaseType_t uxBitmap ) PRIVILEGED_FUNCTION;
+
+	#endif
+
+#endif
+
 #if ( ( configUSE_TRACE_FACILITY == 1 ) && ( configUSE_STATS_FORMATTING_FUNCTIONS > 0 ) )
 
 	/*
@@ -563,6 +834,35 @@ static void prvInitialiseNewTask( 	TaskFunction_t pxTaskCode,
  */
 static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB ) PRIVILEGED_FUNCTION;
 
+#if ( configNUMBER_OF_CORES > 1 )
+
+	/*
+	 * Return the task running on the calling core.  Within this file
+	 * pxCurrentTCB expands to a call to this function.
+	 */
+	static TCB_t *prvGetCurrentTCB( void ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Called after pxTCB has been added to a ready list.  Interrupts the core
+	 * pxTCB is running on, or otherwise the core pxTCB is allowed on that runs
+	 * the lowest priority task if that priority is below the priority of pxTCB,
+	 * so that the core selects its task again.
+	 */
+	static void prvYieldForTask( TCB_t *pxTCB ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Make the highest priority ready task that is allowed on core xCoreID, and
+	 * is not running on another core, the task of core xCoreID.
+	 */
+	static void prvSelectHighestPriorityTask( BaseType_t xCoreID ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * See taskSCHEDULER_SUSPENDED_BY_CALLER().
+	 */
+	static BaseType_t prvSchedulerSuspendedByCaller( void ) PRIVILEGED_FUNCTION;
+
+#endif
+
 /*
  * freertos_tasks_c_additions_init() should only be called if the user definable
  * macro FREERTOS_TASKS_C_ADDITIONS_INIT() is defined, as that is the only macro
@@ -957,6 +1257,30 @@ UBaseType_t x;
 	}
 	#endif /* configGENERATE_RUN_TIME_STATS */
 
+	#if ( configUSE_EDF_SCHEDULING == 1 )
+	{
+		/* Tasks are created without a deadline. */
+		pxNewTCB->xPeriod = ( TickType_t ) 0U;
+		pxNewTCB->xRelativeDeadline = ( TickType_t ) 0U;
+		pxNewTCB->xReleaseTime = ( TickType_t ) 0U;
+		pxNewTCB->xAbsoluteDeadline = ( TickType_t ) 0U;
+		pxNewTCB->uxDeadlineMisses = ( UBaseType_t ) 0U;
+	}
+	#endif /* configUSE_EDF_SCHEDULING */
+
+	#if ( configUSE_TASK_BUDGETS == 1 )
+	{
+		/* Tasks are created without a budget. */
+		pxNewTCB->xBudget = ( TickType_t ) 0U;
+		pxNewTCB->xBudgetPeriod = ( TickType_t ) 0U;
+		pxNewTCB->xBudgetConsumed = ( TickType_t ) 0U;
+		pxNewTCB->xBudgetReplenishTime = ( TickType_t ) 0U;
+		vListInitialiseItem( &( pxNewTCB->xBudgetListItem ) );
+		listSET_LIST_ITEM_OWNER( &( pxNewTCB->xBudgetListItem ), pxNewTCB );
+		pxNewTCB->uxBudgetExhaustions = ( UBaseType_t ) 0U;
+	}
+	#endif /* configUSE_TASK_BUDGETS */
+
 	#if ( portUSING_MPU_WRAPPERS == 1 )
 	{
 		vPortStoreTaskMPUSettings( &( pxNewTCB->xMPUSettings ), xRegions, pxNewTCB->pxStack, ulStackDepth );
@@ -997,6 +1321,13 @@ UBaseType_t x;
 	}
 	#endif
 
+	#if( configNUMBER_OF_CORES > 1 )
+	{
+		pxNewTCB->xTaskRunState = taskTASK_NOT_RUNNING;
+		pxNewTCB->uxCoreAffinityMask = tskNO_AFFINITY;
+	}
+	#endif
+
 	/* Initialize the TCB stack to look as if the task was already running,
 	but had been interrupted by the scheduler.  The return address is set
 	to the start of the task function. Once the stack has been initialised
@@ -1031,45 +1362,64 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 	taskENTER_CRITICAL();
 	{
 		uxCurrentNumberOfTasks++;
-		if( pxCurrentTCB == NULL )
-		{
-			/* There are no other tasks, or all the other tasks are in
-			the suspended state - make this the current task. */
-			pxCurrentTCB = pxNewTCB;
 
-			if( uxCurrentNumberOfTasks == ( UBaseType_t ) 1 )
+		#if ( configNUMBER_OF_CORES == 1 )
+		{
+			if( pxCurrentTCB == NULL )
 			{
-				/* This is the first task to be created so do the preliminary
-				initialisation required.  We will not recover if this call
-				fails, but we will report the failure. */
-				prvInitialiseTaskLists();
+				/* There are no other tasks, or all the other tasks are in
+				the suspended state - make this the current task. */
+				pxCurrentTCB = pxNewTCB;
+
+				if( uxCurrentNumberOfTasks == ( UBaseType_t ) 1 )
+				{
+					/* This is the first task to be created so do the preliminary
+					initialisation required.  We will not recover if this call
+					fails, but we will report the failure. */
+					prvInitialiseTaskLists();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
 			}
 			else
 			{
-				mtCOVERAGE_TEST_MARKER();
-			}
-		}
-		else
-		{
-			/* If the scheduler is not already running, make this task the
-			current task if it is the highest priority task to be created
-			so far. */
-			if( xSchedulerRunning == pdFALSE )
-			{
-				if( pxCurrentTCB->uxPriority <= pxNewTCB->uxPriority )
+				/* If the scheduler is not already running, make this task the
+				current task if it is the highest priority task to be created
+				so far. */
+				if( xSchedulerRunning == pdFALSE )
 				{
-					pxCurrentTCB = pxNewTCB;
+					if( pxCurrentTCB->uxPriority <= pxNewTCB->uxPriority )
+					{
+						pxCurrentTCB = pxNewTCB;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
 				}
 				else
 				{
 					mtCOVERAGE_TEST_MARKER();
 				}
 			}
+		}
+		#else /* configNUMBER_OF_CORES */
+		{
+			/* Each core selects its first task when the scheduler starts,
+			and afterwards prvAddTaskToReadyList() finds the new task a core,
+			so only the lists need setting up here. */
+			if( uxCurrentNumberOfTasks == ( UBaseType_t ) 1 )
+			{
+				prvInitialiseTaskLists();
+			}
 			else
 			{
 				mtCOVERAGE_TEST_MARKER();
 			}
 		}
+		#endif /* configNUMBER_OF_CORES */
 
 		uxTaskNumber++;
 
@@ -1087,23 +1437,27 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 	}
 	taskEXIT_CRITICAL();
 
-	if( xSchedulerRunning != pdFALSE )
+	#if ( configNUMBER_OF_CORES == 1 )
 	{
-		/* If the created task is of a higher priority than the current task
-		then it should run now. */
-		if( pxCurrentTCB->uxPriority < pxNewTCB->uxPriority )
+		if( xSchedulerRunning != pdFALSE )
 		{
-			taskYIELD_IF_USING_PREEMPTION();
+			/* If the created task is of a higher priority than the current task
+			then it should run now. */
+			if( pxCurrentTCB->uxPriority < pxNewTCB->uxPriority )
+			{
+				taskYIELD_IF_USING_PREEMPTION();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
 		}
 		else
 		{
 			mtCOVERAGE_TEST_MARKER();
 		}
 	}
-	else
-	{
-		mtCOVERAGE_TEST_MARKER();
-	}
+	#endif /* configNUMBER_OF_CORES */
 }
 /*-----------------------------------------------------------*/
 
@@ -1139,13 +1493,33 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 				mtCOVERAGE_TEST_MARKER();
 			}
 
+			#if ( configUSE_TASK_BUDGETS == 1 )
+			{
+				/* Is the task waiting for its budget to be replenished? */
+				if( listLIST_ITEM_CONTAINER( &( pxTCB->xBudgetListItem ) ) != NULL )
+				{
+					( void ) uxListRemove( &( pxTCB->xBudgetListItem ) );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif
+
 			/* Increment the uxTaskNumber also so kernel aware debuggers can
 			detect that the task lists need re-generating.  This is done before
 			portPRE_TASK_DELETE_HOOK() as in the Windows port that macro will
 			not return. */
 			uxTaskNumber++;
 
-			if( pxTCB == pxCurrentTCB )
+			#if ( configNUMBER_OF_CORES == 1 )
+				if( pxTCB == pxCurrentTCB )
+			#else
+				/* A task running on another core is treated as if it deleted
+				itself, as that core has to switch away from it first. */
+				if( pxTCB->xTaskRunState != taskTASK_NOT_RUNNING )
+			#endif
 			{
 				/* A task is deleting itself.  This cannot complete within the
 				task itself, as a context switch to another task is required.
@@ -1165,6 +1539,21 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 				hence xYieldPending is used to latch that a context switch is
 				required. */
 				portPRE_TASK_DELETE_HOOK( pxTCB, &xYieldPending );
+
+				#if ( configNUMBER_OF_CORES > 1 )
+				{
+					/* The other core cannot switch tasks while the task lock
+					is held, so the run state is still valid. */
+					if( pxTCB != pxCurrentTCB )
+					{
+						portYIELD_CORE( pxTCB->xTaskRunState );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				#endif
 			}
 			else
 			{
@@ -1186,7 +1575,7 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 		{
 			if( pxTCB == pxCurrentTCB )
 			{
-				configASSERT( uxSchedulerSuspended == 0 );
+				configASSERT( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE );
 				portYIELD_WITHIN_API();
 			}
 			else
@@ -1208,7 +1597,7 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 
 		configASSERT( pxPreviousWakeTime );
 		configASSERT( ( xTimeIncrement > 0U ) );
-		configASSERT( uxSchedulerSuspended == 0 );
+		configASSERT( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE );
 
 		vTaskSuspendAll();
 		{
@@ -1292,7 +1681,7 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 		/* A delay time of zero just forces a reschedule. */
 		if( xTicksToDelay > ( TickType_t ) 0U )
 		{
-			configASSERT( uxSchedulerSuspended == 0 );
+			configASSERT( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE );
 			vTaskSuspendAll();
 			{
 				traceTASK_DELAY();
@@ -1338,9 +1727,14 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 
 		configASSERT( pxTCB );
 
-		if( pxTCB == pxCurrentTCB )
+		#if ( configNUMBER_OF_CORES == 1 )
+			if( pxTCB == pxCurrentTCB )
+		#else
+			if( pxTCB->xTaskRunState != taskTASK_NOT_RUNNING )
+		#endif
 		{
-			/* The task calling this function is querying its own state. */
+			/* The task calling this function is querying its own state, or
+			the state of a task running on another core. */
 			eReturn = eRunning;
 		}
 		else
@@ -1351,7 +1745,7 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 			}
 			taskEXIT_CRITICAL();
 
-			if( ( pxStateList == pxDelayedTaskList ) || ( pxStateList == pxOverflowDelayedTaskList ) )
+			if( taskLIST_IS_DELAYED( pxStateList ) )
 			{
 				/* The task being queried is referenced from one of the Blocked
 				lists. */
@@ -1625,53 +2019,453 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 #endif /* INCLUDE_vTaskPrioritySet */
 /*-----------------------------------------------------------*/
 
-#if ( INCLUDE_vTaskSuspend == 1 )
+#if ( configUSE_EDF_SCHEDULING == 1 )
 
-	void vTaskSuspend( TaskHandle_t xTaskToSuspend )
+	void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xPeriod, TickType_t xRelativeDeadline )
 	{
 	TCB_t *pxTCB;
 
+		configASSERT( ( xPeriod == ( TickType_t ) 0U ) || ( xRelativeDeadline > ( TickType_t ) 0U ) );
+
 		taskENTER_CRITICAL();
 		{
-			/* If null is passed in here then it is the running task that is
-			being suspended. */
-			pxTCB = prvGetTCBFromHandle( xTaskToSuspend );
+			/* If null is passed in here then it is the calling task that is
+			being given a deadline. */
+			pxTCB = prvGetTCBFromHandle( xTask );
 
-			traceTASK_SUSPEND( pxTCB );
+			/* The first job is released now. */
+			pxTCB->xPeriod = xPeriod;
+			pxTCB->xRelativeDeadline = xRelativeDeadline;
+			pxTCB->xReleaseTime = xTickCount;
+			pxTCB->xAbsoluteDeadline = xTickCount + xRelativeDeadline;
+			pxTCB->uxDeadlineMisses = ( UBaseType_t ) 0U;
 
-			/* Remove task from the ready/delayed list and place in the
-			suspended list. */
-			if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+			/* A ready task moves to its place for the new deadline, which may
+			now be the earliest. */
+			if( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE )
 			{
-				taskRESET_READY_PRIORITY( pxTCB->uxPriority );
+				if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+				{
+					portRESET_READY_PRIORITY( pxTCB->uxPriority, uxTopReadyPriority );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				prvAddTaskToReadyList( pxTCB );
+
+				if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+				{
+					taskYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
 			}
 			else
 			{
 				mtCOVERAGE_TEST_MARKER();
 			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
 
-			/* Is the task waiting on an event also? */
-			if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+	void vTaskWaitForNextPeriod( void )
+	{
+	BaseType_t xAlreadyYielded;
+
+		configASSERT( pxCurrentTCB->xPeriod != ( TickType_t ) 0U );
+		configASSERT( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE );
+
+		vTaskSuspendAll();
+		{
+			/* Minor optimisation.  The tick count cannot change in this
+			block. */
+			const TickType_t xConstTickCount = xTickCount;
+
+			/* The job that has just completed missed its deadline if the
+			deadline has already passed. */
+			if( taskTICK_IS_BEFORE( pxCurrentTCB->xAbsoluteDeadline, xConstTickCount ) != pdFALSE )
 			{
-				( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+				( pxCurrentTCB->uxDeadlineMisses )++;
 			}
 			else
 			{
 				mtCOVERAGE_TEST_MARKER();
 			}
 
-			vListInsertEnd( &xSuspendedTaskList, &( pxTCB->xStateListItem ) );
+			/* The next job is released one period after the last. */
+			pxCurrentTCB->xReleaseTime += pxCurrentTCB->xPeriod;
+			pxCurrentTCB->xAbsoluteDeadline = pxCurrentTCB->xReleaseTime + pxCurrentTCB->xRelativeDeadline;
 
-			#if( configUSE_TASK_NOTIFICATIONS == 1 )
+			if( taskTICK_IS_BEFORE( xConstTickCount, pxCurrentTCB->xReleaseTime ) != pdFALSE )
 			{
-				if( pxTCB->ucNotifyState == taskWAITING_NOTIFICATION )
-				{
-					/* The task was blocked to wait for a notification, but is
-					now suspended, so no notification was received. */
+				traceTASK_DELAY_UNTIL( pxCurrentTCB->xReleaseTime );
+
+				/* prvAddCurrentTaskToDelayedList() needs the block time, not
+				the time to wake, so subtract the current tick count. */
+				prvAddCurrentTaskToDelayedList( pxCurrentTCB->xReleaseTime - xConstTickCount, pdFALSE );
+			}
+			else
+			{
+				/* The job has overrun into its next period, which has already
+				been released, so stay ready in the place for the new
+				deadline. */
+				if( uxListRemove( &( pxCurrentTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+				{
+					portRESET_READY_PRIORITY( pxCurrentTCB->uxPriority, uxTopReadyPriority );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				prvAddTaskToReadyList( pxCurrentTCB );
+			}
+		}
+		xAlreadyYielded = xTaskResumeAll();
+
+		/* Force a reschedule if xTaskResumeAll has not already done so, we may
+		have put ourselves to sleep. */
+		if( xAlreadyYielded == pdFALSE )
+		{
+			portYIELD_WITHIN_API();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvInsertReadyTaskByDeadline( TCB_t *pxTCB )
+	{
+	List_t * const pxReadyList = &( pxReadyTasksLists[ pxTCB->uxPriority ] );
+	ListItem_t *pxIterator;
+	ListItem_t *pxIndex;
+	TCB_t *pxOtherTCB;
+
+		if( ( pxTCB->xPeriod == ( TickType_t ) 0U ) &&
+			( ( listLIST_IS_EMPTY( pxReadyList ) != pdFALSE ) || ( ( ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxReadyList ) )->xPeriod == ( TickType_t ) 0U ) ) )
+		{
+			/* No ready task at this priority has a deadline, so the task
+			takes its turn as usual. */
+			vListInsertEnd( pxReadyList, &( pxTCB->xStateListItem ) );
+		}
+		else
+		{
+			/* Find the first task with a later deadline or no deadline.  A
+			task without a deadline goes to the very end. */
+			for( pxIterator = listGET_HEAD_ENTRY( pxReadyList ); pxIterator != listGET_END_MARKER( pxReadyList ); pxIterator = listGET_NEXT( pxIterator ) )
+			{
+				if( pxTCB->xPeriod != ( TickType_t ) 0U )
+				{
+					pxOtherTCB = ( TCB_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+					if( ( pxOtherTCB->xPeriod == ( TickType_t ) 0U ) || ( taskTICK_IS_BEFORE( pxTCB->xAbsoluteDeadline, pxOtherTCB->xAbsoluteDeadline ) != pdFALSE ) )
+					{
+						break;
+					}
+				}
+			}
+
+			/* vListInsertEnd() inserts in front of the list's index, so point
+			the index at the place found while inserting. */
+			pxIndex = pxReadyList->pxIndex;
+			pxReadyList->pxIndex = pxIterator;
+			vListInsertEnd( pxReadyList, &( pxTCB->xStateListItem ) );
+			pxReadyList->pxIndex = pxIndex;
+		}
+	}
+
+#endif /* configUSE_EDF_SCHEDULING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+	void vTaskSetBudget( TaskHandle_t xTask, TickType_t xBudget, TickType_t xReplenishmentPeriod )
+	{
+	TCB_t *pxTCB;
+
+		configASSERT( ( xBudget == ( TickType_t ) 0U ) || ( xReplenishmentPeriod >= xBudget ) );
+
+		taskENTER_CRITICAL();
+		{
+			/* If null is passed in here then it is the calling task that is
+			being given a budget. */
+			pxTCB = prvGetTCBFromHandle( xTask );
+
+			/* The first replenishment period starts now, with nothing
+			charged. */
+			pxTCB->xBudget = xBudget;
+			pxTCB->xBudgetPeriod = xReplenishmentPeriod;
+			pxTCB->xBudgetConsumed = ( TickType_t ) 0U;
+			pxTCB->xBudgetReplenishTime = xTickCount + xReplenishmentPeriod;
+			pxTCB->uxBudgetExhaustions = ( UBaseType_t ) 0U;
+
+			if( pxTCB == pxCurrentTCB )
+			{
+				xTaskSwitchedInTick = xTickCount;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* A task demoted under its old budget gets its priority back, and
+			may now be the highest priority ready task. */
+			prvRestoreBudgetPriority( pxTCB );
+
+			if( ( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE ) &&
+				( pxTCB->uxPriority > pxCurrentTCB->uxPriority ) )
+			{
+				taskYIELD_IF_USING_PREEMPTION();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvCheckTaskBudgets( const TickType_t xConstTickCount )
+	{
+	const ListItem_t * const pxEndMarker = listGET_END_MARKER( &xBudgetExhaustedTaskList );
+	ListItem_t *pxIterator, *pxNext;
+	TCB_t *pxTCB;
+	BaseType_t xSwitchRequired = pdFALSE;
+
+		/* Demoted tasks get their priority back once their next replenishment
+		period starts.  Only demoted tasks are looked at here - the budget of
+		any other task is replenished when it is next charged. */
+		for( pxIterator = listGET_HEAD_ENTRY( &xBudgetExhaustedTaskList ); pxIterator != pxEndMarker; pxIterator = pxNext )
+		{
+			pxNext = listGET_NEXT( pxIterator );
+			pxTCB = ( TCB_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+			if( taskTICK_IS_BEFORE( xConstTickCount, pxTCB->xBudgetReplenishTime ) == pdFALSE )
+			{
+				prvReplenishTaskBudget( pxTCB, xConstTickCount );
+
+				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+				{
+					xSwitchRequired = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+
+		pxTCB = pxCurrentTCB;
+
+		if( pxTCB->xBudget != ( TickType_t ) 0U )
+		{
+			if( taskTICK_IS_BEFORE( xConstTickCount, pxTCB->xBudgetReplenishTime ) == pdFALSE )
+			{
+				prvReplenishTaskBudget( pxTCB, xConstTickCount );
+			}
+			else if( ( TickType_t ) ( pxTCB->xBudgetConsumed + ( xConstTickCount - xTaskSwitchedInTick ) ) >= pxTCB->xBudget )
+			{
+				/* The budget is used up.  A task that has inherited a
+				priority keeps it, so a higher priority task waiting for a
+				mutex it holds is not held up; it is demoted at the first tick
+				after disinheriting.  That is also how a demoted task that
+				disinherits to its base priority is demoted again. */
+				if( ( pxTCB->uxPriority == pxTCB->uxBasePriority ) && ( pxTCB->uxPriority > ( UBaseType_t ) configTASK_BUDGET_EXHAUSTED_PRIORITY ) )
+				{
+					if( listIS_CONTAINED_WITHIN( &xBudgetExhaustedTaskList, &( pxTCB->xBudgetListItem ) ) == pdFALSE )
+					{
+						vListInsertEnd( &xBudgetExhaustedTaskList, &( pxTCB->xBudgetListItem ) );
+						( pxTCB->uxBudgetExhaustions )++;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					prvSetBudgetPriority( pxTCB, ( UBaseType_t ) configTASK_BUDGET_EXHAUSTED_PRIORITY );
+					xSwitchRequired = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		return xSwitchRequired;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvReplenishTaskBudget( TCB_t *pxTCB, const TickType_t xConstTickCount )
+	{
+	TickType_t xPeriodsStarted;
+
+		/* Periods in which the task was never charged are skipped over in one
+		step. */
+		xPeriodsStarted = ( ( TickType_t ) ( xConstTickCount - pxTCB->xBudgetReplenishTime ) / pxTCB->xBudgetPeriod ) + ( TickType_t ) 1U;
+		pxTCB->xBudgetReplenishTime += xPeriodsStarted * pxTCB->xBudgetPeriod;
+		pxTCB->xBudgetConsumed = ( TickType_t ) 0U;
+
+		/* Ticks the running task ran for before this period are not charged
+		to it. */
+		if( pxTCB == pxCurrentTCB )
+		{
+			xTaskSwitchedInTick = xConstTickCount;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		prvRestoreBudgetPriority( pxTCB );
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvRestoreBudgetPriority( TCB_t *pxTCB )
+	{
+		if( listIS_CONTAINED_WITHIN( &xBudgetExhaustedTaskList, &( pxTCB->xBudgetListItem ) ) != pdFALSE )
+		{
+			( void ) uxListRemove( &( pxTCB->xBudgetListItem ) );
+
+			/* A task that has inherited a priority since it was demoted gets
+			its base priority back when it disinherits. */
+			if( pxTCB->uxPriority < pxTCB->uxBasePriority )
+			{
+				prvSetBudgetPriority( pxTCB, pxTCB->uxBasePriority );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvSetBudgetPriority( TCB_t *pxTCB, UBaseType_t uxNewPriority )
+	{
+		/* Only reset the event list item value if the value is not being
+		used for anything else. */
+		if( ( listGET_LIST_ITEM_VALUE( &( pxTCB->xEventListItem ) ) & taskEVENT_LIST_ITEM_VALUE_IN_USE ) == 0UL )
+		{
+			listSET_LIST_ITEM_VALUE( &( pxTCB->xEventListItem ), ( TickType_t ) configMAX_PRIORITIES - ( TickType_t ) uxNewPriority ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* If the task is in the ready state it moves to the ready list for
+		its new priority.  A blocked or suspended task just takes the new
+		priority with it when it becomes ready. */
+		if( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE )
+		{
+			if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+			{
+				portRESET_READY_PRIORITY( pxTCB->uxPriority, uxTopReadyPriority );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			pxTCB->uxPriority = uxNewPriority;
+			prvAddTaskToReadyList( pxTCB );
+		}
+		else
+		{
+			pxTCB->uxPriority = uxNewPriority;
+		}
+	}
+
+#endif /* configUSE_TASK_BUDGETS */
+/*-----------------------------------------------------------*/
+
+#if ( INCLUDE_vTaskSuspend == 1 )
+
+	void vTaskSuspend( TaskHandle_t xTaskToSuspend )
+	{
+	TCB_t *pxTCB;
+
+		taskENTER_CRITICAL();
+		{
+			/* If null is passed in here then it is the running task that is
+			being suspended. */
+			pxTCB = prvGetTCBFromHandle( xTaskToSuspend );
+
+			traceTASK_SUSPEND( pxTCB );
+
+			/* Remove task from the ready/delayed list and place in the
+			suspended list. */
+			if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+			{
+				taskRESET_READY_PRIORITY( pxTCB->uxPriority );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* Is the task waiting on an event also? */
+			if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+			{
+				( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			vListInsertEnd( &xSuspendedTaskList, &( pxTCB->xStateListItem ) );
+
+			#if( configUSE_TASK_NOTIFICATIONS == 1 )
+			{
+				if( pxTCB->ucNotifyState == taskWAITING_NOTIFICATION )
+				{
+					/* The task was blocked to wait for a notification, but is
+					now suspended, so no notification was received. */
 					pxTCB->ucNotifyState = taskNOT_WAITING_NOTIFICATION;
 				}
 			}
 			#endif
+
+			#if ( configNUMBER_OF_CORES > 1 )
+			{
+				/* A task running on another core stops when that core switches
+				away from it. */
+				if( ( pxTCB->xTaskRunState != taskTASK_NOT_RUNNING ) && ( pxTCB != pxCurrentTCB ) )
+				{
+					portYIELD_CORE( pxTCB->xTaskRunState );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif
 		}
 		taskEXIT_CRITICAL();
 
@@ -1695,26 +2489,31 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 			if( xSchedulerRunning != pdFALSE )
 			{
 				/* The current task has just been suspended. */
-				configASSERT( uxSchedulerSuspended == 0 );
+				configASSERT( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE );
 				portYIELD_WITHIN_API();
 			}
 			else
 			{
 				/* The scheduler is not running, but the task that was pointed
 				to by pxCurrentTCB has just been suspended and pxCurrentTCB
-				must be adjusted to point to a different task. */
-				if( listCURRENT_LIST_LENGTH( &xSuspendedTaskList ) == uxCurrentNumberOfTasks )
-				{
-					/* No other tasks are ready, so set pxCurrentTCB back to
-					NULL so when the next task is created pxCurrentTCB will
-					be set to point to it no matter what its relative priority
-					is. */
-					pxCurrentTCB = NULL;
-				}
-				else
+				must be adjusted to point to a different task.  With more than
+				one core no task is current until the scheduler starts. */
+				#if ( configNUMBER_OF_CORES == 1 )
 				{
-					vTaskSwitchContext();
+					if( listCURRENT_LIST_LENGTH( &xSuspendedTaskList ) == uxCurrentNumberOfTasks )
+					{
+						/* No other tasks are ready, so set pxCurrentTCB back to
+						NULL so when the next task is created pxCurrentTCB will
+						be set to point to it no matter what its relative priority
+						is. */
+						pxCurrentTCB = NULL;
+					}
+					else
+					{
+						vTaskSwitchContext();
+					}
 				}
+				#endif /* configNUMBER_OF_CORES */
 			}
 		}
 		else
@@ -1929,7 +2728,7 @@ BaseType_t xReturn;
 			xReturn = pdFAIL;
 		}
 	}
-	#else
+	#elif ( configNUMBER_OF_CORES == 1 )
 	{
 		/* The Idle task is being created using dynamically allocated RAM. */
 		xReturn = xTaskCreate(	prvIdleTask,
@@ -1939,9 +2738,46 @@ BaseType_t xReturn;
 								( tskIDLE_PRIORITY | portPRIVILEGE_BIT ),
 								&xIdleTaskHandle ); /*lint !e961 MISRA exception, justified as it is not a redundant explicit cast to all supported compilers. */
 	}
-	#endif /* configSUPPORT_STATIC_ALLOCATION */
-
-	#if ( configUSE_TIMERS == 1 )
+	#else
+	{
+	BaseType_t xCoreID;
+	char cIdleName[ configMAX_TASK_NAME_LEN ];
+	UBaseType_t x;
+
+		/* Every core needs a task it can always run, so each core gets an
+		idle task of its own, bound to it and named after it: IDLE0, IDLE1 and
+		so on. */
+		xReturn = pdPASS;
+		for( xCoreID = 0; ( xCoreID < ( BaseType_t ) configNUMBER_OF_CORES ) && ( xReturn == pdPASS ); xCoreID++ )
+		{
+			for( x = ( UBaseType_t ) 0; ( x < ( UBaseType_t ) ( configMAX_TASK_NAME_LEN - 3 ) ) && ( configIDLE_TASK_NAME[ x ] != 0x00 ); x++ )
+			{
+				cIdleName[ x ] = configIDLE_TASK_NAME[ x ];
+			}
+
+			if( xCoreID >= 10 )
+			{
+				cIdleName[ x++ ] = ( char ) ( '0' + ( xCoreID / 10 ) );
+			}
+			cIdleName[ x++ ] = ( char ) ( '0' + ( xCoreID % 10 ) );
+			cIdleName[ x ] = 0x00;
+
+			xReturn = xTaskCreate(	prvIdleTask,
+									cIdleName,
+									configMINIMAL_STACK_SIZE,
+									( void * ) NULL,
+									( tskIDLE_PRIORITY | portPRIVILEGE_BIT ),
+									&xIdleTaskHandles[ xCoreID ] ); /*lint !e961 MISRA exception, justified as it is not a redundant explicit cast to all supported compilers. */
+
+			if( xReturn == pdPASS )
+			{
+				( ( TCB_t * ) xIdleTaskHandles[ xCoreID ] )->uxCoreAffinityMask = ( ( UBaseType_t ) 1U ) << xCoreID;
+			}
+		}
+	}
+	#endif /* configSUPPORT_STATIC_ALLOCATION */
+
+	#if ( configUSE_TIMERS == 1 )
 	{
 		if( xReturn == pdPASS )
 		{
@@ -1984,6 +2820,18 @@ BaseType_t xReturn;
 		xSchedulerRunning = pdTRUE;
 		xTickCount = ( TickType_t ) 0U;
 
+		#if ( configNUMBER_OF_CORES > 1 )
+		{
+		BaseType_t xCoreID;
+
+			/* Give every core its first task, which the port starts on it. */
+			for( xCoreID = 0; xCoreID < ( BaseType_t ) configNUMBER_OF_CORES; xCoreID++ )
+			{
+				prvSelectHighestPriorityTask( xCoreID );
+			}
+		}
+		#endif /* configNUMBER_OF_CORES */
+
 		/* If configGENERATE_RUN_TIME_STATS is defined then the following
 		macro must be defined to configure the timer/counter used to generate
 		the run time counter time base.   NOTE:  If configGENERATE_RUN_TIME_STATS
@@ -2031,11 +2879,29 @@ void vTaskEndScheduler( void )
 
 void vTaskSuspendAll( void )
 {
-	/* A critical section is not required as the variable is of type
-	BaseType_t.  Please read Richard Barry's reply in the following link to a
-	post in the FreeRTOS support forum before reporting this as a bug! -
-	http://goo.gl/wu4acr */
-	++uxSchedulerSuspended;
+	#if ( configNUMBER_OF_CORES == 1 )
+	{
+		/* A critical section is not required as the variable is of type
+		BaseType_t.  Please read Richard Barry's reply in the following link to a
+		post in the FreeRTOS support forum before reporting this as a bug! -
+		http://goo.gl/wu4acr */
+		++uxSchedulerSuspended;
+	}
+	#else
+	{
+		/* Other cores must be kept out of the task lists until the scheduler
+		is resumed, so the task lock taken by the critical section is taken a
+		second time and kept until xTaskResumeAll().  Interrupts only read
+		uxSchedulerSuspended while holding the ISR lock, which the critical
+		section also holds. */
+		taskENTER_CRITICAL();
+		{
+			portGET_TASK_LOCK();
+			++uxSchedulerSuspended;
+		}
+		taskEXIT_CRITICAL();
+	}
+	#endif /* configNUMBER_OF_CORES */
 }
 /*----------------------------------------------------------*/
 
@@ -2059,14 +2925,15 @@ void vTaskSuspendAll( void )
 		}
 		#else
 		{
-			const UBaseType_t uxLeastSignificantBit = ( UBaseType_t ) 0x01;
+		UBaseType_t uxTopPriority;
 
 			/* When port optimised task selection is used the uxTopReadyPriority
-			variable is used as a bit map.  If bits other than the least
-			significant bit are set then there are tasks that have a priority
-			above the idle priority that are in the Ready state.  This takes
+			variable is used as a bit map, which the port may split over more
+			than one word, so ask the port for the highest ready priority.  The
+			idle task is running, so at least one priority is ready.  This takes
 			care of the case where the co-operative scheduler is in use. */
-			if( uxTopReadyPriority > uxLeastSignificantBit )
+			portGET_HIGHEST_PRIORITY( uxTopPriority, uxTopReadyPriority );
+			if( uxTopPriority > tskIDLE_PRIORITY )
 			{
 				uxHigherPriorityReadyTasks = pdTRUE;
 			}
@@ -2120,6 +2987,14 @@ BaseType_t xAlreadyYielded = pdFALSE;
 	{
 		--uxSchedulerSuspended;
 
+		#if ( configNUMBER_OF_CORES > 1 )
+		{
+			/* Drop the hold vTaskSuspendAll() kept on the task lock.  The
+			critical section still holds it until the end of this block. */
+			portRELEASE_TASK_LOCK();
+		}
+		#endif
+
 		if( uxSchedulerSuspended == ( UBaseType_t ) pdFALSE )
 		{
 			if( uxCurrentNumberOfTasks > ( UBaseType_t ) 0U )
@@ -2165,18 +3040,16 @@ BaseType_t xAlreadyYielded = pdFALSE;
 
 					if( uxPendedCounts > ( UBaseType_t ) 0U )
 					{
-						do
+						/* The tasks unblocked by all the pended ticks are
+						found in one pass. */
+						if( xTaskCatchUpTicks( ( TickType_t ) uxPendedCounts ) != pdFALSE )
 						{
-							if( xTaskIncrementTick() != pdFALSE )
-							{
-								xYieldPending = pdTRUE;
-							}
-							else
-							{
-								mtCOVERAGE_TEST_MARKER();
-							}
-							--uxPendedCounts;
-						} while( uxPendedCounts > ( UBaseType_t ) 0U );
+							xYieldPending = pdTRUE;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
 
 						uxPendedTicks = 0;
 					}
@@ -2366,10 +3239,21 @@ TCB_t *pxTCB;
 			} while( uxQueue > ( UBaseType_t ) tskIDLE_PRIORITY ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
 
 			/* Search the delayed lists. */
-			if( pxTCB == NULL )
+			#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+			{
+				if( pxTCB == NULL )
+				{
+					pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
+				}
+			}
+			#else
 			{
-				pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
+				for( uxQueue = ( UBaseType_t ) 0U; ( uxQueue < taskWHEEL_SLOTS ) && ( pxTCB == NULL ); uxQueue++ )
+				{
+					pxTCB = prvSearchForNameWithinSingleList( &( xDelayedTaskWheel[ uxQueue ] ), pcNameToQuery );
+				}
 			}
+			#endif
 
 			if( pxTCB == NULL )
 			{
@@ -2406,7 +3290,7 @@ TCB_t *pxTCB;
 
 #if ( configUSE_TRACE_FACILITY == 1 )
 
-	UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, uint32_t * const pulTotalRunTime )
+	UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, configRUN_TIME_COUNTER_TYPE * const pulTotalRunTime )
 	{
 	UBaseType_t uxTask = 0, uxQueue = configMAX_PRIORITIES;
 
@@ -2426,7 +3310,18 @@ TCB_t *pxTCB;
 
 				/* Fill in an TaskStatus_t structure with information on each
 				task in the Blocked state. */
-				uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
+				#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+				{
+					uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
+				}
+				#else
+				{
+					for( uxQueue = ( UBaseType_t ) 0U; uxQueue < taskWHEEL_SLOTS; uxQueue++ )
+					{
+						uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), &( xDelayedTaskWheel[ uxQueue ] ), eBlocked );
+					}
+				}
+				#endif
 				uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
 
 				#if( INCLUDE_vTaskDelete == 1 )
@@ -2491,6 +3386,83 @@ TCB_t *pxTCB;
 #endif /* INCLUDE_xTaskGetIdleTaskHandle */
 /*----------------------------------------------------------*/
 
+#if ( configNUMBER_OF_CORES > 1 )
+
+	void vTaskCoreAffinitySet( TaskHandle_t xTask, UBaseType_t uxCoreAffinityMask )
+	{
+	TCB_t *pxTCB;
+	BaseType_t xCoreID;
+
+		configASSERT( ( uxCoreAffinityMask & ( ( ( ( UBaseType_t ) 1U ) << configNUMBER_OF_CORES ) - 1U ) ) != 0U );
+
+		taskENTER_CRITICAL();
+		{
+			pxTCB = prvGetTCBFromHandle( xTask );
+			pxTCB->uxCoreAffinityMask = uxCoreAffinityMask;
+
+			if( xSchedulerRunning != pdFALSE )
+			{
+				xCoreID = pxTCB->xTaskRunState;
+
+				if( xCoreID != taskTASK_NOT_RUNNING )
+				{
+					/* Move the task off a core it may no longer use.  If that
+					is the calling core the switch happens when the critical
+					section is left. */
+					if( ( uxCoreAffinityMask & ( ( ( UBaseType_t ) 1U ) << xCoreID ) ) == 0U )
+					{
+						portYIELD_CORE( xCoreID );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				else if( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE )
+				{
+					/* A ready task may now be allowed on a core it should
+					preempt. */
+					prvYieldForTask( pxTCB );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	UBaseType_t vTaskCoreAffinityGet( TaskHandle_t xTask )
+	{
+	TCB_t *pxTCB;
+	UBaseType_t uxCoreAffinityMask;
+
+		taskENTER_CRITICAL();
+		{
+			pxTCB = prvGetTCBFromHandle( xTask );
+			uxCoreAffinityMask = pxTCB->uxCoreAffinityMask;
+		}
+		taskEXIT_CRITICAL();
+
+		return uxCoreAffinityMask;
+	}
+	/*-----------------------------------------------------------*/
+
+	TaskHandle_t xTaskGetCurrentTaskHandleForCore( BaseType_t xCoreID )
+	{
+		configASSERT( ( xCoreID >= 0 ) && ( xCoreID < ( BaseType_t ) configNUMBER_OF_CORES ) );
+		return ( TaskHandle_t ) pxCurrentTCBs[ xCoreID ];
+	}
+
+#endif /* configNUMBER_OF_CORES */
+/*----------------------------------------------------------*/
+
 /* This conditional compilation should use inequality to 0, not equality to 1.
 This is to ensure vTaskStepTick() is available when user defined low power mode
 implementations require configUSE_TICKLESS_IDLE to be set to a value other than
@@ -2588,119 +3560,114 @@ implementations require configUSE_TICKLESS_IDLE to be set to a value other than
 
 BaseType_t xTaskIncrementTick( void )
 {
-TCB_t * pxTCB;
-TickType_t xItemValue;
+	/* Called by the portable layer each time a tick interrupt occurs, which
+	is a catch up of a single tick. */
+	return xTaskCatchUpTicks( ( TickType_t ) 1U );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCatchUpTicks( TickType_t xTicksToCatchUp )
+{
+TickType_t xTicksThisStep;
 BaseType_t xSwitchRequired = pdFALSE;
+#if ( configUSE_TICK_HOOK == 1 )
+	const TickType_t xTicksForHook = xTicksToCatchUp;
+	TickType_t xHookCalls;
+#endif
+#if ( configNUMBER_OF_CORES > 1 )
+	TCB_t * pxTCB;
+	UBaseType_t uxSavedInterruptStatus;
+	BaseType_t xCoreID, xOtherCoreID;
+	UBaseType_t uxRunningAtPriority;
+#endif
+
+	#if ( configNUMBER_OF_CORES > 1 )
+	{
+		/* The other cores keep running kernel code while the tick is
+		processed. */
+		uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	}
+	#endif
 
-	/* Called by the portable layer each time a tick interrupt occurs.
-	Increments the tick then checks to see if the new tick value will cause any
-	tasks to be unblocked. */
+	/* Called by the portable layer from the tick interrupt.  Moves the tick
+	on by xTicksToCatchUp then checks to see if the new tick value will cause
+	any tasks to be unblocked. */
 	traceTASK_INCREMENT_TICK( xTickCount );
 	if( uxSchedulerSuspended == ( UBaseType_t ) pdFALSE )
 	{
-		/* Minor optimisation.  The tick count cannot change in this
-		block. */
-		const TickType_t xConstTickCount = xTickCount + ( TickType_t ) 1;
-
-		/* Increment the RTOS tick, switching the delayed and overflowed
-		delayed lists if it wraps to 0. */
-		xTickCount = xConstTickCount;
-
-		if( xConstTickCount == ( TickType_t ) 0U ) /*lint !e774 'if' does not always evaluate to false as it is looking for an overflow. */
-		{
-			taskSWITCH_DELAYED_LISTS();
-		}
-		else
-		{
-			mtCOVERAGE_TEST_MARKER();
-		}
-
-		/* See if this tick has made a timeout expire.  Tasks are stored in
-		the	queue in the order of their wake time - meaning once one task
-		has been found whose block time has not expired there is no need to
-		look any further down the list. */
-		if( xConstTickCount >= xNextTaskUnblockTime )
-		{
-			for( ;; )
+		/* Move the tick count on by up to the ticks left to catch up, but no
+		further than the last tick before it overflows, and unblock the tasks
+		that are due by then in a single pass.  The next step takes the tick
+		count through the overflow, so the delayed lists are only switched once
+		every task due before the overflow has left the current one. */
+		while( xTicksToCatchUp > ( TickType_t ) 0U )
+		{
+			if( xTickCount != portMAX_DELAY )
 			{
-				if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+				xTicksThisStep = portMAX_DELAY - xTickCount;
+
+				if( xTicksThisStep > xTicksToCatchUp )
 				{
-					/* The delayed list is empty.  Set xNextTaskUnblockTime
-					to the maximum possible value so it is extremely
-					unlikely that the
-					if( xTickCount >= xNextTaskUnblockTime ) test will pass
-					next time through. */
-					xNextTaskUnblockTime = portMAX_DELAY; /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
-					break;
+					xTicksThisStep = xTicksToCatchUp;
 				}
 				else
 				{
-					/* The delayed list is not empty, get the value of the
-					item at the head of the delayed list.  This is the time
-					at which the task at the head of the delayed list must
-					be removed from the Blocked state. */
-					pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
-					xItemValue = listGET_LIST_ITEM_VALUE( &( pxTCB->xStateListItem ) );
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				xTicksThisStep = ( TickType_t ) 1U;
+			}
 
-					if( xConstTickCount < xItemValue )
-					{
-						/* It is not time to unblock this item yet, but the
-						item value is the time at which the task at the head
-						of the blocked list must be removed from the Blocked
-						state -	so record the item value in
-						xNextTaskUnblockTime. */
-						xNextTaskUnblockTime = xItemValue;
-						break;
-					}
-					else
-					{
-						mtCOVERAGE_TEST_MARKER();
-					}
+			xTicksToCatchUp -= xTicksThisStep;
 
-					/* It is time to remove the item from the Blocked state. */
-					( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+			/* Increment the RTOS tick, switching the delayed and overflowed
+			delayed lists if it wraps to 0. */
+			xTickCount += xTicksThisStep;
 
-					/* Is the task waiting on an event also?  If so remove
-					it from the event list. */
-					if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
-					{
-						( void ) uxListRemove( &( pxTCB->xEventListItem ) );
-					}
-					else
-					{
-						mtCOVERAGE_TEST_MARKER();
-					}
+			if( xTickCount == ( TickType_t ) 0U ) /*lint !e774 'if' does not always evaluate to false as it is looking for an overflow. */
+			{
+				taskSWITCH_DELAYED_LISTS();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
 
-					/* Place the unblocked task into the appropriate ready
-					list. */
-					prvAddTaskToReadyList( pxTCB );
+			if( prvUnblockExpiredTasks( xTickCount ) != pdFALSE )
+			{
+				xSwitchRequired = pdTRUE;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
 
-					/* A task being unblocked cannot cause an immediate
-					context switch if preemption is turned off. */
-					#if (  configUSE_PREEMPTION == 1 )
-					{
-						/* Preemption is on, but a context switch should
-						only be performed if the unblocked task has a
-						priority that is equal to or higher than the
-						currently executing task. */
-						if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
-						{
-							xSwitchRequired = pdTRUE;
-						}
-						else
-						{
-							mtCOVERAGE_TEST_MARKER();
-						}
-					}
-					#endif /* configUSE_PREEMPTION */
+		#if ( configUSE_TASK_BUDGETS == 1 )
+		{
+			/* Demoting the running task, or restoring a task above it, calls
+			for a context switch if preemption is on. */
+			if( prvCheckTaskBudgets( xTickCount ) != pdFALSE )
+			{
+				#if ( configUSE_PREEMPTION == 1 )
+				{
+					xSwitchRequired = pdTRUE;
 				}
+				#endif
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
 			}
 		}
+		#endif /* configUSE_TASK_BUDGETS */
 
 		/* Tasks of equal priority to the currently running task will share
 		processing time (time slice) if preemption is on, and the application
 		writer has not explicitly turned time slicing off. */
-		#if ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) )
+		#if ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) && ( configNUMBER_OF_CORES == 1 ) )
 		{
 			if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ) ) > ( UBaseType_t ) 1 )
 			{
@@ -2711,15 +3678,55 @@ BaseType_t xSwitchRequired = pdFALSE;
 				mtCOVERAGE_TEST_MARKER();
 			}
 		}
+		#elif ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) )
+		{
+			/* A core shares its time when more tasks are ready at the
+			priority of its task than there are cores running tasks of that
+			priority. */
+			for( xCoreID = 0; xCoreID < ( BaseType_t ) configNUMBER_OF_CORES; xCoreID++ )
+			{
+				pxTCB = pxCurrentTCBs[ xCoreID ];
+				uxRunningAtPriority = ( UBaseType_t ) 0U;
+
+				for( xOtherCoreID = 0; xOtherCoreID < ( BaseType_t ) configNUMBER_OF_CORES; xOtherCoreID++ )
+				{
+					if( pxCurrentTCBs[ xOtherCoreID ]->uxPriority == pxTCB->uxPriority )
+					{
+						uxRunningAtPriority++;
+					}
+				}
+
+				if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ pxTCB->uxPriority ] ) ) > uxRunningAtPriority )
+				{
+					if( xCoreID == portGET_CORE_ID() )
+					{
+						xSwitchRequired = pdTRUE;
+					}
+					else
+					{
+						portYIELD_CORE( xCoreID );
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
 		#endif /* ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) ) */
 
 		#if ( configUSE_TICK_HOOK == 1 )
 		{
 			/* Guard against the tick hook being called when the pended tick
-			count is being unwound (when the scheduler is being unlocked). */
+			count is being unwound (when the scheduler is being unlocked).
+			Otherwise the hook is called once for every tick caught up, as if
+			each had been a separate tick interrupt. */
 			if( uxPendedTicks == ( UBaseType_t ) 0U )
 			{
-				vApplicationTickHook();
+				for( xHookCalls = ( TickType_t ) 0U; xHookCalls < xTicksForHook; xHookCalls++ )
+				{
+					vApplicationTickHook();
+				}
 			}
 			else
 			{
@@ -2730,13 +3737,16 @@ BaseType_t xSwitchRequired = pdFALSE;
 	}
 	else
 	{
-		++uxPendedTicks;
+		uxPendedTicks += ( UBaseType_t ) xTicksToCatchUp;
 
 		/* The tick hook gets called at regular intervals, even if the
-		scheduler is locked. */
+		scheduler is locked, once for every tick. */
 		#if ( configUSE_TICK_HOOK == 1 )
 		{
-			vApplicationTickHook();
+			for( xHookCalls = ( TickType_t ) 0U; xHookCalls < xTicksForHook; xHookCalls++ )
+			{
+				vApplicationTickHook();
+			}
 		}
 		#endif
 	}
@@ -2754,6 +3764,118 @@ BaseType_t xSwitchRequired = pdFALSE;
 	}
 	#endif /* configUSE_PREEMPTION */
 
+	#if ( configNUMBER_OF_CORES > 1 )
+	{
+		taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+	}
+	#endif
+
+	return xSwitchRequired;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvUnblockExpiredTasks( const TickType_t xConstTickCount )
+{
+TCB_t * pxTCB;
+TickType_t xItemValue;
+BaseType_t xSwitchRequired = pdFALSE;
+
+	/* See if this tick has made a timeout expire.  Tasks are stored in
+	the	queue in the order of their wake time - meaning once one task
+	has been found whose block time has not expired there is no need to
+	look any further down the list. */
+	if( xConstTickCount >= xNextTaskUnblockTime )
+	{
+		for( ;; )
+		{
+			#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+			{
+				if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+				{
+					/* The delayed list is empty.  Set xNextTaskUnblockTime
+					to the maximum possible value so it is extremely
+					unlikely that the
+					if( xTickCount >= xNextTaskUnblockTime ) test will pass
+					next time through. */
+					xNextTaskUnblockTime = portMAX_DELAY; /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+					break;
+				}
+
+				/* The delayed list is not empty, get the value of the
+				item at the head of the delayed list.  This is the time
+				at which the task at the head of the delayed list must
+				be removed from the Blocked state. */
+				pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
+				xItemValue = listGET_LIST_ITEM_VALUE( &( pxTCB->xStateListItem ) );
+
+				if( xConstTickCount < xItemValue )
+				{
+					/* It is not time to unblock this item yet, but the
+					item value is the time at which the task at the head
+					of the blocked list must be removed from the Blocked
+					state -	so record the item value in
+					xNextTaskUnblockTime. */
+					xNextTaskUnblockTime = xItemValue;
+					break;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#else
+			{
+				/* The tasks in a slot of the timing wheel are not ordered,
+				so take any task that is due.  Once there are none
+				xNextTaskUnblockTime has been set for the next. */
+				pxTCB = prvGetExpiredDelayedTask( xConstTickCount );
+
+				if( pxTCB == NULL )
+				{
+					break;
+				}
+			}
+			#endif /* configUSE_DELAYED_TASK_WHEEL */
+
+			/* It is time to remove the item from the Blocked state. */
+			( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+
+			/* Is the task waiting on an event also?  If so remove
+			it from the event list. */
+			if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+			{
+				( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* Place the unblocked task into the appropriate ready
+			list. */
+			prvAddTaskToReadyList( pxTCB );
+
+			/* A task being unblocked cannot cause an immediate
+			context switch if preemption is turned off. */
+			#if (  configUSE_PREEMPTION == 1 )
+			{
+				/* Preemption is on, but a context switch should
+				only be performed if the unblocked task has a
+				priority that is equal to or higher than the
+				currently executing task. */
+				if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+				{
+					xSwitchRequired = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif /* configUSE_PREEMPTION */
+		}
+	}
+
 	return xSwitchRequired;
 }
 /*-----------------------------------------------------------*/
@@ -2774,82 +3896,246 @@ BaseType_t xSwitchRequired = pdFALSE;
 		{
 			xTCB = ( TCB_t * ) xTask;
 		}
-
-		/* Save the hook function in the TCB.  A critical section is required as
-		the value can be accessed from an interrupt. */
-		taskENTER_CRITICAL();
-			xTCB->pxTaskTag = pxHookFunction;
-		taskEXIT_CRITICAL();
+
+		/* Save the hook function in the TCB.  A critical section is required as
+		the value can be accessed from an interrupt. */
+		taskENTER_CRITICAL();
+			xTCB->pxTaskTag = pxHookFunction;
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_APPLICATION_TASK_TAG */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+
+	TaskHookFunction_t xTaskGetApplicationTaskTag( TaskHandle_t xTask )
+	{
+	TCB_t *xTCB;
+	TaskHookFunction_t xReturn;
+
+		/* If xTask is NULL then we are setting our own task hook. */
+		if( xTask == NULL )
+		{
+			xTCB = ( TCB_t * ) pxCurrentTCB;
+		}
+		else
+		{
+			xTCB = ( TCB_t * ) xTask;
+		}
+
+		/* Save the hook function in the TCB.  A critical section is required as
+		the value can be accessed from an interrupt. */
+		taskENTER_CRITICAL();
+		{
+			xReturn = xTCB->pxTaskTag;
+		}
+		taskEXIT_CRITICAL();
+
+		return xReturn;
+	}
+
+#endif /* configUSE_APPLICATION_TASK_TAG */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+
+	BaseType_t xTaskCallApplicationTaskHook( TaskHandle_t xTask, void *pvParameter )
+	{
+	TCB_t *xTCB;
+	BaseType_t xReturn;
+
+		/* If xTask is NULL then we are calling our own task hook. */
+		if( xTask == NULL )
+		{
+			xTCB = ( TCB_t * ) pxCurrentTCB;
+		}
+		else
+		{
+			xTCB = ( TCB_t * ) xTask;
+		}
+
+		if( xTCB->pxTaskTag != NULL )
+		{
+			xReturn = xTCB->pxTaskTag( pvParameter );
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+
+		return xReturn;
+	}
+
+#endif /* configUSE_APPLICATION_TASK_TAG */
+/*-----------------------------------------------------------*/
+
+#if ( configNUMBER_OF_CORES > 1 )
+
+	static TCB_t *prvGetCurrentTCB( void )
+	{
+	TCB_t *pxTCB;
+	UBaseType_t uxSavedInterruptStatus;
+
+		/* Interrupts are masked so that the calling task cannot be switched
+		to another core between reading the core ID and reading the array. */
+		uxSavedInterruptStatus = portSET_INTERRUPT_MASK();
+		{
+			pxTCB = pxCurrentTCBs[ portGET_CORE_ID() ];
+		}
+		portCLEAR_INTERRUPT_MASK( uxSavedInterruptStatus );
+
+		return pxTCB;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvYieldForTask( TCB_t *pxTCB )
+	{
+	BaseType_t xCoreID;
+	BaseType_t xLowestCoreID = taskTASK_NOT_RUNNING;
+	UBaseType_t uxLowestPriority = pxTCB->uxPriority;
+	TCB_t *pxRunningTCB;
+
+		/* Called with at least the ISR lock held, which stops the cores
+		switching tasks. */
+		if( xSchedulerRunning != pdFALSE )
+		{
+			#if ( configUSE_PREEMPTION == 1 )
+			{
+				if( pxTCB->xTaskRunState != taskTASK_NOT_RUNNING )
+				{
+					/* The task was moved while running, for example to another
+					priority, so its core has to reconsider. */
+					portYIELD_CORE( pxTCB->xTaskRunState );
+				}
+				else
+				{
+					/* Preempt the core running the lowest priority task, if the
+					task is allowed there and of higher priority.  A core already
+					asked to switch will consider the task anyway. */
+					for( xCoreID = 0; xCoreID < ( BaseType_t ) configNUMBER_OF_CORES; xCoreID++ )
+					{
+						pxRunningTCB = pxCurrentTCBs[ xCoreID ];
+
+						if( ( ( pxTCB->uxCoreAffinityMask & ( ( ( UBaseType_t ) 1U ) << xCoreID ) ) != 0U ) &&
+							( xYieldPendings[ xCoreID ] == pdFALSE ) &&
+							( pxRunningTCB->uxPriority < uxLowestPriority ) )
+						{
+							uxLowestPriority = pxRunningTCB->uxPriority;
+							xLowestCoreID = xCoreID;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+
+					if( xLowestCoreID != taskTASK_NOT_RUNNING )
+					{
+						xYieldPendings[ xLowestCoreID ] = pdTRUE;
+						portYIELD_CORE( xLowestCoreID );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+			}
+			#endif /* configUSE_PREEMPTION */
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
 	}
+	/*-----------------------------------------------------------*/
 
-#endif /* configUSE_APPLICATION_TASK_TAG */
-/*-----------------------------------------------------------*/
-
-#if ( configUSE_APPLICATION_TASK_TAG == 1 )
-
-	TaskHookFunction_t xTaskGetApplicationTaskTag( TaskHandle_t xTask )
+	static void prvSelectHighestPriorityTask( BaseType_t xCoreID )
 	{
-	TCB_t *xTCB;
-	TaskHookFunction_t xReturn;
+	UBaseType_t uxTopPriority = uxTopReadyPriority;
+	UBaseType_t uxPriority;
+	UBaseType_t uxTasks;
+	List_t *pxReadyList;
+	TCB_t *pxTCB;
+	TCB_t *pxSelectedTCB = NULL;
+	const UBaseType_t uxCoreBit = ( ( UBaseType_t ) 1U ) << xCoreID;
 
-		/* If xTask is NULL then we are setting our own task hook. */
-		if( xTask == NULL )
+		/* Called with the task and ISR locks held.  Find the highest priority
+		queue that contains ready tasks, as taskSELECT_HIGHEST_PRIORITY_TASK()
+		does. */
+		while( listLIST_IS_EMPTY( &( pxReadyTasksLists[ uxTopPriority ] ) ) )
 		{
-			xTCB = ( TCB_t * ) pxCurrentTCB;
+			configASSERT( uxTopPriority );
+			--uxTopPriority;
 		}
-		else
+		uxTopReadyPriority = uxTopPriority;
+
+		/* The highest priority task may be running on another core or be
+		excluded from this one, so search down the priorities.  Indexing
+		through each list keeps the round robin between tasks of equal
+		priority. */
+		for( uxPriority = uxTopPriority + 1U; ( uxPriority > 0U ) && ( pxSelectedTCB == NULL ); uxPriority-- )
 		{
-			xTCB = ( TCB_t * ) xTask;
+			pxReadyList = &( pxReadyTasksLists[ uxPriority - 1U ] );
+
+			for( uxTasks = listCURRENT_LIST_LENGTH( pxReadyList ); uxTasks > 0U; uxTasks-- )
+			{
+				listGET_OWNER_OF_NEXT_ENTRY( pxTCB, pxReadyList );
+
+				if( ( ( pxTCB->xTaskRunState == taskTASK_NOT_RUNNING ) || ( pxTCB->xTaskRunState == xCoreID ) ) &&
+					( ( pxTCB->uxCoreAffinityMask & uxCoreBit ) != 0U ) )
+				{
+					pxSelectedTCB = pxTCB;
+					break;
+				}
+			}
 		}
 
-		/* Save the hook function in the TCB.  A critical section is required as
-		the value can be accessed from an interrupt. */
-		taskENTER_CRITICAL();
+		/* The idle task of the core can always run. */
+		configASSERT( pxSelectedTCB != NULL );
+
+		if( pxCurrentTCBs[ xCoreID ] != NULL )
 		{
-			xReturn = xTCB->pxTaskTag;
+			if( pxCurrentTCBs[ xCoreID ]->xTaskRunState == xCoreID )
+			{
+				pxCurrentTCBs[ xCoreID ]->xTaskRunState = taskTASK_NOT_RUNNING;
+			}
 		}
-		taskEXIT_CRITICAL();
 
-		return xReturn;
+		pxSelectedTCB->xTaskRunState = xCoreID;
+		pxCurrentTCBs[ xCoreID ] = pxSelectedTCB;
 	}
+	/*-----------------------------------------------------------*/
 
-#endif /* configUSE_APPLICATION_TASK_TAG */
-/*-----------------------------------------------------------*/
-
-#if ( configUSE_APPLICATION_TASK_TAG == 1 )
-
-	BaseType_t xTaskCallApplicationTaskHook( TaskHandle_t xTask, void *pvParameter )
+	static BaseType_t prvSchedulerSuspendedByCaller( void )
 	{
-	TCB_t *xTCB;
 	BaseType_t xReturn;
 
-		/* If xTask is NULL then we are calling our own task hook. */
-		if( xTask == NULL )
-		{
-			xTCB = ( TCB_t * ) pxCurrentTCB;
-		}
-		else
-		{
-			xTCB = ( TCB_t * ) xTask;
-		}
-
-		if( xTCB->pxTaskTag != NULL )
-		{
-			xReturn = xTCB->pxTaskTag( pvParameter );
-		}
-		else
+		taskENTER_CRITICAL();
 		{
-			xReturn = pdFAIL;
+			xReturn = ( uxSchedulerSuspended != ( UBaseType_t ) pdFALSE ) ? pdTRUE : pdFALSE;
 		}
+		taskEXIT_CRITICAL();
 
 		return xReturn;
 	}
 
-#endif /* configUSE_APPLICATION_TASK_TAG */
+#endif /* configNUMBER_OF_CORES */
 /*-----------------------------------------------------------*/
 
 void vTaskSwitchContext( void )
 {
+	#if ( configNUMBER_OF_CORES > 1 )
+	{
+		/* Called with interrupts disabled.  The task lock keeps other cores
+		out of the scheduler and, while another core has the scheduler
+		suspended, holds this core off until it is resumed.  The ISR lock keeps
+		interrupts on other cores out of the ready lists. */
+		portGET_TASK_LOCK();
+		portGET_ISR_LOCK();
+	}
+	#endif
+
 	if( uxSchedulerSuspended != ( UBaseType_t ) pdFALSE )
 	{
 		/* The scheduler is currently suspended - do not allow a context
@@ -2888,14 +4174,37 @@ void vTaskSwitchContext( void )
 		}
 		#endif /* configGENERATE_RUN_TIME_STATS */
 
+		#if ( configUSE_TASK_BUDGETS == 1 )
+		{
+			/* Charge the ticks the task has been running for to its budget.
+			While it runs, the tick adds the ticks since it was switched in to
+			see whether the budget has been used up. */
+			pxCurrentTCB->xBudgetConsumed += ( TickType_t ) ( xTickCount - xTaskSwitchedInTick );
+		}
+		#endif /* configUSE_TASK_BUDGETS */
+
 		/* Check for stack overflow, if configured. */
 		taskCHECK_FOR_STACK_OVERFLOW();
 
 		/* Select a new task to run using either the generic C or port
 		optimised asm code. */
-		taskSELECT_HIGHEST_PRIORITY_TASK();
+		#if ( configNUMBER_OF_CORES == 1 )
+		{
+			taskSELECT_HIGHEST_PRIORITY_TASK();
+		}
+		#else
+		{
+			prvSelectHighestPriorityTask( portGET_CORE_ID() );
+		}
+		#endif
 		traceTASK_SWITCHED_IN();
 
+		#if ( configUSE_TASK_BUDGETS == 1 )
+		{
+			xTaskSwitchedInTick = xTickCount;
+		}
+		#endif /* configUSE_TASK_BUDGETS */
+
 		#if ( configUSE_NEWLIB_REENTRANT == 1 )
 		{
 			/* Switch Newlib's _impure_ptr variable to point to the _reent
@@ -2904,6 +4213,13 @@ void vTaskSwitchContext( void )
 		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 	}
+
+	#if ( configNUMBER_OF_CORES > 1 )
+	{
+		portRELEASE_ISR_LOCK();
+		portRELEASE_TASK_LOCK();
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -3260,8 +4576,9 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 			A critical region is not required here as we are just reading from
 			the list, and an occasional incorrect value will not matter.  If
 			the ready list at the idle priority contains more than one task
-			then a task other than the idle task is ready to execute. */
-			if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ tskIDLE_PRIORITY ] ) ) > ( UBaseType_t ) 1 )
+			per core then a task other than an idle task is ready to
+			execute. */
+			if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ tskIDLE_PRIORITY ] ) ) > ( UBaseType_t ) configNUMBER_OF_CORES )
 			{
 				taskYIELD();
 			}
@@ -3356,6 +4673,13 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 			/* A yield was pended while the scheduler was suspended. */
 			eReturn = eAbortSleep;
 		}
+		else if( uxPendedTicks != ( UBaseType_t ) 0U )
+		{
+			/* A tick interrupt has already occurred but was held pending
+			because the scheduler is suspended, so the expected idle time was
+			measured from a stale tick count. */
+			eReturn = eAbortSleep;
+		}
 		else
 		{
 			/* If all the tasks are in the suspended list (which might mean they
@@ -3442,8 +4766,23 @@ UBaseType_t uxPriority;
 		vListInitialise( &( pxReadyTasksLists[ uxPriority ] ) );
 	}
 
-	vListInitialise( &xDelayedTaskList1 );
-	vListInitialise( &xDelayedTaskList2 );
+	#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+	{
+		vListInitialise( &xDelayedTaskList1 );
+		vListInitialise( &xDelayedTaskList2 );
+	}
+	#else
+	{
+	UBaseType_t uxSlot;
+
+		for( uxSlot = ( UBaseType_t ) 0U; uxSlot < taskWHEEL_SLOTS; uxSlot++ )
+		{
+			vListInitialise( &( xDelayedTaskWheel[ uxSlot ] ) );
+		}
+
+		vListInitialise( &xOverflowDelayedTaskList );
+	}
+	#endif /* configUSE_DELAYED_TASK_WHEEL */
 	vListInitialise( &xPendingReadyList );
 
 	#if ( INCLUDE_vTaskDelete == 1 )
@@ -3458,10 +4797,20 @@ UBaseType_t uxPriority;
 	}
 	#endif /* INCLUDE_vTaskSuspend */
 
-	/* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
-	using list2. */
-	pxDelayedTaskList = &xDelayedTaskList1;
-	pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	#if ( configUSE_TASK_BUDGETS == 1 )
+	{
+		vListInitialise( &xBudgetExhaustedTaskList );
+	}
+	#endif /* configUSE_TASK_BUDGETS */
+
+	#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+	{
+		/* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
+		using list2. */
+		pxDelayedTaskList = &xDelayedTaskList1;
+		pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -3480,13 +4829,50 @@ static void prvCheckTasksWaitingTermination( void )
 		{
 			taskENTER_CRITICAL();
 			{
-				pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( ( &xTasksWaitingTermination ) );
-				( void ) uxListRemove( &( pxTCB->xStateListItem ) );
-				--uxCurrentNumberOfTasks;
-				--uxDeletedTasksWaitingCleanUp;
+				#if ( configNUMBER_OF_CORES == 1 )
+				{
+					pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( ( &xTasksWaitingTermination ) );
+					( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+					--uxCurrentNumberOfTasks;
+					--uxDeletedTasksWaitingCleanUp;
+				}
+				#else
+				{
+					/* The idle task of another core may have got here first,
+					and a task deleted while running cannot be freed until its
+					core has switched away from it. */
+					pxTCB = NULL;
+
+					if( listLIST_IS_EMPTY( &xTasksWaitingTermination ) == pdFALSE )
+					{
+						pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( ( &xTasksWaitingTermination ) );
+
+						if( pxTCB->xTaskRunState == taskTASK_NOT_RUNNING )
+						{
+							( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+							--uxCurrentNumberOfTasks;
+							--uxDeletedTasksWaitingCleanUp;
+						}
+						else
+						{
+							pxTCB = NULL;
+						}
+					}
+				}
+				#endif /* configNUMBER_OF_CORES */
 			}
 			taskEXIT_CRITICAL();
 
+			#if ( configNUMBER_OF_CORES > 1 )
+			{
+				if( pxTCB == NULL )
+				{
+					/* Try again on a later pass of the idle task. */
+					break;
+				}
+			}
+			#endif
+
 			prvDeleteTCB( pxTCB );
 		}
 	}
@@ -3529,6 +4915,19 @@ static void prvCheckTasksWaitingTermination( void )
 		}
 		#endif
 
+		#if ( configUSE_EDF_SCHEDULING == 1 )
+		{
+			pxTaskStatus->xAbsoluteDeadline = pxTCB->xAbsoluteDeadline;
+			pxTaskStatus->uxDeadlineMisses = pxTCB->uxDeadlineMisses;
+		}
+		#endif
+
+		#if ( configUSE_TASK_BUDGETS == 1 )
+		{
+			pxTaskStatus->uxBudgetExhaustions = pxTCB->uxBudgetExhaustions;
+		}
+		#endif
+
 		/* Obtaining the task state is a little fiddly, so is only done if the
 		value of eState passed into this function is eInvalid - otherwise the
 		state is just set to whatever is passed in. */
@@ -3727,6 +5126,8 @@ static void prvCheckTasksWaitingTermination( void )
 #endif /* INCLUDE_vTaskDelete */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+
 static void prvResetNextTaskUnblockTime( void )
 {
 TCB_t *pxTCB;
@@ -3749,6 +5150,223 @@ TCB_t *pxTCB;
 		xNextTaskUnblockTime = listGET_LIST_ITEM_VALUE( &( ( pxTCB )->xStateListItem ) );
 	}
 }
+
+#else /* configUSE_DELAYED_TASK_WHEEL */
+
+static void prvResetNextTaskUnblockTime( void )
+{
+List_t *pxList;
+TickType_t xSlotTime;
+
+	/* The earliest task is in the first occupied slot of the lowest occupied
+	level of the wheel.  A slot in the first level holds the tasks for a single
+	wake time.  A slot above the first level starts before any task in it
+	wakes, and its tasks are cascaded down when the tick count reaches it.  Set
+	xNextTaskUnblockTime to the maximum possible value if the wheel is empty. */
+	pxList = prvGetFirstDelayedTaskSlot( xTickCount, &xSlotTime );
+
+	if( pxList == NULL )
+	{
+		xNextTaskUnblockTime = portMAX_DELAY;
+	}
+	else
+	{
+		xNextTaskUnblockTime = xSlotTime;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static List_t *prvGetDelayedTaskSlot( const TickType_t xTimeToWake )
+{
+TickType_t xDifference;
+UBaseType_t uxLevel = ( UBaseType_t ) 0U, uxSlot;
+
+	/* No task wakes before xDelayedTaskWheelTime, so a task that first
+	differs from it in the bits for a level wakes after every task in the
+	levels below, and after the tasks in the slots before its own. */
+	configASSERT( xTimeToWake >= xDelayedTaskWheelTime );
+
+	xDifference = ( TickType_t ) ( ( xTimeToWake ^ xDelayedTaskWheelTime ) >> taskWHEEL_SLOT_BITS );
+
+	while( xDifference != ( TickType_t ) 0U )
+	{
+		xDifference >>= taskWHEEL_SLOT_BITS;
+		uxLevel++;
+	}
+
+	uxSlot = ( UBaseType_t ) ( xTimeToWake >> ( uxLevel * taskWHEEL_SLOT_BITS ) ) & ( ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE - 1U );
+	uxDelayedTaskWheelOccupied[ uxLevel ][ uxSlot / taskWHEEL_BITMAP_BITS ] |= ( ( UBaseType_t ) 1U ) << ( uxSlot % taskWHEEL_BITMAP_BITS );
+
+	return &( xDelayedTaskWheel[ ( uxLevel * ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE ) + uxSlot ] );
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvGetFirstOccupiedSlot( const UBaseType_t uxLevel )
+{
+UBaseType_t * const puxBitmap = uxDelayedTaskWheelOccupied[ uxLevel ];
+UBaseType_t uxWord, uxBit, uxSlot = ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE;
+
+	for( uxWord = ( UBaseType_t ) 0U; ( uxWord < taskWHEEL_BITMAP_WORDS ) && ( uxSlot == ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE ); uxWord++ )
+	{
+		while( puxBitmap[ uxWord ] != ( UBaseType_t ) 0U )
+		{
+			uxBit = taskLOWEST_BIT( puxBitmap[ uxWord ] );
+
+			if( listLIST_IS_EMPTY( &( xDelayedTaskWheel[ ( uxLevel * ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE ) + ( uxWord * taskWHEEL_BITMAP_BITS ) + uxBit ] ) ) == pdFALSE )
+			{
+				uxSlot = ( uxWord * taskWHEEL_BITMAP_BITS ) + uxBit;
+				break;
+			}
+			else
+			{
+				/* The last task in the slot was removed other than by the
+				wheel, for example because the event it waited for occurred. */
+				puxBitmap[ uxWord ] &= ~( ( ( UBaseType_t ) 1U ) << uxBit );
+			}
+		}
+	}
+
+	return uxSlot;
+}
+/*-----------------------------------------------------------*/
+
+static List_t *prvGetFirstDelayedTaskSlot( const TickType_t xConstTickCount, TickType_t * const pxSlotTime )
+{
+List_t *pxList = NULL;
+ListItem_t *pxListItem;
+UBaseType_t uxLevel, uxSlot;
+TickType_t xLevelMask, xSlotTime;
+
+	for( ;; )
+	{
+		uxSlot = ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE;
+
+		for( uxLevel = ( UBaseType_t ) 0U; uxLevel < taskWHEEL_LEVELS; uxLevel++ )
+		{
+			uxSlot = prvGetFirstOccupiedSlot( uxLevel );
+
+			if( uxSlot != ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE )
+			{
+				break;
+			}
+		}
+
+		if( uxSlot == ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE )
+		{
+			/* The wheel is empty, so it can start again from the current
+			tick count. */
+			pxList = NULL;
+			xDelayedTaskWheelTime = xConstTickCount;
+			break;
+		}
+
+		/* The tasks in the slot share the bits of xDelayedTaskWheelTime above
+		the level, and the slot's own bits. */
+		xLevelMask = ( TickType_t ) ( ( ( TickType_t ) configDELAYED_TASK_WHEEL_SIZE << ( uxLevel * taskWHEEL_SLOT_BITS ) ) - ( TickType_t ) 1U );
+		xSlotTime = ( TickType_t ) ( ( xDelayedTaskWheelTime & ( TickType_t ) ~xLevelMask ) | ( ( TickType_t ) uxSlot << ( uxLevel * taskWHEEL_SLOT_BITS ) ) );
+		pxList = &( xDelayedTaskWheel[ ( uxLevel * ( UBaseType_t ) configDELAYED_TASK_WHEEL_SIZE ) + uxSlot ] );
+
+		if( ( uxLevel == ( UBaseType_t ) 0U ) || ( xSlotTime > xConstTickCount ) )
+		{
+			*pxSlotTime = xSlotTime;
+			break;
+		}
+
+		/* The slot has started, so move the wheel on to its start and cascade
+		its tasks down into the levels below, where the lower bits of their
+		wake time pick their slot.  Each task is cascaded at most once for
+		each level it started above the first. */
+		xDelayedTaskWheelTime = xSlotTime;
+		uxDelayedTaskWheelOccupied[ uxLevel ][ uxSlot / taskWHEEL_BITMAP_BITS ] &= ~( ( ( UBaseType_t ) 1U ) << ( uxSlot % taskWHEEL_BITMAP_BITS ) );
+
+		while( listLIST_IS_EMPTY( pxList ) == pdFALSE )
+		{
+			pxListItem = listGET_HEAD_ENTRY( pxList );
+			( void ) uxListRemove( pxListItem );
+			vListInsertEnd( prvGetDelayedTaskSlot( listGET_LIST_ITEM_VALUE( pxListItem ) ), pxListItem );
+		}
+	}
+
+	return pxList;
+}
+/*-----------------------------------------------------------*/
+
+static TCB_t *prvGetExpiredDelayedTask( const TickType_t xConstTickCount )
+{
+TCB_t *pxTCB = NULL;
+List_t *pxList;
+TickType_t xSlotTime = portMAX_DELAY;
+
+	pxList = prvGetFirstDelayedTaskSlot( xConstTickCount, &xSlotTime );
+
+	if( pxList == NULL )
+	{
+		xNextTaskUnblockTime = portMAX_DELAY;
+	}
+	else if( xSlotTime > xConstTickCount )
+	{
+		xNextTaskUnblockTime = xSlotTime;
+	}
+	else
+	{
+		/* Only a slot in the first level can have started, and all the tasks
+		in it wake at its start. */
+		pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxList );
+	}
+
+	return pxTCB;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMoveOverflowedTasksToWheel( void )
+{
+ListItem_t *pxListItem;
+UBaseType_t uxSlot, uxLevel, uxWord;
+
+	/* The wheel should be empty when the tick count overflows, and starts
+	again from 0. */
+	for( uxSlot = ( UBaseType_t ) 0U; uxSlot < taskWHEEL_SLOTS; uxSlot++ )
+	{
+		configASSERT( ( listLIST_IS_EMPTY( &( xDelayedTaskWheel[ uxSlot ] ) ) ) );
+	}
+
+	for( uxLevel = ( UBaseType_t ) 0U; uxLevel < taskWHEEL_LEVELS; uxLevel++ )
+	{
+		for( uxWord = ( UBaseType_t ) 0U; uxWord < taskWHEEL_BITMAP_WORDS; uxWord++ )
+		{
+			uxDelayedTaskWheelOccupied[ uxLevel ][ uxWord ] = ( UBaseType_t ) 0U;
+		}
+	}
+
+	xDelayedTaskWheelTime = ( TickType_t ) 0U;
+
+	while( listLIST_IS_EMPTY( pxOverflowDelayedTaskList ) == pdFALSE )
+	{
+		pxListItem = listGET_HEAD_ENTRY( pxOverflowDelayedTaskList );
+		( void ) uxListRemove( pxListItem );
+		vListInsertEnd( taskDELAYED_LIST_FOR( listGET_LIST_ITEM_VALUE( pxListItem ) ), pxListItem );
+	}
+}
+/*-----------------------------------------------------------*/
+
+#ifndef portLOWEST_BIT
+
+	static UBaseType_t prvLowestBit( UBaseType_t uxBitmap )
+	{
+	UBaseType_t uxBit = ( UBaseType_t ) 0U;
+
+		while( ( uxBitmap & ( UBaseType_t ) 1U ) == ( UBaseType_t ) 0U )
+		{
+			uxBitmap >>= 1U;
+			uxBit++;
+		}
+
+		return uxBit;
+	}
+
+#endif /* portLOWEST_BIT */
+
+#endif /* configUSE_DELAYED_TASK_WHEEL */
 /*-----------------------------------------------------------*/
 
 #if ( ( INCLUDE_xTaskGetCurrentTaskHandle == 1 ) || ( configUSE_MUTEXES == 1 ) )
@@ -3780,7 +5398,7 @@ TCB_t *pxTCB;
 		}
 		else
 		{
-			if( uxSchedulerSuspended == ( UBaseType_t ) pdFALSE )
+			if( taskSCHEDULER_SUSPENDED_BY_CALLER() == pdFALSE )
 			{
 				xReturn = taskSCHEDULER_RUNNING;
 			}
@@ -4258,7 +5876,7 @@ TCB_t *pxTCB;
 	{
 	TaskStatus_t *pxTaskStatusArray;
 	volatile UBaseType_t uxArraySize, x;
-	uint32_t ulTotalTime, ulStatsAsPercentage;
+	configRUN_TIME_COUNTER_TYPE ulTotalTime, ulStatsAsPercentage;
 
 		#if( configUSE_TRACE_FACILITY != 1 )
 		{
@@ -4327,11 +5945,24 @@ TCB_t *pxTCB;
 					easily. */
 					pcWriteBuffer = prvWriteNameToBuffer( pcWriteBuffer, pxTaskStatusArray[ x ].pcTaskName );
 
-					if( ulStatsAsPercentage > 0UL )
+					if( sizeof( configRUN_TIME_COUNTER_TYPE ) > sizeof( unsigned int ) )
+					{
+						/* The counter is wider than the casts below (for
+						example a uint64_t counter), so print it in full. */
+						if( ulStatsAsPercentage > 0UL )
+						{
+							sprintf( pcWriteBuffer, "\t%llu\t\t%llu%%\r\n", ( unsigned long long ) pxTaskStatusArray[ x ].ulRunTimeCounter, ( unsigned long long ) ulStatsAsPercentage );
+						}
+						else
+						{
+							sprintf( pcWriteBuffer, "\t%llu\t\t<1%%\r\n", ( unsigned long long ) pxTaskStatusArray[ x ].ulRunTimeCounter );
+						}
+					}
+					else if( ulStatsAsPercentage > 0UL )
 					{
 						#ifdef portLU_PRINTF_SPECIFIER_REQUIRED
 						{
-							sprintf( pcWriteBuffer, "\t%lu\t\t%lu%%\r\n", pxTaskStatusArray[ x ].ulRunTimeCounter, ulStatsAsPercentage );
+							sprintf( pcWriteBuffer, "\t%lu\t\t%lu%%\r\n", ( unsigned long ) pxTaskStatusArray[ x ].ulRunTimeCounter, ( unsigned long ) ulStatsAsPercentage );
 						}
 						#else
 						{
@@ -4347,7 +5978,7 @@ TCB_t *pxTCB;
 						consumed less than 1% of the total run time. */
 						#ifdef portLU_PRINTF_SPECIFIER_REQUIRED
 						{
-							sprintf( pcWriteBuffer, "\t%lu\t\t<1%%\r\n", pxTaskStatusArray[ x ].ulRunTimeCounter );
+							sprintf( pcWriteBuffer, "\t%lu\t\t<1%%\r\n", ( unsigned long ) pxTaskStatusArray[ x ].ulRunTimeCounter );
 						}
 						#else
 						{
@@ -4959,13 +6590,13 @@ const TickType_t xConstTickCount = xTickCount;
 			{
 				/* Wake time has overflowed.  Place this item in the overflow
 				list. */
-				vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+				taskINSERT_DELAYED_TASK( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
 			}
 			else
 			{
 				/* The wake time has not overflowed, so the current block list
 				is used. */
-				vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+				taskINSERT_DELAYED_TASK( taskDELAYED_LIST_FOR( xTimeToWake ), &( pxCurrentTCB->xStateListItem ) );
 
 				/* If the task entering the blocked state was placed at the
 				head of the list of blocked tasks then xNextTaskUnblockTime
@@ -4994,12 +6625,12 @@ const TickType_t xConstTickCount = xTickCount;
 		if( xTimeToWake < xConstTickCount )
 		{
 			/* Wake time has overflowed.  Place this item in the overflow list. */
-			vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+			taskINSERT_DELAYED_TASK( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
 		}
 		else
 		{
 			/* The wake time has not overflowed, so the current block list is used. */
-			vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+			taskINSERT_DELAYED_TASK( taskDELAYED_LIST_FOR( xTimeToWake ), &( pxCurrentTCB->xStateListItem ) );
 
 			/* If the task entering the blocked state was placed at the head of the
 			list of blocked tasks then xNextTaskUnblockTime needs to be updated